@@ -27,22 +27,452 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 
 #include "py/nlr.h"
 #include "py/objlist.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
+#include "py/stream.h"
+#include "py/stackctrl.h"
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+#include "py/formatfloat.h"
+#endif
 
 #if MICROPY_PY_UJSON
 
+// The serializer writes through this, into a chunk buffer which is passed
+// on to a stream or appended to a vstr whenever it's full.
+#define UJSON_OUT_CHUNK (256)
+
+typedef struct _ujson_out_t {
+    mp_obj_t stream_obj;
+    mp_uint_t (*write)(mp_obj_t obj, const void *buf, mp_uint_t size, int *errcode);
+    vstr_t *vstr;
+    mp_uint_t len;
+    byte buf[UJSON_OUT_CHUNK];
+} ujson_out_t;
+
+STATIC void ujson_out_flush(ujson_out_t *out) {
+    if (out->vstr != NULL) {
+        vstr_add_strn(out->vstr, (const char*)out->buf, out->len);
+    } else {
+        const byte *buf = out->buf;
+        for (mp_uint_t len = out->len; len > 0;) {
+            int errcode;
+            mp_uint_t n = out->write(out->stream_obj, buf, len, &errcode);
+            if (n == MP_STREAM_ERROR) {
+                nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+            }
+            if (n == 0) {
+                // A closed or full stream would never take the rest
+                nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(EIO)));
+            }
+            buf += n;
+            len -= n;
+        }
+    }
+    out->len = 0;
+}
+
+static inline void ujson_out_char(ujson_out_t *out, char c) {
+    if (out->len == UJSON_OUT_CHUNK) {
+        ujson_out_flush(out);
+    }
+    out->buf[out->len++] = c;
+}
+
+STATIC void ujson_out_strn(ujson_out_t *out, const char *str, mp_uint_t len) {
+    while (len > 0) {
+        if (out->len == UJSON_OUT_CHUNK) {
+            ujson_out_flush(out);
+        }
+        mp_uint_t n = UJSON_OUT_CHUNK - out->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(out->buf + out->len, str, n);
+        out->len += n;
+        str += n;
+        len -= n;
+    }
+}
+
+// For objects without a fast path, goes through their print method
+STATIC void ujson_out_print(ujson_out_t *out, mp_obj_t obj) {
+    vstr_t vstr;
+    vstr_init(&vstr, 16);
+    mp_obj_print_helper((void (*)(void *env, const char *fmt, ...))vstr_printf, &vstr, obj, PRINT_JSON);
+    ujson_out_strn(out, vstr.buf, vstr.len);
+    vstr_clear(&vstr);
+}
+
+STATIC void ujson_out_int(ujson_out_t *out, mp_int_t val) {
+    char buf[sizeof(mp_int_t) * 3 + 2];
+    char *p = buf + sizeof(buf);
+    mp_uint_t u = val < 0 ? -(mp_uint_t)val : (mp_uint_t)val;
+    do {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (val < 0) {
+        *--p = '-';
+    }
+    ujson_out_strn(out, p, buf + sizeof(buf) - p);
+}
+
+STATIC void ujson_out_str(ujson_out_t *out, mp_obj_t obj) {
+    mp_uint_t len;
+    const char *str = mp_obj_str_get_data(obj, &len);
+    const char *top = str + len;
+    ujson_out_char(out, '"');
+    while (str < top) {
+        // copy runs of chars which need no escaping in one go
+        const char *run = str;
+        while (str < top && *str != '"' && *str != '\\' && (byte)*str >= 0x20) {
+            str++;
+        }
+        ujson_out_strn(out, run, str - run);
+        if (str == top) {
+            break;
+        }
+        byte c = *str++;
+        ujson_out_char(out, '\\');
+        switch (c) {
+            case '"': ujson_out_char(out, '"'); break;
+            case '\\': ujson_out_char(out, '\\'); break;
+            case '\n': ujson_out_char(out, 'n'); break;
+            case '\r': ujson_out_char(out, 'r'); break;
+            case '\t': ujson_out_char(out, 't'); break;
+            default: {
+                // includes \b and \f, as written by PRINT_JSON
+                static const char hex[] = "0123456789abcdef";
+                char u[5] = {'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                ujson_out_strn(out, u, 5);
+            }
+        }
+    }
+    ujson_out_char(out, '"');
+}
+
+// The output is the same as printing the object with PRINT_JSON
+STATIC void ujson_out_obj(ujson_out_t *out, mp_obj_t obj) {
+    MP_STACK_CHECK();
+    if (MP_OBJ_IS_SMALL_INT(obj)) {
+        ujson_out_int(out, MP_OBJ_SMALL_INT_VALUE(obj));
+    } else if (obj == mp_const_none) {
+        ujson_out_strn(out, "null", 4);
+    } else if (obj == mp_const_true) {
+        ujson_out_strn(out, "true", 4);
+    } else if (obj == mp_const_false) {
+        ujson_out_strn(out, "false", 5);
+    } else if (MP_OBJ_IS_STR(obj)) {
+        ujson_out_str(out, obj);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    } else if (MP_OBJ_IS_TYPE(obj, &mp_type_float)) {
+        mp_float_t val = mp_obj_float_get(obj);
+        #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+        char buf[16];
+        mp_format_float(val, buf, sizeof(buf), 'g', 7, '\0');
+        #else
+        char buf[32];
+        sprintf(buf, "%.16g", (double)val);
+        #endif
+        ujson_out_strn(out, buf, strlen(buf));
+        if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL && strchr(buf, 'n') == NULL) {
+            ujson_out_strn(out, ".0", 2);
+        }
+    #endif
+    } else if (MP_OBJ_IS_TYPE(obj, &mp_type_list) || MP_OBJ_IS_TYPE(obj, &mp_type_tuple)) {
+        mp_uint_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(obj, &len, &items);
+        ujson_out_char(out, '[');
+        for (mp_uint_t i = 0; i < len; i++) {
+            if (i > 0) {
+                ujson_out_strn(out, ", ", 2);
+            }
+            ujson_out_obj(out, items[i]);
+        }
+        ujson_out_char(out, ']');
+    } else if (MP_OBJ_IS_TYPE(obj, &mp_type_dict)) {
+        mp_map_t *map = mp_obj_dict_get_map(obj);
+        bool first = true;
+        ujson_out_char(out, '{');
+        for (mp_uint_t i = 0; i < map->alloc; i++) {
+            mp_obj_t key = map->table[i].key;
+            if (key == MP_OBJ_NULL || key == MP_OBJ_SENTINEL) {
+                continue;
+            }
+            if (!first) {
+                ujson_out_strn(out, ", ", 2);
+            }
+            first = false;
+            ujson_out_obj(out, key);
+            ujson_out_strn(out, ": ", 2);
+            ujson_out_obj(out, map->table[i].value);
+        }
+        ujson_out_char(out, '}');
+    } else {
+        // big ints and anything else
+        ujson_out_print(out, obj);
+    }
+}
+
 STATIC mp_obj_t mod_ujson_dumps(mp_obj_t obj) {
     vstr_t vstr;
     vstr_init(&vstr, 8);
-    mp_obj_print_helper((void (*)(void *env, const char *fmt, ...))vstr_printf, &vstr, obj, PRINT_JSON);
+    ujson_out_t out;
+    out.vstr = &vstr;
+    out.len = 0;
+    ujson_out_obj(&out, obj);
+    ujson_out_flush(&out);
     return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 
+// Writes to the stream in chunks of UJSON_OUT_CHUNK bytes, the output as a
+// whole is never in the heap
+STATIC mp_obj_t mod_ujson_dump(mp_obj_t obj, mp_obj_t stream_in) {
+    mp_obj_type_t *type = mp_obj_get_type(stream_in);
+    if (type->stream_p == NULL || type->stream_p->write == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "object with stream.write required"));
+    }
+    ujson_out_t out;
+    out.stream_obj = stream_in;
+    out.write = type->stream_p->write;
+    out.vstr = NULL;
+    out.len = 0;
+    ujson_out_obj(&out, obj);
+    ujson_out_flush(&out);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_obj, mod_ujson_dump);
+
+// The parser reads its input through this, either straight from a str or
+// bytes object or in chunks from a stream.
+#define UJSON_STREAM_CHUNK (256)
+
+// Dict keys up to UJSON_QSTR_KEY_MAX bytes become qstrs. Records with the
+// same keys then share them, instead of allocating every key anew, and dict
+// lookups with them are faster. Interned keys stay in the qstr pool for good,
+// so a parse only adds up to UJSON_QSTR_NEW_MAX of them; keys which already
+// are qstrs are always shared.
+#define UJSON_QSTR_KEY_MAX (32)
+#define UJSON_QSTR_NEW_MAX (16)
+#define UJSON_EOF (-1)
+
+typedef struct _ujson_stream_t {
+    mp_obj_t stream_obj;
+    mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
+    const byte *cur;
+    const byte *top;
+    byte *buf;
+    mp_uint_t dict_hint; // size of the last dict parsed, for the next one
+    mp_uint_t new_qstrs; // dict keys this parse may still intern
+} ujson_stream_t;
+
+STATIC void ujson_stream_init(ujson_stream_t *s, mp_obj_t obj, byte *buf) {
+    s->stream_obj = obj;
+    s->buf = buf;
+    s->dict_hint = 0;
+    s->new_qstrs = UJSON_QSTR_NEW_MAX;
+    if (MP_OBJ_IS_STR_OR_BYTES(obj)) {
+        mp_uint_t len;
+        s->cur = (const byte*)mp_obj_str_get_data(obj, &len);
+        s->top = s->cur + len;
+        s->read = NULL;
+    } else {
+        mp_obj_type_t *type = mp_obj_get_type(obj);
+        if (type->stream_p == NULL || type->stream_p->read == NULL) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "object with stream.read required"));
+        }
+        s->cur = s->top = buf;
+        s->read = type->stream_p->read;
+    }
+}
+
+STATIC int ujson_stream_fill(ujson_stream_t *s) {
+    if (s->read == NULL) {
+        return UJSON_EOF;
+    }
+    int errcode;
+    mp_uint_t n = s->read(s->stream_obj, s->buf, UJSON_STREAM_CHUNK, &errcode);
+    if (n == MP_STREAM_ERROR) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+    }
+    s->cur = s->buf;
+    s->top = s->buf + n;
+    return n == 0 ? UJSON_EOF : *s->cur;
+}
+
+// Current char without consuming it, UJSON_EOF at the end of the input
+static inline int ujson_peek(ujson_stream_t *s) {
+    return s->cur < s->top ? *s->cur : ujson_stream_fill(s);
+}
+
+// Only valid after ujson_peek returned a char
+#define UJSON_NEXT(s) ((s)->cur++)
+
+// Matches the rest of a literal, the first char is the current one
+STATIC bool ujson_match(ujson_stream_t *s, const char *rest) {
+    UJSON_NEXT(s);
+    for (; *rest; rest++) {
+        if (ujson_peek(s) != *rest) {
+            return false;
+        }
+        UJSON_NEXT(s);
+    }
+    return true;
+}
+
+// Skips whitespace and, as separators are not checked, commas and colons
+STATIC int ujson_skip(ujson_stream_t *s) {
+    for (;;) {
+        int c = ujson_peek(s);
+        switch (c) {
+            case ',':
+            case ':':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                UJSON_NEXT(s);
+                break;
+            default:
+                return c;
+        }
+    }
+}
+
+// Only whitespace may follow the document
+STATIC bool ujson_at_end(ujson_stream_t *s) {
+    int c;
+    while ((c = ujson_peek(s)) != UJSON_EOF && unichar_isspace(c)) {
+        UJSON_NEXT(s);
+    }
+    return c == UJSON_EOF;
+}
+
+STATIC NORETURN void ujson_fail(void) {
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "syntax error in JSON"));
+}
+
+
+STATIC mp_obj_t ujson_parse_str(ujson_stream_t *s, vstr_t *vstr, bool is_key) {
+    vstr_reset(vstr);
+    UJSON_NEXT(s);
+    for (;;) {
+        // copy the plain chars available in one go
+        const byte *run = s->cur;
+        while (s->cur < s->top && *s->cur != '"' && *s->cur != '\\') {
+            s->cur++;
+        }
+        vstr_add_strn(vstr, (const char*)run, s->cur - run);
+
+        int c = ujson_peek(s);
+        if (c == UJSON_EOF) {
+            ujson_fail();
+        }
+        if (c == '"') {
+            UJSON_NEXT(s);
+            break;
+        }
+        if (c == '\\') {
+            UJSON_NEXT(s);
+            c = ujson_peek(s);
+            switch (c) {
+                case UJSON_EOF: ujson_fail();
+                case 'b': c = 0x08; break;
+                case 'f': c = 0x0c; break;
+                case 'n': c = 0x0a; break;
+                case 'r': c = 0x0d; break;
+                case 't': c = 0x09; break;
+                case 'u': {
+                    mp_uint_t num = 0;
+                    for (int i = 0; i < 4; i++) {
+                        UJSON_NEXT(s);
+                        c = ujson_peek(s);
+                        if (c == UJSON_EOF) {
+                            ujson_fail();
+                        }
+                        c = (c | 0x20) - '0';
+                        if (c > 9) {
+                            c -= ('a' - ('9' + 1));
+                        }
+                        num = (num << 4) | (c & 0xf);
+                    }
+                    vstr_add_char(vstr, num);
+                    UJSON_NEXT(s);
+                    continue;
+                }
+            }
+        }
+        vstr_add_byte(vstr, c);
+        UJSON_NEXT(s);
+    }
+    // Without make_qstr, an existing qstr is still reused
+    bool make_qstr = false;
+    if (is_key && vstr->len <= UJSON_QSTR_KEY_MAX && s->new_qstrs > 0
+        && qstr_find_strn(vstr->buf, vstr->len) == MP_QSTR_NULL) {
+        s->new_qstrs--;
+        make_qstr = true;
+    }
+    return mp_obj_new_str(vstr->buf, vstr->len, make_qstr);
+}
+
+STATIC mp_obj_t ujson_parse_num(ujson_stream_t *s, vstr_t *vstr) {
+    // Integers which fit a small int are accumulated right away, only other
+    // numbers are collected as text for the generic number parsers.
+    bool neg = false;
+    mp_int_t val = 0;
+    int c = ujson_peek(s);
+    if (c == '-') {
+        neg = true;
+        UJSON_NEXT(s);
+        c = ujson_peek(s);
+    }
+    bool digits = false;
+    for (; c != UJSON_EOF && unichar_isdigit(c); c = ujson_peek(s)) {
+        if (val > (MP_SMALL_INT_MAX - (c - '0')) / 10) {
+            break;
+        }
+        val = val * 10 + (c - '0');
+        digits = true;
+        UJSON_NEXT(s);
+    }
+    if (digits && (c == UJSON_EOF || !(unichar_isdigit(c) || c == '.' || c == 'E' || c == 'e' || c == '-' || c == '+'))) {
+        return MP_OBJ_NEW_SMALL_INT(neg ? -val : val);
+    }
+
+    // the digits so far are exactly val
+    vstr_reset(vstr);
+    if (neg) {
+        vstr_add_byte(vstr, '-');
+    }
+    if (digits) {
+        vstr_printf(vstr, INT_FMT, val);
+    }
+    bool flt = false;
+    for (;;) {
+        c = ujson_peek(s);
+        if (c == '.' || c == 'E' || c == 'e') {
+            flt = true;
+        } else if (c == '-' || c == '+' || (c != UJSON_EOF && unichar_isdigit(c))) {
+            // pass
+        } else {
+            break;
+        }
+        vstr_add_byte(vstr, c);
+        UJSON_NEXT(s);
+    }
+    if (flt) {
+        return mp_parse_num_decimal(vstr->buf, vstr->len, false, false);
+    } else {
+        return mp_parse_num_integer(vstr->buf, vstr->len, 10);
+    }
+}
+
 // This function implements a simple non-recursive JSON parser.
 //
 // The JSON specification is at http://www.ietf.org/rfc/rfc4627.txt
@@ -53,15 +483,11 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 // input is outside it's specs.
 //
 // Most of the work is parsing the primitives (null, false, true, numbers,
-// strings).  It does 1 pass over the input string and so is easily extended to
-// being able to parse from a non-seekable stream.  It tries to be fast and
-// small in code size, while not using more RAM than necessary.
-STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
-    mp_uint_t len;
-    const char *s = mp_obj_str_get_data(obj, &len);
-    const char *top = s + len;
-    vstr_t vstr;
-    vstr_init(&vstr, 8);
+// strings).  It does 1 pass over the input, one char at a time, and stops
+// right after the first complete value, so it works the same on a str and
+// on a stream.  It tries to be fast and small in code size, while not using
+// more RAM than necessary.
+STATIC mp_obj_t ujson_parse_value(ujson_stream_t *s, vstr_t *vstr) {
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
     stack.len = 0;
     stack.items = NULL;
@@ -69,121 +495,55 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     mp_obj_type_t *stack_top_type = NULL;
     mp_obj_t stack_key = MP_OBJ_NULL;
     for (;;) {
-        cont:
-        if (s == top) {
-            break;
-        }
         mp_obj_t next = MP_OBJ_NULL;
         bool enter = false;
-        switch (*s) {
-            case ',':
-            case ':':
-            case ' ':
-            case '\t':
-            case '\n':
-            case '\r':
-                s += 1;
-                goto cont;
+        switch (ujson_skip(s)) {
             case 'n':
-                if (s + 3 < top && s[1] == 'u' && s[2] == 'l' && s[3] == 'l') {
-                    s += 4;
-                    next = mp_const_none;
-                } else {
+                if (!ujson_match(s, "ull")) {
                     goto fail;
                 }
+                next = mp_const_none;
                 break;
             case 'f':
-                if (s + 4 < top && s[1] == 'a' && s[2] == 'l' && s[3] == 's' && s[4] == 'e') {
-                    s += 5;
-                    next = mp_const_false;
-                } else {
+                if (!ujson_match(s, "alse")) {
                     goto fail;
                 }
+                next = mp_const_false;
                 break;
             case 't':
-                if (s + 3 < top && s[1] == 'r' && s[2] == 'u' && s[3] == 'e') {
-                    s += 4;
-                    next = mp_const_true;
-                } else {
+                if (!ujson_match(s, "rue")) {
                     goto fail;
                 }
+                next = mp_const_true;
                 break;
             case '"':
-                vstr_reset(&vstr);
-                for (s++; s < top && *s != '"';) {
-                    byte c = *s;
-                    if (c == '\\') {
-                        s++;
-                        c = *s;
-                        switch (c) {
-                            case 'b': c = 0x08; break;
-                            case 'f': c = 0x0c; break;
-                            case 'n': c = 0x0a; break;
-                            case 'r': c = 0x0d; break;
-                            case 't': c = 0x09; break;
-                            case 'u': {
-                                if (s + 4 >= top) { goto fail; }
-                                mp_uint_t num = 0;
-                                for (int i = 0; i < 4; i++) {
-                                    c = (*++s | 0x20) - '0';
-                                    if (c > 9) {
-                                        c -= ('a' - ('9' + 1));
-                                    }
-                                    num = (num << 4) | c;
-                                }
-                                vstr_add_char(&vstr, num);
-                                goto str_cont;
-                            }
-                        }
-                    }
-                    vstr_add_byte(&vstr, c);
-                str_cont:
-                    s++;
-                }
-                if (s == top) {
-                    goto fail;
-                }
-                s++;
-                next = mp_obj_new_str(vstr.buf, vstr.len, false);
+                next = ujson_parse_str(s, vstr, stack_top_type == &mp_type_dict && stack_key == MP_OBJ_NULL);
                 break;
             case '-':
-            case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
-                bool flt = false;
-                vstr_reset(&vstr);
-                for (; s < top; s++) {
-                    if (*s == '.' || *s == 'E' || *s == 'e') {
-                        flt = true;
-                    } else if (*s == '-' || unichar_isdigit(*s)) {
-                        // pass
-                    } else {
-                        break;
-                    }
-                    vstr_add_byte(&vstr, *s);
-                }
-                if (flt) {
-                    next = mp_parse_num_decimal(vstr.buf, vstr.len, false, false);
-                } else {
-                    next = mp_parse_num_integer(vstr.buf, vstr.len, 10);
-                }
+            case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+                next = ujson_parse_num(s, vstr);
                 break;
-            }
             case '[':
                 next = mp_obj_new_list(0, NULL);
                 enter = true;
-                s += 1;
+                UJSON_NEXT(s);
                 break;
             case '{':
-                next = mp_obj_new_dict(0);
+                // sized like the last dict, records in an array are mostly alike
+                next = mp_obj_new_dict(s->dict_hint);
                 enter = true;
-                s += 1;
+                UJSON_NEXT(s);
                 break;
             case '}':
             case ']': {
-                s += 1;
+                UJSON_NEXT(s);
                 if (stack_top == MP_OBJ_NULL) {
                     // no object at all
                     goto fail;
                 }
+                if (stack_top_type == &mp_type_dict) {
+                    s->dict_hint = mp_obj_dict_len(stack_top);
+                }
                 if (stack.len == 0) {
                     // finished; compound object
                     goto success;
@@ -191,9 +551,10 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
                 stack.len -= 1;
                 stack_top = stack.items[stack.len];
                 stack_top_type = mp_obj_get_type(stack_top);
-                goto cont;
+                continue;
             }
             default:
+                // includes the end of the input
                 goto fail;
         }
         if (stack_top == MP_OBJ_NULL) {
@@ -231,30 +592,134 @@ STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
         }
     }
     success:
-    // eat trailing whitespace
-    while (s < top && unichar_isspace(*s)) {
-        s++;
+    if (stack.items != NULL) {
+        m_del(mp_obj_t, stack.items, stack.alloc);
     }
-    if (s < top) {
+    return stack_top;
+
+    fail:
+    ujson_fail();
+}
+
+STATIC mp_obj_t ujson_parse_all(ujson_stream_t *s) {
+    vstr_t vstr;
+    vstr_init(&vstr, 8);
+    mp_obj_t obj = ujson_parse_value(s, &vstr);
+    if (!ujson_at_end(s)) {
         // unexpected chars
-        goto fail;
-    }
-    if (stack_top == MP_OBJ_NULL || stack.len != 0) {
-        // not exactly 1 object
-        goto fail;
+        ujson_fail();
     }
     vstr_clear(&vstr);
-    return stack_top;
+    return obj;
+}
 
-    fail:
-    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "syntax error in JSON"));
+STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
+    if (!MP_OBJ_IS_STR_OR_BYTES(obj)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "str or bytes required"));
+    }
+    ujson_stream_t s;
+    ujson_stream_init(&s, obj, NULL);
+    return ujson_parse_all(&s);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
 
+// Reads the stream in chunks of UJSON_STREAM_CHUNK bytes, only the result
+// and the str currently parsed are kept in the heap
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_in) {
+    byte buf[UJSON_STREAM_CHUNK];
+    ujson_stream_t s;
+    ujson_stream_init(&s, stream_in, buf);
+    return ujson_parse_all(&s);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
+
+// iterload(stream_or_str) parses only the outermost array or object itself
+// and yields its items (or (key, value) tuples) one at a time, each of them
+// built completely. A large array of records can so be processed with only
+// one record in the heap at once.
+enum {
+    UJSON_ITER_START,
+    UJSON_ITER_LIST,
+    UJSON_ITER_DICT,
+    UJSON_ITER_DONE,
+};
+
+typedef struct _mp_obj_ujson_iter_t {
+    mp_obj_base_t base;
+    ujson_stream_t s;
+    vstr_t vstr;
+    byte state;
+    byte buf[UJSON_STREAM_CHUNK];
+} mp_obj_ujson_iter_t;
+
+STATIC mp_obj_t ujson_iter_iternext(mp_obj_t self_in) {
+    mp_obj_ujson_iter_t *self = self_in;
+    ujson_stream_t *s = &self->s;
+    int c;
+    switch (self->state) {
+        case UJSON_ITER_START:
+            while ((c = ujson_peek(s)) != UJSON_EOF && unichar_isspace(c)) {
+                UJSON_NEXT(s);
+            }
+            if (c == '[') {
+                self->state = UJSON_ITER_LIST;
+            } else if (c == '{') {
+                self->state = UJSON_ITER_DICT;
+            } else {
+                ujson_fail();
+            }
+            UJSON_NEXT(s);
+            break;
+        case UJSON_ITER_DONE:
+            return MP_OBJ_STOP_ITERATION;
+    }
+
+    c = ujson_skip(s);
+    if (c == ']' || c == '}') {
+        UJSON_NEXT(s);
+        self->state = UJSON_ITER_DONE;
+        if (!ujson_at_end(s)) {
+            ujson_fail();
+        }
+        vstr_clear(&self->vstr);
+        return MP_OBJ_STOP_ITERATION;
+    }
+    if (self->state == UJSON_ITER_DICT) {
+        if (c != '"') {
+            ujson_fail();
+        }
+        mp_obj_t pair[2];
+        pair[0] = ujson_parse_str(s, &self->vstr, true);
+        pair[1] = ujson_parse_value(s, &self->vstr);
+        return mp_obj_new_tuple(2, pair);
+    }
+    return ujson_parse_value(s, &self->vstr);
+}
+
+STATIC const mp_obj_type_t ujson_iter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = ujson_iter_iternext,
+};
+
+STATIC mp_obj_t mod_ujson_iterload(mp_obj_t obj) {
+    mp_obj_ujson_iter_t *o = m_new_obj(mp_obj_ujson_iter_t);
+    o->base.type = &ujson_iter_type;
+    ujson_stream_init(&o->s, obj, o->buf);
+    vstr_init(&o->vstr, 8);
+    o->state = UJSON_ITER_START;
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_iterload_obj, mod_ujson_iterload);
+
 STATIC const mp_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ujson) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_dumps), (mp_obj_t)&mod_ujson_dumps_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dump), (mp_obj_t)&mod_ujson_dump_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_loads), (mp_obj_t)&mod_ujson_loads_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_load), (mp_obj_t)&mod_ujson_load_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_iterload), (mp_obj_t)&mod_ujson_iterload_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_ujson_globals, mp_module_ujson_globals_table);
@@ -37,9 +37,13 @@
 #include "re1.5/re1.5.h"
 
 #define FLAG_DEBUG 0x1000
+#define FLAG_BACKTRACK 0x2000
+
+typedef int (*re_exec_fun_t)(ByteProg*, Subject*, const char**, int, int);
 
 typedef struct _mp_obj_re_t {
     mp_obj_base_t base;
+    re_exec_fun_t exec;
     ByteProg re;
 } mp_obj_re_t;
 
@@ -50,6 +54,56 @@ typedef struct _mp_obj_match_t {
     const char *caps[0];
 } mp_obj_match_t;
 
+typedef struct _mp_obj_re_iter_t {
+    mp_obj_base_t base;
+    mp_obj_re_t *re;
+    mp_obj_t str;
+    Subject subj;
+} mp_obj_re_iter_t;
+
+STATIC void re_subject_init(Subject *subj, mp_obj_t str) {
+    mp_uint_t len;
+    subj->begin = mp_obj_str_get_data(str, &len);
+    subj->end = subj->begin + len;
+    subj->begin_line = subj->begin;
+}
+
+// Runs the program, groups which don't take part in the match are left NULL
+STATIC int re_run(mp_obj_re_t *self, Subject *subj, const char **caps, int caps_num, bool is_anchored) {
+    memset(caps, 0, caps_num * sizeof(char*));
+    return self->exec(&self->re, subj, caps, caps_num, is_anchored);
+}
+
+#if MICROPY_PY_BUILTINS_STR_UNICODE
+#define RE_IS_UTF8_CONT(c) (((c) & 0xc0) == 0x80)
+#endif
+
+// Where to search for the next match after one in caps. An empty match
+// doesn't move forward by itself, so the next search starts a char later:
+// a byte for bytes, a whole UTF-8 sequence for str.
+STATIC void re_subject_advance(Subject *subj, const char **caps, mp_obj_t str) {
+    subj->begin = caps[1];
+    if (caps[0] == caps[1]) {
+        subj->begin++;
+        #if MICROPY_PY_BUILTINS_STR_UNICODE
+        if (MP_OBJ_IS_STR(str)) {
+            while (subj->begin < subj->end && RE_IS_UTF8_CONT(*subj->begin)) {
+                subj->begin++;
+            }
+        }
+        #else
+        (void)str;
+        #endif
+    }
+}
+
+STATIC mp_obj_t re_group_str(const char **caps, int no, mp_obj_t unset) {
+    const char *start = caps[no * 2];
+    if (start == NULL) {
+        return unset;
+    }
+    return mp_obj_new_str(start, caps[no * 2 + 1] - start, false);
+}
 
 STATIC void match_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
@@ -57,20 +111,70 @@ STATIC void match_print(void (*print)(void *env, const char *fmt, ...), void *en
     print(env, "<match num=%d @%p>", self->num_matches);
 }
 
-STATIC mp_obj_t match_group(mp_obj_t self_in, mp_obj_t no_in) {
-    mp_obj_match_t *self = self_in;
-    mp_int_t no = mp_obj_int_get_truncated(no_in);
+STATIC int match_group_no(mp_obj_match_t *self, uint n_args, const mp_obj_t *args) {
+    if (n_args < 2) {
+        return 0;
+    }
+    mp_int_t no = mp_obj_int_get_truncated(args[1]);
     if (no < 0 || no >= self->num_matches / 2) {
-        nlr_raise(mp_obj_new_exception_arg1(&mp_type_IndexError, no_in));
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_IndexError, args[1]));
+    }
+    return no;
+}
+
+// Offset of a capture in the subject string, -1 if the group didn't match.
+// Like str indices it counts characters for str, bytes for bytes.
+STATIC mp_obj_t match_offset(mp_obj_match_t *self, int cap) {
+    if (self->caps[cap] == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(-1);
+    }
+    mp_uint_t len;
+    const char *begin = mp_obj_str_get_data(self->str, &len);
+    mp_int_t offset = self->caps[cap] - begin;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE
+    if (MP_OBJ_IS_STR(self->str)) {
+        for (const char *p = begin; p < self->caps[cap]; p++) {
+            if (RE_IS_UTF8_CONT(*p)) {
+                offset--;
+            }
+        }
     }
+    #endif
+    return MP_OBJ_NEW_SMALL_INT(offset);
+}
+
+STATIC mp_obj_t match_group(uint n_args, const mp_obj_t *args) {
+    mp_obj_match_t *self = args[0];
+    int no = match_group_no(self, n_args, args);
+    return re_group_str(self->caps, no, mp_const_none);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_group_obj, 1, 2, match_group);
+
+STATIC mp_obj_t match_start(uint n_args, const mp_obj_t *args) {
+    mp_obj_match_t *self = args[0];
+    return match_offset(self, match_group_no(self, n_args, args) * 2);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_start_obj, 1, 2, match_start);
 
-    const char *start = self->caps[no * 2];
-    return mp_obj_new_str(start, self->caps[no * 2 + 1] - start, false);
+STATIC mp_obj_t match_end(uint n_args, const mp_obj_t *args) {
+    mp_obj_match_t *self = args[0];
+    return match_offset(self, match_group_no(self, n_args, args) * 2 + 1);
 }
-MP_DEFINE_CONST_FUN_OBJ_2(match_group_obj, match_group);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_end_obj, 1, 2, match_end);
+
+STATIC mp_obj_t match_span(uint n_args, const mp_obj_t *args) {
+    mp_obj_match_t *self = args[0];
+    int no = match_group_no(self, n_args, args);
+    mp_obj_t span[2] = {match_offset(self, no * 2), match_offset(self, no * 2 + 1)};
+    return mp_obj_new_tuple(2, span);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_span_obj, 1, 2, match_span);
 
 STATIC const mp_map_elem_t match_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_group), (mp_obj_t) &match_group_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_start), (mp_obj_t) &match_start_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_end), (mp_obj_t) &match_end_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_span), (mp_obj_t) &match_span_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(match_locals_dict, match_locals_dict_table);
@@ -88,16 +192,11 @@ STATIC void re_print(void (*print)(void *env, const char *fmt, ...), void *env,
     print(env, "<re %p>", self);
 }
 
-STATIC mp_obj_t re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
-    (void)n_args;
-    mp_obj_re_t *self = args[0];
-    Subject subj;
-    mp_uint_t len;
-    subj.begin = mp_obj_str_get_data(args[1], &len);
-    subj.end = subj.begin + len;
+// Returns a match object, or None
+STATIC mp_obj_t re_new_match(mp_obj_re_t *self, mp_obj_t str, Subject *subj, bool is_anchored) {
     int caps_num = (self->re.sub + 1) * 2;
     mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    int res = re_run(self, subj, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char*, caps_num, match);
         return mp_const_none;
@@ -105,10 +204,17 @@ STATIC mp_obj_t re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
 
     match->base.type = &match_type;
     match->num_matches = caps_num;
-    match->str = args[1];
+    match->str = str;
     return match;
 }
 
+STATIC mp_obj_t re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
+    (void)n_args;
+    Subject subj;
+    re_subject_init(&subj, args[1]);
+    return re_new_match(args[0], args[1], &subj, is_anchored);
+}
+
 STATIC mp_obj_t re_match(uint n_args, const mp_obj_t *args) {
     return re_exec(true, n_args, args);
 }
@@ -122,9 +228,7 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_search_obj, 2, 4, re_search);
 STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
     mp_obj_re_t *self = args[0];
     Subject subj;
-    mp_uint_t len;
-    subj.begin = mp_obj_str_get_data(args[1], &len);
-    subj.end = subj.begin + len;
+    re_subject_init(&subj, args[1]);
     int caps_num = (self->re.sub + 1) * 2;
 
     int maxsplit = 0;
@@ -135,7 +239,7 @@ STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
     mp_obj_t retval = mp_obj_new_list(0, NULL);
     const char **caps = alloca(caps_num * sizeof(char*));
     while (true) {
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = re_run(self, &subj, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
@@ -144,8 +248,9 @@ STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
 
         mp_obj_t s = mp_obj_new_str(subj.begin, caps[0] - subj.begin, false);
         mp_obj_list_append(retval, s);
-        if (self->re.sub > 0) {
-            mp_not_implemented("Splitting with sub-captures");
+        // Groups go in between, None if they didn't match
+        for (int i = 1; i <= self->re.sub; i++) {
+            mp_obj_list_append(retval, re_group_str(caps, i, mp_const_none));
         }
         subj.begin = caps[1];
         if (maxsplit > 0 && --maxsplit == 0) {
@@ -159,10 +264,187 @@ STATIC mp_obj_t re_split(uint n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_split_obj, 2, 3, re_split);
 
+// Appends repl to vstr, with \1 and \g<1> replaced by the groups and
+// \n, \r, \t and \\ by the chars they stand for
+STATIC void re_sub_expand(vstr_t *vstr, const char *repl, mp_uint_t repl_len, const char **caps, int num_groups) {
+    const char *end = repl + repl_len;
+    while (repl < end) {
+        // Copy up to the next backslash in one go
+        const char *run = repl;
+        while (repl < end && *repl != '\\') {
+            repl++;
+        }
+        vstr_add_strn(vstr, run, repl - run);
+        if (repl + 1 >= end) {
+            vstr_add_strn(vstr, repl, end - repl);
+            break;
+        }
+
+        int no = -1;
+        const char *next = repl + 2;
+        if (unichar_isdigit(repl[1])) {
+            no = repl[1] - '0';
+        } else if (repl[1] == 'g' && next < end && *next == '<') {
+            no = 0;
+            for (next++; next < end && unichar_isdigit(*next); next++) {
+                no = no * 10 + *next - '0';
+            }
+            if (next == repl + 3 || next == end || *next != '>') {
+                nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Bad group reference"));
+            }
+            next++;
+        }
+
+        if (no < 0) {
+            char c = repl[1];
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case '\\': break;
+                default:
+                    // Unknown escape, keep the backslash
+                    vstr_add_byte(vstr, '\\');
+                    break;
+            }
+            vstr_add_byte(vstr, c);
+        } else if (no > num_groups) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Bad group reference"));
+        } else if (caps[no * 2] != NULL) {
+            vstr_add_strn(vstr, caps[no * 2], caps[no * 2 + 1] - caps[no * 2]);
+        }
+        repl = next;
+    }
+}
+
+STATIC mp_obj_t re_sub_helper(mp_obj_re_t *self, mp_obj_t repl, mp_obj_t str, mp_int_t count) {
+    Subject subj;
+    re_subject_init(&subj, str);
+    int caps_num = (self->re.sub + 1) * 2;
+    const char **caps = alloca(caps_num * sizeof(char*));
+
+    mp_uint_t repl_len = 0;
+    const char *repl_str = NULL;
+    if (MP_OBJ_IS_STR(repl)) {
+        repl_str = mp_obj_str_get_data(repl, &repl_len);
+    } else if (!mp_obj_is_callable(repl)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "repl must be str or callable"));
+    }
+
+    // The result is built up in one vstr, from the parts of the subject
+    // between the matches and the replacements
+    vstr_t vstr;
+    vstr_init(&vstr, subj.end - subj.begin + 1);
+    const char *copied = subj.begin;
+    for (mp_int_t n = 0; count <= 0 || n < count; n++) {
+        if (subj.begin > subj.end || !re_run(self, &subj, caps, caps_num, false)) {
+            break;
+        }
+
+        vstr_add_strn(&vstr, copied, caps[0] - copied);
+        if (repl_str != NULL) {
+            re_sub_expand(&vstr, repl_str, repl_len, caps, self->re.sub);
+        } else {
+            mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
+            match->base.type = &match_type;
+            match->num_matches = caps_num;
+            match->str = str;
+            memcpy(match->caps, caps, caps_num * sizeof(char*));
+            mp_uint_t len;
+            const char *s = mp_obj_str_get_data(mp_call_function_1(repl, match), &len);
+            vstr_add_strn(&vstr, s, len);
+        }
+        copied = caps[1];
+        re_subject_advance(&subj, caps, str);
+    }
+    vstr_add_strn(&vstr, copied, subj.end - copied);
+
+    return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+}
+
+STATIC mp_obj_t re_sub(uint n_args, const mp_obj_t *args) {
+    mp_int_t count = 0;
+    if (n_args > 3) {
+        count = mp_obj_get_int(args[3]);
+    }
+    return re_sub_helper(args[0], args[1], args[2], count);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_sub_obj, 3, 4, re_sub);
+
+STATIC mp_obj_t re_findall_helper(mp_obj_re_t *self, mp_obj_t str) {
+    Subject subj;
+    re_subject_init(&subj, str);
+    int caps_num = (self->re.sub + 1) * 2;
+    const char **caps = alloca(caps_num * sizeof(char*));
+
+    // Like CPython: the whole match without groups, the group with one,
+    // else a tuple of all groups
+    mp_obj_t retval = mp_obj_new_list(0, NULL);
+    while (subj.begin <= subj.end && re_run(self, &subj, caps, caps_num, false)) {
+        mp_obj_t item;
+        if (self->re.sub <= 1) {
+            item = re_group_str(caps, self->re.sub, MP_OBJ_NEW_QSTR(MP_QSTR_));
+        } else {
+            mp_obj_t groups[self->re.sub];
+            for (int i = 0; i < self->re.sub; i++) {
+                groups[i] = re_group_str(caps, i + 1, MP_OBJ_NEW_QSTR(MP_QSTR_));
+            }
+            item = mp_obj_new_tuple(self->re.sub, groups);
+        }
+        mp_obj_list_append(retval, item);
+        re_subject_advance(&subj, caps, str);
+    }
+    return retval;
+}
+
+STATIC mp_obj_t re_findall(mp_obj_t self_in, mp_obj_t str) {
+    return re_findall_helper(self_in, str);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(re_findall_obj, re_findall);
+
+STATIC mp_obj_t re_iter_iternext(mp_obj_t self_in) {
+    mp_obj_re_iter_t *self = self_in;
+    if (self->subj.begin > self->subj.end) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_match_t *match = re_new_match(self->re, self->str, &self->subj, false);
+    if (match == mp_const_none) {
+        self->subj.begin = self->subj.end + 1;
+        return MP_OBJ_STOP_ITERATION;
+    }
+    re_subject_advance(&self->subj, match->caps, self->str);
+    return match;
+}
+
+STATIC const mp_obj_type_t re_iter_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = re_iter_iternext,
+};
+
+// Matches are only searched for as the iterator is advanced
+STATIC mp_obj_t re_finditer_helper(mp_obj_re_t *self, mp_obj_t str) {
+    mp_obj_re_iter_t *o = m_new_obj(mp_obj_re_iter_t);
+    o->base.type = &re_iter_type;
+    o->re = self;
+    o->str = str;
+    re_subject_init(&o->subj, str);
+    return o;
+}
+
+STATIC mp_obj_t re_finditer(mp_obj_t self_in, mp_obj_t str) {
+    return re_finditer_helper(self_in, str);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(re_finditer_obj, re_finditer);
+
 STATIC const mp_map_elem_t re_locals_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_match), (mp_obj_t) &re_match_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_search), (mp_obj_t) &re_search_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_split), (mp_obj_t) &re_split_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub), (mp_obj_t) &re_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_findall), (mp_obj_t) &re_findall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_finditer), (mp_obj_t) &re_finditer_obj },
 };
 
 STATIC MP_DEFINE_CONST_DICT(re_locals_dict, re_locals_dict_table);
@@ -174,29 +456,140 @@ STATIC const mp_obj_type_t re_type = {
     .locals_dict = (mp_obj_t)&re_locals_dict,
 };
 
-STATIC mp_obj_t mod_re_compile(uint n_args, const mp_obj_t *args) {
-    const char *re_str = mp_obj_str_get_str(args[0]);
+// Whether the program has any choice points (?, *, +, |) past the search prefix.
+// Without them the backtracker never backtracks, so it's linear too.
+STATIC bool re_has_branches(const ByteProg *prog) {
+    const char *pc = prog->insts + NON_ANCHORED_PREFIX;
+    const char *end = prog->insts + prog->bytelen;
+    while (pc < end) {
+        switch (*pc++) {
+            case Split:
+            case RSplit:
+                return true;
+            case Class:
+            case ClassNot:
+                pc += *(unsigned char*)pc * 2 + 1;
+                break;
+            case Char:
+            case Jmp:
+            case Save:
+                pc++;
+                break;
+        }
+    }
+    return false;
+}
+
+STATIC mp_obj_re_t *re_compile(mp_obj_t re_in, int flags) {
+    const char *re_str = mp_obj_str_get_str(re_in);
     int size = re1_5_sizecode(re_str);
     mp_obj_re_t *o = m_new_obj_var(mp_obj_re_t, char, size);
     o->base.type = &re_type;
-    int flags = 0;
-    if (n_args > 1) {
-        flags = mp_obj_get_int(args[1]);
-    }
     int error = re1_5_compilecode(&o->re, re_str);
     if (error != 0) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Error in regex"));
     }
+    // Patterns which can backtrack run on the Pike VM: it's linear in the
+    // length of the input and its recursion depth is bounded by the size of
+    // the pattern, so untrusted input can't blow up the run time or the C
+    // stack. BACKTRACK forces the backtracker, which is faster for trusted
+    // input.
+    if ((flags & FLAG_BACKTRACK) || !re_has_branches(&o->re)) {
+        o->exec = re1_5_recursiveloopprog;
+    } else {
+        o->exec = re1_5_pikevm;
+    }
     if (flags & FLAG_DEBUG) {
         re1_5_dumpcode(&o->re);
     }
     return o;
 }
+
+STATIC mp_obj_t mod_re_compile(uint n_args, const mp_obj_t *args) {
+    int flags = 0;
+    if (n_args > 1) {
+        flags = mp_obj_get_int(args[1]);
+    }
+    return re_compile(args[0], flags);
+}
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_compile_obj, 1, 2, mod_re_compile);
 
+// Compiled patterns of the module-level functions, most recently used first.
+// The array lives in the heap, pointed to by a root pointer, and is created
+// on first use. A port enables it by defining MICROPY_PY_URE_CACHE and adding
+// "void *ure_cache;" to MICROPY_PORT_ROOT_POINTERS; otherwise every call
+// compiles its pattern afresh.
+#ifndef MICROPY_PY_URE_CACHE
+#define MICROPY_PY_URE_CACHE (0)
+#endif
+
+#if MICROPY_PY_URE_CACHE
+
+#define RE_CACHE_SIZE (8)
+
+typedef struct _re_cache_entry_t {
+    mp_obj_t pattern;
+    int flags;
+    mp_obj_re_t *re;
+} re_cache_entry_t;
+
+STATIC mp_obj_re_t *re_cache_get(mp_obj_t pattern, int flags) {
+    re_cache_entry_t *cache = MP_STATE_VM(ure_cache);
+    if (cache == NULL) {
+        cache = m_new0(re_cache_entry_t, RE_CACHE_SIZE);
+        MP_STATE_VM(ure_cache) = cache;
+    }
+
+    mp_uint_t len;
+    const char *str = mp_obj_str_get_data(pattern, &len);
+    re_cache_entry_t entry;
+    int i;
+    for (i = 0; i < RE_CACHE_SIZE && cache[i].re != NULL; i++) {
+        if (cache[i].flags != flags) {
+            continue;
+        }
+        if (cache[i].pattern == pattern) {
+            break;
+        }
+        mp_uint_t cached_len;
+        const char *cached_str = mp_obj_str_get_data(cache[i].pattern, &cached_len);
+        if (cached_len == len && memcmp(cached_str, str, len) == 0) {
+            break;
+        }
+    }
+
+    if (i < RE_CACHE_SIZE && cache[i].re != NULL) {
+        entry = cache[i];
+    } else {
+        // Compile before touching the cache, it may raise
+        entry.pattern = pattern;
+        entry.flags = flags;
+        entry.re = re_compile(pattern, flags);
+        if (i == RE_CACHE_SIZE) {
+            // Drop the least recently used one
+            i--;
+        }
+    }
+
+    memmove(cache + 1, cache, i * sizeof(*cache));
+    cache[0] = entry;
+    return entry.re;
+}
+
+#else
+
+STATIC mp_obj_re_t *re_cache_get(mp_obj_t pattern, int flags) {
+    return re_compile(pattern, flags);
+}
+
+#endif // MICROPY_PY_URE_CACHE
+
 STATIC mp_obj_t mod_re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
-    (void)n_args;
-    mp_obj_re_t *self = mod_re_compile(1, args);
+    int flags = 0;
+    if (n_args > 2) {
+        flags = mp_obj_get_int(args[2]);
+    }
+    mp_obj_re_t *self = re_cache_get(args[0], flags);
 
     const mp_obj_t args2[] = {self, args[1]};
     mp_obj_match_t *match = re_exec(is_anchored, 2, args2);
@@ -213,12 +606,56 @@ STATIC mp_obj_t mod_re_search(uint n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
+STATIC mp_obj_t mod_re_sub(uint n_args, const mp_obj_t *args) {
+    mp_int_t count = 0;
+    if (n_args > 3) {
+        count = mp_obj_get_int(args[3]);
+    }
+    int flags = 0;
+    if (n_args > 4) {
+        flags = mp_obj_get_int(args[4]);
+    }
+    return re_sub_helper(re_cache_get(args[0], flags), args[1], args[2], count);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_sub_obj, 3, 5, mod_re_sub);
+
+STATIC mp_obj_t mod_re_findall(uint n_args, const mp_obj_t *args) {
+    int flags = 0;
+    if (n_args > 2) {
+        flags = mp_obj_get_int(args[2]);
+    }
+    return re_findall_helper(re_cache_get(args[0], flags), args[1]);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_findall_obj, 2, 3, mod_re_findall);
+
+STATIC mp_obj_t mod_re_finditer(uint n_args, const mp_obj_t *args) {
+    int flags = 0;
+    if (n_args > 2) {
+        flags = mp_obj_get_int(args[2]);
+    }
+    return re_finditer_helper(re_cache_get(args[0], flags), args[1]);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_finditer_obj, 2, 3, mod_re_finditer);
+
+STATIC mp_obj_t mod_re_purge(void) {
+    #if MICROPY_PY_URE_CACHE
+    MP_STATE_VM(ure_cache) = NULL;
+    #endif
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(mod_re_purge_obj, mod_re_purge);
+
 STATIC const mp_map_elem_t mp_module_re_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ure) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_compile), (mp_obj_t)&mod_re_compile_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_match), (mp_obj_t)&mod_re_match_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_search), (mp_obj_t)&mod_re_search_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub), (mp_obj_t)&mod_re_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_findall), (mp_obj_t)&mod_re_findall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_finditer), (mp_obj_t)&mod_re_finditer_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_purge), (mp_obj_t)&mod_re_purge_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_DEBUG), MP_OBJ_NEW_SMALL_INT(FLAG_DEBUG) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BACKTRACK), MP_OBJ_NEW_SMALL_INT(FLAG_BACKTRACK) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_re_globals, mp_module_re_globals_table);
@@ -233,9 +670,12 @@ const mp_obj_module_t mp_module_ure = {
 // only if module is enabled by config setting.
 
 #define re1_5_fatal(x) assert(!x)
+#define re1_5_alloc(n) m_new(char, n)
+#define re1_5_free(p, n) m_del(char, p, n)
 #include "re1.5/compilecode.c"
 #include "re1.5/dumpcode.c"
 #include "re1.5/recursiveloop.c"
+#include "re1.5/pikevm.c"
 #include "re1.5/charclass.c"
 
 #endif //MICROPY_PY_URE
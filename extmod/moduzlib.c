@@ -30,9 +30,11 @@
 #include <time.h>
 #include <sys/time.h>
 #include <math.h>
+#include <errno.h>
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/stream.h"
 
 #if MICROPY_PY_UZLIB
 
@@ -68,6 +70,8 @@ STATIC mp_obj_t mod_uzlib_decompress(mp_uint_t n_args, const mp_obj_t *args) {
     DEBUG_printf("uzlib: Initial out buffer: " UINT_FMT " bytes\n", decomp->destSize);
     decomp->destGrow = mod_uzlib_grow_buf;
     decomp->source = bufinfo.buf;
+    decomp->sourceLimit = decomp->source + bufinfo.len;
+    decomp->readSource = NULL;
 
     int st;
     if (n_args > 1 && MP_OBJ_SMALL_INT_VALUE(args[1]) < 0) {
@@ -88,9 +92,381 @@ STATIC mp_obj_t mod_uzlib_decompress(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+// DecompIO(stream, wbits=0) inflates the data read from stream as it is
+// itself read. Only a window of the last output, the state of the decoder
+// and a small input buffer are kept, however long the data is.
+// wbits 8..15 expect zlib data and set the window to 1 << wbits bytes,
+// 0 takes the window size from the zlib header, -8..-15 expect raw deflate.
+// Matches reaching back further than the window are a data error.
+
+#define DECOMPIO_BUF_SIZE (128)
+
+typedef struct _mp_obj_decompio_t {
+    mp_obj_base_t base;
+    mp_obj_t src_stream;
+    bool is_zlib;
+    bool eof;
+    uint32_t adler;
+    TINF_DATA decomp;
+    byte buf[DECOMPIO_BUF_SIZE];
+} mp_obj_decompio_t;
+
+STATIC void decompio_raise(int st) {
+    nlr_raise(mp_obj_new_exception_arg1(&mp_type_ValueError, MP_OBJ_NEW_SMALL_INT(st)));
+}
+
+STATIC int decompio_read_source(TINF_DATA *d) {
+    mp_obj_decompio_t *o = (mp_obj_decompio_t*)((byte*)d - offsetof(mp_obj_decompio_t, decomp));
+    const mp_stream_p_t *stream_p = mp_obj_get_type(o->src_stream)->stream_p;
+    int errcode;
+    mp_uint_t n = stream_p->read(o->src_stream, o->buf, DECOMPIO_BUF_SIZE, &errcode);
+    if (n == MP_STREAM_ERROR) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+    }
+    if (n == 0) {
+        return -1;
+    }
+    d->source = o->buf;
+    d->sourceLimit = o->buf + n;
+    return 0;
+}
+
+STATIC mp_obj_t decompio_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_obj_type_t *type = mp_obj_get_type(args[0]);
+    if (type->stream_p == NULL || type->stream_p->read == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "object with stream.read required"));
+    }
+    mp_int_t wbits = 0;
+    if (n_args > 1) {
+        wbits = mp_obj_get_int(args[1]);
+    }
+    if (wbits < 0 ? (wbits > -8 || wbits < -15) : (wbits != 0 && (wbits < 8 || wbits > 15))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "wbits out of range"));
+    }
+
+    mp_obj_decompio_t *o = m_new_obj(mp_obj_decompio_t);
+    o->base.type = type_in;
+    o->src_stream = args[0];
+    o->is_zlib = wbits >= 0;
+    o->eof = false;
+    o->adler = 1;
+    o->decomp.source = o->decomp.sourceLimit = o->buf;
+    o->decomp.readSource = decompio_read_source;
+    // The header is read before tinf_uncompress_stream_init sets up the rest,
+    // but already goes through the bit buffer
+    o->decomp.tag = 0;
+    o->decomp.bitcount = 0;
+
+    if (o->is_zlib) {
+        int header_bits = tinf_zlib_parse_header(&o->decomp);
+        if (header_bits < 0) {
+            decompio_raise(header_bits);
+        }
+        if (wbits == 0) {
+            wbits = header_bits;
+        }
+    } else {
+        wbits = -wbits;
+    }
+    tinf_uncompress_stream_init(&o->decomp, m_new(byte, 1 << wbits), wbits);
+    return o;
+}
+
+STATIC mp_uint_t decompio_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *errcode) {
+    (void)errcode;
+    mp_obj_decompio_t *o = o_in;
+    if (o->eof) {
+        return 0;
+    }
+
+    o->decomp.dest = buf;
+    o->decomp.destRemaining = size;
+    int st = tinf_uncompress_stream(&o->decomp);
+    if (st < 0) {
+        decompio_raise(st);
+    }
+    mp_uint_t n = o->decomp.dest - (byte*)buf;
+    if (o->is_zlib) {
+        o->adler = tinf_adler32_update(o->adler, buf, n);
+    }
+
+    if (st == TINF_DONE) {
+        o->eof = true;
+        if (o->is_zlib) {
+            uint32_t a32 = 0;
+            for (int i = 0; i < 4; i++) {
+                int c = tinf_read_byte(&o->decomp);
+                if (c < 0) {
+                    decompio_raise(TINF_DATA_ERROR);
+                }
+                a32 = (a32 << 8) | c;
+            }
+            if (a32 != o->adler) {
+                decompio_raise(TINF_DATA_ERROR);
+            }
+        }
+    }
+    return n;
+}
+
+STATIC const mp_map_elem_t decompio_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_read), (mp_obj_t)&mp_stream_read_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readall), (mp_obj_t)&mp_stream_readall_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&mp_stream_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readline), (mp_obj_t)&mp_stream_unbuffered_readline_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(decompio_locals_dict, decompio_locals_dict_table);
+
+STATIC const mp_stream_p_t decompio_stream_p = {
+    .read = decompio_read,
+};
+
+STATIC const mp_obj_type_t decompio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_DecompIO,
+    .make_new = decompio_make_new,
+    .getiter = mp_identity,
+    .iternext = mp_stream_unbuffered_iter,
+    .stream_p = &decompio_stream_p,
+    .locals_dict = (mp_obj_t)&decompio_locals_dict,
+};
+
+// Compression. wbits selects the framing and the window, like for
+// decompression: 9..15 give zlib data, -9..-15 raw deflate and 25..31 gzip
+// data, with a window of 1 << (wbits & 15) bytes. memlevel 1..9 sets the
+// size of the hash table and of the symbol buffer which makes up a block.
+// Level 0 only stores the data and needs no more than the window.
+
+enum { UZLIB_RAW, UZLIB_ZLIB, UZLIB_GZIP };
+
+typedef struct _uzlib_comp_t {
+    TINF_DEFLATE d;
+    byte format;
+    uint32_t check;
+    uint32_t size;
+} uzlib_comp_t;
+
+STATIC void uzlib_comp_init(uzlib_comp_t *c, mp_uint_t n_args, const mp_obj_t *args) {
+    mp_int_t level = 6, wbits = 15, memlevel = 8;
+    if (n_args > 0) {
+        level = mp_obj_get_int(args[0]);
+    }
+    if (n_args > 1) {
+        wbits = mp_obj_get_int(args[1]);
+    }
+    if (n_args > 2) {
+        memlevel = mp_obj_get_int(args[2]);
+    }
+    if (level < 0 || level > 9) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "level out of range"));
+    }
+    if (memlevel < 1 || memlevel > 9) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "memlevel out of range"));
+    }
+    if (wbits < 0) {
+        c->format = UZLIB_RAW;
+        wbits = -wbits;
+    } else if (wbits > 16) {
+        c->format = UZLIB_GZIP;
+        wbits -= 16;
+    } else {
+        c->format = UZLIB_ZLIB;
+    }
+    if (wbits < TINF_DEFLATE_MIN_WBITS || wbits > TINF_DEFLATE_MAX_WBITS) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "wbits out of range"));
+    }
+
+    TINF_DEFLATE *d = &c->d;
+    mp_uint_t hbits = memlevel + 6;
+    d->window = m_new(byte, TINF_DEFLATE_WINDOW_SIZE(wbits));
+    d->head = NULL;
+    d->prev = NULL;
+    d->syms = NULL;
+    d->sbits = hbits;
+    if (level > 0) {
+        d->head = (unsigned short*)m_new(byte, TINF_DEFLATE_HASH_SIZE(hbits));
+        d->prev = (unsigned short*)m_new(byte, TINF_DEFLATE_PREV_SIZE(wbits));
+        d->syms = m_new(byte, TINF_DEFLATE_SYMS_SIZE(hbits));
+    }
+    c->size = 0;
+
+    byte hdr[10];
+    mp_uint_t hdr_len = 0;
+    if (c->format == UZLIB_ZLIB) {
+        c->check = 1;
+        hdr[0] = ((wbits - 8) << 4) | 8;
+        hdr[1] = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+        hdr[1] |= (31 - ((hdr[0] << 8) | hdr[1]) % 31) % 31;
+        hdr_len = 2;
+    } else if (c->format == UZLIB_GZIP) {
+        static const byte gzip_hdr[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        c->check = 0;
+        memcpy(hdr, gzip_hdr, 10);
+        hdr[8] = level == 9 ? 2 : level == 1 ? 4 : 0;
+        hdr_len = 10;
+    }
+    if (hdr_len > 0) {
+        d->write(d, hdr, hdr_len);
+    }
+    tinf_deflate_init(d, wbits, hbits, level);
+}
+
+STATIC void uzlib_comp_write(uzlib_comp_t *c, const void *buf, mp_uint_t len) {
+    if (c->format == UZLIB_ZLIB) {
+        c->check = tinf_adler32_update(c->check, buf, len);
+    } else if (c->format == UZLIB_GZIP) {
+        c->check = tinf_crc32_update(c->check, buf, len);
+    }
+    c->size += len;
+    tinf_deflate_write(&c->d, buf, len);
+}
+
+// Writes the end of the data and frees the buffers
+STATIC void uzlib_comp_finish(uzlib_comp_t *c) {
+    TINF_DEFLATE *d = &c->d;
+    tinf_deflate_finish(d);
+
+    byte trailer[8];
+    if (c->format == UZLIB_ZLIB) {
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = c->check >> (24 - 8 * i);
+        }
+        d->write(d, trailer, 4);
+    } else if (c->format == UZLIB_GZIP) {
+        for (int i = 0; i < 4; i++) {
+            trailer[i] = c->check >> (8 * i);
+            trailer[4 + i] = c->size >> (8 * i);
+        }
+        d->write(d, trailer, 8);
+    }
+
+    m_del(byte, d->window, TINF_DEFLATE_WINDOW_SIZE(d->wbits));
+    if (d->level > 0) {
+        m_del(byte, d->head, TINF_DEFLATE_HASH_SIZE(d->hbits));
+        m_del(byte, d->prev, TINF_DEFLATE_PREV_SIZE(d->wbits));
+        m_del(byte, d->syms, TINF_DEFLATE_SYMS_SIZE(d->sbits));
+    }
+    d->window = NULL;
+}
+
+STATIC void mod_uzlib_compress_out(TINF_DEFLATE *d, const unsigned char *buf, unsigned int len) {
+    vstr_add_strn(d->user, (const char*)buf, len);
+}
+
+STATIC mp_obj_t mod_uzlib_compress(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    vstr_init(&vstr, bufinfo.len / 4 + 16);
+    uzlib_comp_t c;
+    c.d.write = mod_uzlib_compress_out;
+    c.d.user = &vstr;
+    uzlib_comp_init(&c, n_args - 1, args + 1);
+    uzlib_comp_write(&c, bufinfo.buf, bufinfo.len);
+    uzlib_comp_finish(&c);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 4, mod_uzlib_compress);
+
+// CompIO(stream, level=6, wbits=15, memlevel=8) compresses what is written
+// to it into stream. close() writes the end of the data, but leaves stream
+// open.
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    mp_obj_t dest_stream;
+    uzlib_comp_t comp;
+} mp_obj_compio_t;
+
+STATIC void compio_out(TINF_DEFLATE *d, const unsigned char *buf, unsigned int len) {
+    mp_obj_t stream = ((mp_obj_compio_t*)d->user)->dest_stream;
+    const mp_stream_p_t *stream_p = mp_obj_get_type(stream)->stream_p;
+    while (len > 0) {
+        int errcode;
+        mp_uint_t n = stream_p->write(stream, buf, len, &errcode);
+        if (n == MP_STREAM_ERROR) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode)));
+        }
+        if (n == 0) {
+            // Retrying would spin forever
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(EIO)));
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+STATIC mp_obj_t compio_make_new(mp_obj_t type_in, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 4, false);
+    mp_obj_type_t *type = mp_obj_get_type(args[0]);
+    if (type->stream_p == NULL || type->stream_p->write == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "object with stream.write required"));
+    }
+
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type_in;
+    o->dest_stream = args[0];
+    o->comp.d.write = compio_out;
+    o->comp.d.user = o;
+    uzlib_comp_init(&o->comp, n_args - 1, args + 1);
+    return o;
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = o_in;
+    if (o->comp.d.window == NULL) {
+        *errcode = EBADF;
+        return MP_STREAM_ERROR;
+    }
+    uzlib_comp_write(&o->comp, buf, size);
+    return size;
+}
+
+STATIC mp_obj_t compio_close(mp_obj_t self_in) {
+    mp_obj_compio_t *o = self_in;
+    if (o->comp.d.window != NULL) {
+        uzlib_comp_finish(&o->comp);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(compio_close_obj, compio_close);
+
+STATIC mp_obj_t compio___exit__(mp_uint_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return compio_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compio___exit___obj, 4, 4, compio___exit__);
+
+STATIC const mp_map_elem_t compio_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_write), (mp_obj_t)&mp_stream_write_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&compio_close_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___enter__), (mp_obj_t)&mp_identity_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___exit__), (mp_obj_t)&compio___exit___obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompIO,
+    .make_new = compio_make_new,
+    .stream_p = &compio_stream_p,
+    .locals_dict = (mp_obj_t)&compio_locals_dict,
+};
+
 STATIC const mp_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_uzlib) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_decompress), (mp_obj_t)&mod_uzlib_decompress_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_DecompIO), (mp_obj_t)&decompio_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compress), (mp_obj_t)&mod_uzlib_compress_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_CompIO), (mp_obj_t)&compio_type },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -107,5 +483,7 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinflate.c"
 #include "uzlib/tinfzlib.c"
 #include "uzlib/adler32.c"
+#include "uzlib/crc32.c"
+#include "uzlib/deflate.c"
 
 #endif // MICROPY_PY_UZLIB
@@ -11,3 +11,34 @@ int _re1_5_classmatch(const char *pc, const char *sp)
     }
     return !is_positive;
 }
+
+#define INFIRST(prog, c) ((prog)->first[(unsigned char)(c) >> 3] & (1 << ((unsigned char)(c) & 7)))
+
+// Whether an unanchored search may find a match starting at sp
+int re1_5_iscandidate(ByteProg *prog, const char *sp, const char *end)
+{
+    if (sp >= end || !INFIRST(prog, *sp)) return 0;
+    if (prog->prefixlen > 1) {
+        return end - sp >= prog->prefixlen && memcmp(sp, prog->prefix, prog->prefixlen) == 0;
+    }
+    return 1;
+}
+
+// Next position from sp on where a match can start, or nil if there's none.
+// Only valid if prog->hasfirst is set.
+const char *re1_5_skip(ByteProg *prog, const char *sp, const char *end)
+{
+    if (prog->prefixlen > 0) {
+        while (sp < end) {
+            sp = memchr(sp, (unsigned char)prog->prefix[0], end - sp);
+            if (sp == nil) return nil;
+            if (re1_5_iscandidate(prog, sp, end)) return sp;
+            sp++;
+        }
+        return nil;
+    }
+    for (; sp < end; sp++) {
+        if (INFIRST(prog, *sp)) return sp;
+    }
+    return nil;
+}
@@ -188,6 +188,90 @@ const char *_compilecode(const char *re, ByteProg *prog)
     return re;
 }
 
+#define SETFIRST(prog, c) ((prog)->first[(unsigned char)(c) >> 3] |= 1 << ((c) & 7))
+
+// Adds the bytes which the code at pc can consume first to prog->first.
+// Returns 0 if that can be any byte, or nothing (the empty string matches).
+static int _firstset(ByteProg *prog, const char *pc, int depth)
+{
+    int c, cnt, in, i;
+
+    // Don't recurse without bound on deeply nested alternations
+    if (depth > 10)
+        return 0;
+
+    for (;;) {
+        switch (*pc) {
+        case Char:
+            SETFIRST(prog, pc[1]);
+            return 1;
+        case Class:
+        case ClassNot:
+            cnt = (unsigned char)pc[1];
+            for (c = 0; c < 256; c++) {
+                in = 0;
+                for (i = 0; i < cnt; i++) {
+                    if ((char)c >= pc[2 + 2 * i] && (char)c <= pc[3 + 2 * i]) {
+                        in = 1;
+                        break;
+                    }
+                }
+                if (in == (*pc == Class))
+                    SETFIRST(prog, c);
+            }
+            return 1;
+        case Jmp:
+            // A backward jump closes a loop whose start is already on
+            // this path, so it adds no first bytes. Following it would go
+            // round forever when the loop body can be empty, as in "(a*)+".
+            if ((signed char)pc[1] < 0)
+                return 1;
+            pc += (signed char)pc[1] + 2;
+            break;
+        case Split:
+        case RSplit:
+            if (!_firstset(prog, pc + 2, depth + 1))
+                return 0;
+            if ((signed char)pc[1] < 0)
+                return 1;
+            pc += (signed char)pc[1] + 2;
+            break;
+        case Save:
+            pc += 2;
+            break;
+        default:
+            // Any, Bol, Eol, Match
+            return 0;
+        }
+    }
+}
+
+// Finds what an unanchored search can look for before running the program:
+// the literal every match starts with, else the set of possible first bytes.
+static void _findprefix(ByteProg *prog)
+{
+    // Right after "Save 0"
+    const char *start = prog->insts + NON_ANCHORED_PREFIX + 2;
+    const char *pc = start;
+
+    prog->prefixlen = 0;
+    memset(prog->first, 0, sizeof(prog->first));
+    for (; *pc == Char || *pc == Save; pc += 2) {
+        if (*pc == Char) {
+            if (prog->prefixlen == MAXPREFIX)
+                break;
+            prog->prefix[prog->prefixlen++] = pc[1];
+        }
+    }
+
+    if (prog->prefixlen > 0) {
+        SETFIRST(prog, prog->prefix[0]);
+        prog->hasfirst = 1;
+    } else {
+        prog->hasfirst = _firstset(prog, start, 0);
+    }
+}
+
 int re1_5_compilecode(ByteProg *prog, const char *re)
 {
     prog->len = 0;
@@ -217,6 +301,8 @@ int re1_5_compilecode(ByteProg *prog, const char *re)
     prog->insts[prog->bytelen++] = Match;
     prog->len++;
 
+    _findprefix(prog);
+
     return 0;
 }
 
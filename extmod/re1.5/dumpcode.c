@@ -59,4 +59,9 @@ void re1_5_dumpcode(ByteProg *prog)
                 }
     }
     printf("Bytes: %d, insts: %d\n", prog->bytelen, prog->len);
+    if (prog->prefixlen > 0) {
+        printf("Prefix: %.*s\n", prog->prefixlen, prog->prefix);
+    } else if (prog->hasfirst) {
+        printf("First bytes known\n");
+    }
 }
@@ -0,0 +1,199 @@
+// Copyright 2007-2009 Russ Cox.  All Rights Reserved.
+// Copyright 2014 Paul Sokolovsky.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "re1.5.h"
+
+// Pike VM: all threads advance over the input in lockstep, one character
+// at a time. Each pc is run by at most one thread per step, so matching is
+// O(len(input) * len(prog)) and the thread lists are sized by the program
+// alone. addthread() recurses over Split and Save, but at most once per pc,
+// so its depth is bounded by the program too, not by the input. Threads are
+// kept in priority order, which gives the same (leftmost, first alternative)
+// result as the backtracking executors.
+
+#ifndef re1_5_alloc
+#define re1_5_alloc(n) malloc(n)
+#define re1_5_free(p, n) free(p)
+#endif
+
+typedef struct ThreadList ThreadList;
+
+struct ThreadList
+{
+	int n;
+	const char **pc;
+	const char **sub;	// nsubp entries per thread
+};
+
+typedef struct PikeVM PikeVM;
+
+struct PikeVM
+{
+	const char *insts;
+	Subject *input;
+	int nsubp;
+	int gen;
+	int *mark;		// generation in which each pc was last added
+};
+
+static void
+addthread(PikeVM *vm, ThreadList *l, const char *pc, const char *sp, const char **sub)
+{
+	const char *old;
+	int off;
+
+	for(;;) {
+		off = pc - vm->insts;
+		if(vm->mark[off] == vm->gen)
+			return;
+		vm->mark[off] = vm->gen;
+
+		switch(*pc) {
+		case Jmp:
+			pc += (signed char)pc[1] + 2;
+			continue;
+		case Split:
+			addthread(vm, l, pc + 2, sp, sub);
+			pc += (signed char)pc[1] + 2;
+			continue;
+		case RSplit:
+			addthread(vm, l, pc + (signed char)pc[1] + 2, sp, sub);
+			pc += 2;
+			continue;
+		case Save:
+			off = (unsigned char)pc[1];
+			if(off >= vm->nsubp) {
+				pc += 2;
+				continue;
+			}
+			old = sub[off];
+			sub[off] = sp;
+			addthread(vm, l, pc + 2, sp, sub);
+			sub[off] = old;
+			return;
+		case Bol:
+			if(sp != vm->input->begin_line)
+				return;
+			pc++;
+			continue;
+		case Eol:
+			if(sp != vm->input->end)
+				return;
+			pc++;
+			continue;
+		}
+
+		// Consumer or Match: this thread waits for the next step
+		l->pc[l->n] = pc;
+		memcpy(l->sub + l->n * vm->nsubp, sub, vm->nsubp * sizeof(*sub));
+		l->n++;
+		return;
+	}
+}
+
+int
+re1_5_pikevm(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored)
+{
+	PikeVM vm;
+	ThreadList lists[2], *clist, *nlist, *tmp;
+	const char *pc, *sp, **sub, **scratch;
+	int i, matched, size, skip;
+	char *mem, *p;
+
+	// One block for both thread lists, the scratch captures and the pc
+	// marks. The pointers come first, so all of them are aligned.
+	size = 2 * prog->len * (1 + nsubp) * sizeof(const char*)
+		+ nsubp * sizeof(const char*)
+		+ prog->bytelen * sizeof(int);
+	mem = re1_5_alloc(size);
+	p = mem;
+	for(i = 0; i < 2; i++) {
+		lists[i].pc = (const char**)p;
+		p += prog->len * sizeof(const char*);
+		lists[i].sub = (const char**)p;
+		p += prog->len * nsubp * sizeof(const char*);
+	}
+	scratch = (const char**)p;
+	p += nsubp * sizeof(const char*);
+	vm.mark = (int*)p;
+
+	vm.insts = prog->insts;
+	vm.input = input;
+	vm.nsubp = nsubp;
+	vm.gen = 1;
+	memset(vm.mark, 0, prog->bytelen * sizeof(int));
+	memset(scratch, 0, nsubp * sizeof(const char*));
+
+	clist = &lists[0];
+	nlist = &lists[1];
+	clist->n = 0;
+	matched = 0;
+
+	// If the first byte of a match is known, a search starts new threads
+	// itself instead of running the ".*?" prefix, and only where they fit.
+	// When no thread is left, it skips right to the next such position.
+	skip = !is_anchored && prog->hasfirst;
+	if(!skip)
+		addthread(&vm, clist, HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, scratch);
+
+	for(sp = input->begin; ; sp++) {
+		if(skip && !matched) {
+			if(clist->n == 0) {
+				sp = re1_5_skip(prog, sp, input->end);
+				if(sp == nil)
+					break;
+				vm.gen++;
+				addthread(&vm, clist, prog->insts + NON_ANCHORED_PREFIX, sp, scratch);
+			} else if(re1_5_iscandidate(prog, sp, input->end)) {
+				// Started last, so lowest priority
+				addthread(&vm, clist, prog->insts + NON_ANCHORED_PREFIX, sp, scratch);
+			}
+		}
+		if(clist->n == 0)
+			break;
+
+		vm.gen++;
+		nlist->n = 0;
+		for(i = 0; i < clist->n; i++) {
+			pc = clist->pc[i];
+			sub = clist->sub + i * nsubp;
+			if(inst_is_consumer(*pc)) {
+				if(sp >= input->end)
+					continue;
+			}
+			switch(*pc) {
+			case Char:
+				if(*sp != pc[1])
+					continue;
+				pc += 2;
+				break;
+			case Any:
+				pc++;
+				break;
+			case Class:
+			case ClassNot:
+				if(!_re1_5_classmatch(pc + 1, sp))
+					continue;
+				pc += *(unsigned char*)(pc + 1) * 2 + 2;
+				break;
+			case Match:
+				matched = 1;
+				memcpy(subp, sub, nsubp * sizeof(*sub));
+				// Lower priority threads can't win any more
+				i = clist->n;
+				continue;
+			default:
+				re1_5_fatal("pikevm");
+			}
+			addthread(&vm, nlist, pc, sp + 1, sub);
+		}
+		tmp = clist;
+		clist = nlist;
+		nlist = tmp;
+	}
+
+	re1_5_free(mem, size);
+	return matched;
+}
@@ -21,6 +21,10 @@ typedef struct ByteProg ByteProg;
 typedef struct Inst Inst;
 typedef struct Subject Subject;
 
+enum {
+	MAXPREFIX = 16
+};
+
 struct Regexp
 {
 	int type;
@@ -61,6 +65,10 @@ struct ByteProg
 	int bytelen;
 	int len;
 	int sub;
+	int prefixlen;	// literal every match starts with, if > 0
+	char prefix[MAXPREFIX];
+	int hasfirst;	// if set, bytes a match can start with
+	unsigned char first[32];
 	char insts[0];
 };
 
@@ -128,6 +136,7 @@ void decref(Sub*);
 struct Subject {
 	const char *begin;
 	const char *end;
+	const char *begin_line;	// where ^ matches, may be before begin
 };
 
 
@@ -145,5 +154,7 @@ int re1_5_compilecode(ByteProg *prog, const char *re);
 void re1_5_dumpcode(ByteProg *prog);
 void cleanmarks(ByteProg *prog);
 int _re1_5_classmatch(const char *pc, const char *sp);
+int re1_5_iscandidate(ByteProg *prog, const char *sp, const char *end);
+const char *re1_5_skip(ByteProg *prog, const char *sp, const char *end);
 
 #endif /*_RE1_5_REGEXP__H*/
@@ -59,7 +59,7 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 			subp[off] = old;
 			return 0;
 		case Bol:
-			if(sp != input->begin)
+			if(sp != input->begin_line)
 				return 0;
 			continue;
 		case Eol:
@@ -74,5 +74,15 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 int
 re1_5_recursiveloopprog(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored)
 {
+	const char *sp;
+
+	if(!is_anchored && prog->hasfirst) {
+		// Only try positions where the first byte fits
+		for(sp = input->begin; (sp = re1_5_skip(prog, sp, input->end)) != nil; sp++) {
+			if(recursiveloop(prog->insts + NON_ANCHORED_PREFIX, sp, input, subp, nsubp))
+				return 1;
+		}
+		return 0;
+	}
 	return recursiveloop(HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, input, subp, nsubp);
 }
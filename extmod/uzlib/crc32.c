@@ -0,0 +1,44 @@
+/*
+ * CRC32 checksum (gzip, PNG)
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely.
+ */
+
+#include "tinf.h"
+
+/* reflected polynomial 0xedb88320, one nibble at a time */
+static const unsigned int tinf_crc32tab[16] = {
+   0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190,
+   0x6b6b51f4, 0x4db26158, 0x5005713c, 0xedb88320, 0xf00f9344,
+   0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278,
+   0xbdbdf21c
+};
+
+unsigned int tinf_crc32(const void *data, unsigned int length)
+{
+   return tinf_crc32_update(0, data, length);
+}
+
+/* continue the checksum crc of preceding data, start with 0 */
+unsigned int tinf_crc32_update(unsigned int crc, const void *data, unsigned int length)
+{
+   const unsigned char *buf = (const unsigned char *)data;
+
+   crc = ~crc;
+
+   while (length--)
+   {
+      crc ^= *buf++;
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+      crc = tinf_crc32tab[crc & 0x0f] ^ (crc >> 4);
+   }
+
+   return ~crc;
+}
@@ -0,0 +1,741 @@
+/*
+ * deflate  -  streaming deflate with a bounded window
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely.
+ */
+
+/*
+ * Input is collected in a window of twice the match distance. Once it is
+ * full, the upper half is moved down, so memory use is fixed no matter how
+ * much data passes through. Matches are found with a hash table of the last
+ * position of each 3 byte sequence and, if the caller provides the memory,
+ * chains through the earlier positions with the same hash.
+ *
+ * Without a symbol buffer, everything is encoded with the fixed Huffman
+ * codes of RFC 1951, which need no second pass over the data. With one,
+ * the symbols are collected and each full buffer becomes a block with
+ * dynamic codes, fixed codes or stored data, whichever is smallest.
+ */
+
+#include <string.h>
+
+#include "tinf.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define NIL 0xffff
+
+#define MAX_BITS 15
+#define MAX_BL_BITS 7
+
+static const unsigned short tinf_defl_length_base[29] = {
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char tinf_defl_length_bits[29] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short tinf_defl_dist_base[30] = {
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+   8193, 12289, 16385, 24577
+};
+static const unsigned char tinf_defl_dist_bits[30] = {
+   0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* order of the code length code lengths in a dynamic block header */
+static const unsigned char tinf_defl_clcidx[19] = {
+   16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* max_chain, nice_len and lazy_len per level, after zlib */
+static const unsigned short tinf_defl_levels[10][3] = {
+   { 0, 0, 0 },
+   { 4, 8, 0 },
+   { 8, 16, 0 },
+   { 32, 32, 0 },
+   { 16, 16, 4 },
+   { 32, 32, 16 },
+   { 128, 128, 16 },
+   { 256, 128, 32 },
+   { 1024, MAX_MATCH, 128 },
+   { 4096, MAX_MATCH, MAX_MATCH }
+};
+
+/* ----------------------- *
+ * -- bit output         -- *
+ * ----------------------- */
+
+static void tinf_defl_flush_out(TINF_DEFLATE *d)
+{
+   if (d->outlen)
+   {
+      d->write(d, d->outbuf, d->outlen);
+      d->outlen = 0;
+   }
+}
+
+/* add num bits, least significant first */
+static void tinf_defl_bits(TINF_DEFLATE *d, unsigned int bits, int num)
+{
+   d->bitbuf |= bits << d->bitcount;
+   d->bitcount += num;
+
+   while (d->bitcount >= 8)
+   {
+      if (d->outlen == sizeof(d->outbuf)) tinf_defl_flush_out(d);
+      d->outbuf[d->outlen++] = d->bitbuf;
+      d->bitbuf >>= 8;
+      d->bitcount -= 8;
+   }
+}
+
+static unsigned int tinf_defl_reverse(unsigned int code, int num)
+{
+   unsigned int rev = 0;
+   int i;
+
+   for (i = 0; i < num; ++i, code >>= 1) rev = (rev << 1) | (code & 1);
+
+   return rev;
+}
+
+/* Huffman codes are stored most significant bit first */
+static void tinf_defl_code(TINF_DEFLATE *d, unsigned int code, int num)
+{
+   tinf_defl_bits(d, tinf_defl_reverse(code, num), num);
+}
+
+/* literal/length symbol with the fixed code */
+static void tinf_defl_symbol(TINF_DEFLATE *d, unsigned int sym)
+{
+   if (sym < 144) tinf_defl_code(d, 0x30 + sym, 8);
+   else if (sym < 256) tinf_defl_code(d, 0x190 + sym - 144, 9);
+   else if (sym < 280) tinf_defl_code(d, sym - 256, 7);
+   else tinf_defl_code(d, 0xc0 + sym - 280, 8);
+}
+
+static int tinf_defl_length_index(unsigned int len)
+{
+   int i;
+
+   for (i = 28; tinf_defl_length_base[i] > len; --i) ;
+
+   return i;
+}
+
+static int tinf_defl_dist_index(unsigned int dist)
+{
+   int i;
+
+   for (i = 29; tinf_defl_dist_base[i] > dist; --i) ;
+
+   return i;
+}
+
+static void tinf_defl_match(TINF_DEFLATE *d, unsigned int dist, unsigned int len)
+{
+   int i = tinf_defl_length_index(len);
+
+   tinf_defl_symbol(d, 257 + i);
+   tinf_defl_bits(d, len - tinf_defl_length_base[i], tinf_defl_length_bits[i]);
+
+   i = tinf_defl_dist_index(dist);
+   tinf_defl_code(d, i, 5);
+   tinf_defl_bits(d, dist - tinf_defl_dist_base[i], tinf_defl_dist_bits[i]);
+}
+
+/* ----------------------- *
+ * -- Huffman codes      -- *
+ * ----------------------- */
+
+/* Code lengths of a minimum redundancy code, in place. a holds the n > 1
+   frequencies in ascending order on entry and the lengths on return.
+   (A. Moffat, J. Katajainen: In-Place Calculation of Minimum-Redundancy
+   Codes, 1995) */
+static void tinf_defl_min_redundancy(unsigned int *a, int n)
+{
+   int root, leaf, next, avbl, used, dpth;
+
+   /* combine the two lightest trees, first pass */
+   a[0] += a[1];
+   root = 0;
+   leaf = 2;
+   for (next = 1; next < n - 1; ++next)
+   {
+      if (leaf >= n || a[root] < a[leaf]) { a[next] = a[root]; a[root++] = next; }
+      else a[next] = a[leaf++];
+
+      if (leaf >= n || (root < next && a[root] < a[leaf])) { a[next] += a[root]; a[root++] = next; }
+      else a[next] += a[leaf++];
+   }
+
+   /* parent pointers to depths of the internal nodes */
+   a[n - 2] = 0;
+   for (next = n - 3; next >= 0; --next) a[next] = a[a[next]] + 1;
+
+   /* depths of the internal nodes to depths of the leaves */
+   avbl = 1;
+   used = dpth = 0;
+   root = n - 2;
+   next = n - 1;
+   while (avbl > 0)
+   {
+      while (root >= 0 && (int)a[root] == dpth) { ++used; --root; }
+      while (avbl > used) { a[next--] = dpth; --avbl; }
+      avbl = 2 * used;
+      ++dpth;
+      used = 0;
+   }
+}
+
+/* code lengths of at most maxbits for the n symbols with frequencies freq */
+static void tinf_defl_lengths(const unsigned short *freq, int n, int maxbits, unsigned char *lens)
+{
+   unsigned short sym[286];
+   unsigned int a[286], count[MAX_BITS + 1], total;
+   int i, j, m = 0;
+
+   /* used symbols, sorted by frequency */
+   for (i = 0; i < n; ++i)
+   {
+      lens[i] = 0;
+      if (freq[i] == 0) continue;
+
+      for (j = m++; j > 0 && freq[sym[j - 1]] > freq[i]; --j) sym[j] = sym[j - 1];
+      sym[j] = i;
+   }
+
+   /* a complete code needs two symbols, some inflaters insist on it */
+   for (i = 0; m < 2; ++i)
+   {
+      if (freq[i] == 0) sym[m++] = i;
+   }
+
+   for (i = 0; i < m; ++i) a[i] = freq[sym[i]];
+   tinf_defl_min_redundancy(a, m);
+
+   /* cut the longest codes to maxbits, then lengthen others until the code
+      is complete again */
+   for (i = 0; i <= maxbits; ++i) count[i] = 0;
+   for (i = 0; i < m; ++i) ++count[a[i] < (unsigned int)maxbits ? a[i] : (unsigned int)maxbits];
+
+   total = 0;
+   for (i = maxbits; i > 0; --i) total += count[i] << (maxbits - i);
+
+   while (total != (1u << maxbits))
+   {
+      --count[maxbits];
+      for (i = maxbits - 1; i > 0; --i)
+      {
+         if (count[i])
+         {
+            --count[i];
+            count[i + 1] += 2;
+            break;
+         }
+      }
+      --total;
+   }
+
+   /* the least frequent symbols get the longest codes */
+   j = 0;
+   for (i = maxbits; i > 0; --i)
+   {
+      unsigned int k;
+      for (k = count[i]; k > 0; --k) lens[sym[j++]] = i;
+   }
+}
+
+/* canonical codes for the lengths, bit reversed for tinf_defl_bits() */
+static void tinf_defl_codes(const unsigned char *lens, int n, unsigned short *codes)
+{
+   unsigned short count[MAX_BITS + 1], next[MAX_BITS + 1];
+   unsigned int code = 0;
+   int i;
+
+   for (i = 0; i <= MAX_BITS; ++i) count[i] = 0;
+   for (i = 0; i < n; ++i) ++count[lens[i]];
+   count[0] = 0;
+
+   for (i = 1; i <= MAX_BITS; ++i)
+   {
+      code = (code + count[i - 1]) << 1;
+      next[i] = code;
+   }
+
+   for (i = 0; i < n; ++i)
+   {
+      if (lens[i]) codes[i] = tinf_defl_reverse(next[lens[i]]++, lens[i]);
+   }
+}
+
+static void tinf_defl_fixed_lengths(unsigned char *llens, unsigned char *dlens)
+{
+   int i;
+
+   for (i = 0; i < 144; ++i) llens[i] = 8;
+   for (; i < 256; ++i) llens[i] = 9;
+   for (; i < 280; ++i) llens[i] = 7;
+   for (; i < 288; ++i) llens[i] = 8;
+
+   for (i = 0; i < 30; ++i) dlens[i] = 5;
+}
+
+/* bits of the block data with the code lengths llens and dlens */
+static unsigned int tinf_defl_data_cost(const TINF_DEFLATE *d, const unsigned char *llens, const unsigned char *dlens)
+{
+   unsigned int cost = 0;
+   int i;
+
+   for (i = 0; i < 286; ++i)
+   {
+      cost += d->lfreq[i] * (llens[i] + (i > 256 ? tinf_defl_length_bits[i - 257] : 0));
+   }
+   for (i = 0; i < 30; ++i)
+   {
+      cost += d->dfreq[i] * (dlens[i] + tinf_defl_dist_bits[i]);
+   }
+
+   return cost;
+}
+
+/* ----------------------- *
+ * -- blocks             -- *
+ * ----------------------- */
+
+/* len bytes of the window from start as stored blocks */
+static void tinf_defl_stored(TINF_DEFLATE *d, unsigned int start, unsigned int len, int final)
+{
+   do {
+      unsigned int n = len < 0xffff ? len : 0xffff;
+
+      len -= n;
+      tinf_defl_bits(d, final && len == 0, 3);
+      if (d->bitcount) tinf_defl_bits(d, 0, 8 - d->bitcount);
+      tinf_defl_bits(d, n, 16);
+      tinf_defl_bits(d, n ^ 0xffff, 16);
+
+      tinf_defl_flush_out(d);
+      if (n) d->write(d, d->window + start, n);
+      start += n;
+   } while (len > 0);
+}
+
+/* the collected symbols with the given codes */
+static void tinf_defl_put_syms(TINF_DEFLATE *d, const unsigned short *lcodes, const unsigned char *llens,
+                               const unsigned short *dcodes, const unsigned char *dlens)
+{
+   const unsigned char *p = d->syms;
+   unsigned int i;
+
+   for (i = 0; i < d->nsyms; ++i, p += 3)
+   {
+      unsigned int dist = p[0] | (p[1] << 8);
+
+      if (dist == 0)
+      {
+         tinf_defl_bits(d, lcodes[p[2]], llens[p[2]]);
+      } else {
+         unsigned int len = p[2] + MIN_MATCH;
+         int j = tinf_defl_length_index(len);
+
+         tinf_defl_bits(d, lcodes[257 + j], llens[257 + j]);
+         tinf_defl_bits(d, len - tinf_defl_length_base[j], tinf_defl_length_bits[j]);
+
+         j = tinf_defl_dist_index(dist);
+         tinf_defl_bits(d, dcodes[j], dlens[j]);
+         tinf_defl_bits(d, dist - tinf_defl_dist_base[j], tinf_defl_dist_bits[j]);
+      }
+   }
+
+   tinf_defl_bits(d, lcodes[256], llens[256]);
+}
+
+/* output the collected symbols as one block in the smallest encoding */
+static void tinf_defl_block(TINF_DEFLATE *d, int final)
+{
+   unsigned char llens[286], dlens[30], lens[288 + 30], cllens[19];
+   unsigned char rle[286 + 30], rlex[286 + 30];
+   unsigned short lcodes[288], dcodes[30], clcodes[19], clfreq[19];
+   unsigned int hlit, hdist, hclen, nrle, i, n;
+   unsigned int dyn_cost, fixed_cost, stored_cost;
+
+   d->lfreq[256] = 1;
+
+   /* dynamic code lengths, and their run length encoding for the header */
+   tinf_defl_lengths(d->lfreq, 286, MAX_BITS, llens);
+   tinf_defl_lengths(d->dfreq, 30, MAX_BITS, dlens);
+
+   for (hlit = 286; hlit > 257 && llens[hlit - 1] == 0; --hlit) ;
+   for (hdist = 30; hdist > 1 && dlens[hdist - 1] == 0; --hdist) ;
+   memcpy(lens, llens, hlit);
+   memcpy(lens + hlit, dlens, hdist);
+   n = hlit + hdist;
+
+   memset(clfreq, 0, sizeof(clfreq));
+   nrle = 0;
+   for (i = 0; i < n; )
+   {
+      unsigned int cur = lens[i], run = 1;
+
+      while (i + run < n && lens[i + run] == cur) ++run;
+
+      if (cur == 0 && run >= 3)
+      {
+         if (run > 138) run = 138;
+         rle[nrle] = run >= 11 ? 18 : 17;
+         rlex[nrle] = run - (run >= 11 ? 11 : 3);
+      } else if (cur != 0 && run >= 4) {
+         /* the length itself, then up to 6 repeats of it */
+         if (run > 7) run = 7;
+         rle[nrle++] = cur;
+         ++clfreq[cur];
+         rle[nrle] = 16;
+         rlex[nrle] = run - 1 - 3;
+      } else {
+         rle[nrle] = cur;
+         run = 1;
+      }
+      ++clfreq[rle[nrle++]];
+      i += run;
+   }
+
+   tinf_defl_lengths(clfreq, 19, MAX_BL_BITS, cllens);
+   for (hclen = 19; hclen > 4 && cllens[tinf_defl_clcidx[hclen - 1]] == 0; --hclen) ;
+
+   dyn_cost = 3 + 14 + 3 * hclen + tinf_defl_data_cost(d, llens, dlens);
+   for (i = 0; i < nrle; ++i)
+   {
+      dyn_cost += cllens[rle[i]] + (rle[i] == 16 ? 2 : rle[i] == 17 ? 3 : rle[i] == 18 ? 7 : 0);
+   }
+
+   /* the two unused symbols are part of the fixed code too */
+   tinf_defl_fixed_lengths(lens, lens + 288);
+   fixed_cost = 3 + tinf_defl_data_cost(d, lens, lens + 288);
+
+   /* stored, if the data of the block is still in the window */
+   stored_cost = (unsigned int)-1;
+   if (d->block_start >= 0)
+   {
+      n = d->pos - d->block_start;
+      stored_cost = (n / 0xffff + 1) * (3 + 7 + 32) + 8 * n;
+   }
+
+   if (stored_cost <= fixed_cost && stored_cost <= dyn_cost)
+   {
+      tinf_defl_stored(d, d->block_start, d->pos - d->block_start, final);
+   } else if (fixed_cost <= dyn_cost) {
+      tinf_defl_bits(d, final | 2, 3);
+      tinf_defl_codes(lens, 288, lcodes);
+      tinf_defl_codes(lens + 288, 30, dcodes);
+      tinf_defl_put_syms(d, lcodes, lens, dcodes, lens + 288);
+   } else {
+      tinf_defl_bits(d, final | 4, 3);
+      tinf_defl_bits(d, hlit - 257, 5);
+      tinf_defl_bits(d, hdist - 1, 5);
+      tinf_defl_bits(d, hclen - 4, 4);
+      for (i = 0; i < hclen; ++i) tinf_defl_bits(d, cllens[tinf_defl_clcidx[i]], 3);
+
+      tinf_defl_codes(cllens, 19, clcodes);
+      for (i = 0; i < nrle; ++i)
+      {
+         tinf_defl_bits(d, clcodes[rle[i]], cllens[rle[i]]);
+         if (rle[i] == 16) tinf_defl_bits(d, rlex[i], 2);
+         else if (rle[i] == 17) tinf_defl_bits(d, rlex[i], 3);
+         else if (rle[i] == 18) tinf_defl_bits(d, rlex[i], 7);
+      }
+
+      tinf_defl_codes(llens, 286, lcodes);
+      tinf_defl_codes(dlens, 30, dcodes);
+      tinf_defl_put_syms(d, lcodes, llens, dcodes, dlens);
+   }
+
+   memset(d->lfreq, 0, sizeof(d->lfreq));
+   memset(d->dfreq, 0, sizeof(d->dfreq));
+   d->nsyms = 0;
+   d->block_start = d->pos;
+}
+
+/* a literal, written right away or collected for the block */
+static void tinf_defl_literal(TINF_DEFLATE *d, unsigned int c)
+{
+   unsigned char *p;
+
+   if (!d->syms)
+   {
+      tinf_defl_symbol(d, c);
+      return;
+   }
+
+   p = d->syms + 3 * d->nsyms++;
+   p[0] = p[1] = 0;
+   p[2] = c;
+   ++d->lfreq[c];
+}
+
+static void tinf_defl_copy(TINF_DEFLATE *d, unsigned int dist, unsigned int len)
+{
+   unsigned char *p;
+
+   if (!d->syms)
+   {
+      tinf_defl_match(d, dist, len);
+      return;
+   }
+
+   p = d->syms + 3 * d->nsyms++;
+   p[0] = dist;
+   p[1] = dist >> 8;
+   p[2] = len - MIN_MATCH;
+   ++d->lfreq[257 + tinf_defl_length_index(len)];
+   ++d->dfreq[tinf_defl_dist_index(dist)];
+}
+
+/* ----------------------- *
+ * -- match finding      -- *
+ * ----------------------- */
+
+static unsigned int tinf_defl_hash(const TINF_DEFLATE *d, const unsigned char *p)
+{
+   unsigned int v = (p[0] << 16) | (p[1] << 8) | p[2];
+
+   return (v * 2654435761u) >> (32 - d->hbits);
+}
+
+static void tinf_defl_insert(TINF_DEFLATE *d, unsigned int pos)
+{
+   unsigned int h = tinf_defl_hash(d, d->window + pos);
+
+   if (d->prev) d->prev[pos & ((1u << d->wbits) - 1)] = d->head[h];
+   d->head[h] = pos;
+}
+
+/* Insert pos into the hash table and find the longest match for it. The
+   chain is indexed by position modulo the window size, so matches stop
+   one short of the full distance where it would be overwritten. */
+static unsigned int tinf_defl_longest(TINF_DEFLATE *d, unsigned int pos, unsigned int *dist)
+{
+   const unsigned char *w = d->window, *b = w + pos;
+   unsigned int wsize = 1u << d->wbits;
+   unsigned int avail = d->fill - pos, max, best = 0, chain = d->max_chain;
+   unsigned int cand;
+
+   if (avail < MIN_MATCH) return 0;
+   max = avail < MAX_MATCH ? avail : MAX_MATCH;
+
+   cand = d->head[tinf_defl_hash(d, b)];
+   tinf_defl_insert(d, pos);
+
+   while (cand != NIL && pos - cand < (d->prev ? wsize : wsize + 1))
+   {
+      const unsigned char *a = w + cand;
+
+      if (a[best] == b[best] && a[0] == b[0])
+      {
+         unsigned int len = 1;
+
+         while (len < max && a[len] == b[len]) ++len;
+
+         if (len > best)
+         {
+            best = len;
+            *dist = pos - cand;
+            if (len >= d->nice_len || len == max) break;
+         }
+      }
+
+      if (!d->prev || --chain == 0) break;
+      cand = d->prev[cand & (wsize - 1)];
+   }
+
+   return best >= MIN_MATCH ? best : 0;
+}
+
+/* the positions inside a match can start later matches */
+static void tinf_defl_skip(TINF_DEFLATE *d, unsigned int from, unsigned int end)
+{
+   for (; from < end; ++from)
+   {
+      if (d->fill - from >= MIN_MATCH) tinf_defl_insert(d, from);
+   }
+}
+
+/* compress window data, keeping MAX_MATCH bytes of lookahead after the
+   next position unless flushing */
+static void tinf_defl_process(TINF_DEFLATE *d, int flush)
+{
+   unsigned char *w = d->window;
+
+   if (d->level == 0)
+   {
+      /* stored blocks, as soon as there is a window full */
+      if (d->fill - d->pos >= (1u << d->wbits) || (flush && d->fill > d->pos))
+      {
+         tinf_defl_stored(d, d->pos, d->fill - d->pos, 0);
+         d->pos = d->fill;
+      }
+      return;
+   }
+
+   while (d->pos < d->fill && (flush || d->fill - d->pos > MAX_MATCH))
+   {
+      unsigned int len, dist = 0;
+
+      if (d->syms && d->nsyms == (1u << d->sbits)) tinf_defl_block(d, 0);
+
+      if (d->have_match)
+      {
+         len = d->match_len;
+         dist = d->match_dist;
+         d->have_match = 0;
+      } else {
+         len = tinf_defl_longest(d, d->pos, &dist);
+      }
+
+      /* lazy matching: a longer match at the next position is worth a literal */
+      if (len && len < d->lazy_len && d->pos + 1 < d->fill)
+      {
+         d->match_len = tinf_defl_longest(d, d->pos + 1, &d->match_dist);
+         if (d->match_len > len)
+         {
+            tinf_defl_literal(d, w[d->pos]);
+            ++d->pos;
+            d->have_match = 1;
+            continue;
+         }
+
+         tinf_defl_copy(d, dist, len);
+         tinf_defl_skip(d, d->pos + 2, d->pos + len);
+         d->pos += len;
+      } else if (len) {
+         tinf_defl_copy(d, dist, len);
+         tinf_defl_skip(d, d->pos + 1, d->pos + len);
+         d->pos += len;
+      } else {
+         tinf_defl_literal(d, w[d->pos]);
+         ++d->pos;
+      }
+   }
+}
+
+/* drop the older half of the window */
+static void tinf_defl_slide(TINF_DEFLATE *d)
+{
+   unsigned int wsize = 1u << d->wbits;
+   unsigned int i;
+
+   memmove(d->window, d->window + wsize, wsize);
+   d->pos -= wsize;
+   d->fill -= wsize;
+   d->block_start -= wsize;
+
+   if (d->level == 0) return;
+
+   for (i = 0; i < (1u << d->hbits); ++i)
+   {
+      unsigned int p = d->head[i];
+      d->head[i] = (p == NIL || p < wsize) ? NIL : p - wsize;
+   }
+
+   if (d->prev)
+   {
+      for (i = 0; i < wsize; ++i)
+      {
+         unsigned int p = d->prev[i];
+         d->prev[i] = (p == NIL || p < wsize) ? NIL : p - wsize;
+      }
+   }
+}
+
+/* ----------------------- *
+ * -- API                -- *
+ * ----------------------- */
+
+void tinf_deflate_init(TINF_DEFLATE *d, unsigned int wbits, unsigned int hbits, unsigned int level)
+{
+   if (level > 9) level = 9;
+
+   d->wbits = wbits;
+   d->hbits = hbits;
+   d->pos = 0;
+   d->fill = 0;
+   d->level = level;
+   d->max_chain = tinf_defl_levels[level][0];
+   d->nice_len = tinf_defl_levels[level][1];
+   d->lazy_len = tinf_defl_levels[level][2];
+   d->have_match = 0;
+   d->block_start = 0;
+   d->nsyms = 0;
+   memset(d->lfreq, 0, sizeof(d->lfreq));
+   memset(d->dfreq, 0, sizeof(d->dfreq));
+   d->bitbuf = 0;
+   d->bitcount = 0;
+   d->outlen = 0;
+   if (level > 0) memset(d->head, 0xff, TINF_DEFLATE_HASH_SIZE(hbits));
+
+   /* Without a symbol buffer, everything goes into one block with fixed
+      codes. It is not the final one, as the end of the data isn't known
+      yet. */
+   if (level > 0 && !d->syms) tinf_defl_bits(d, 2, 3);
+}
+
+void tinf_deflate_write(TINF_DEFLATE *d, const void *data, unsigned int len)
+{
+   const unsigned char *src = (const unsigned char *)data;
+   unsigned int size = TINF_DEFLATE_WINDOW_SIZE(d->wbits);
+
+   while (len > 0)
+   {
+      unsigned int n;
+
+      /* pos is at least size - MAX_MATCH here, which is in the upper half */
+      if (d->fill == size) tinf_defl_slide(d);
+
+      n = size - d->fill;
+      if (n > len) n = len;
+
+      memcpy(d->window + d->fill, src, n);
+      d->fill += n;
+      src += n;
+      len -= n;
+
+      tinf_defl_process(d, 0);
+   }
+}
+
+void tinf_deflate_finish(TINF_DEFLATE *d)
+{
+   if (d->level == 0)
+   {
+      tinf_defl_stored(d, d->pos, d->fill - d->pos, 1);
+      d->pos = d->fill;
+   } else if (d->syms) {
+      tinf_defl_process(d, 1);
+      tinf_defl_block(d, 1);
+   } else {
+      tinf_defl_process(d, 1);
+
+      /* end of block, then an empty final block */
+      tinf_defl_symbol(d, 256);
+      tinf_defl_bits(d, 3, 3);
+      tinf_defl_symbol(d, 256);
+   }
+
+   /* pad to a byte boundary */
+   tinf_defl_bits(d, 0, 7);
+   d->bitbuf = 0;
+   d->bitcount = 0;
+
+   tinf_defl_flush_out(d);
+}
@@ -27,21 +27,32 @@ extern "C" {
 #endif
 
 #define TINF_OK             0
+#define TINF_DONE           1
 #define TINF_DATA_ERROR    (-3)
 #define TINF_DEST_OVERFLOW (-4)
 
 /* data structures */
 
+/* codes up to this many bits are decoded with a single table lookup */
+#ifndef TINF_FAST_BITS
+#define TINF_FAST_BITS 9
+#endif
+
 typedef struct {
    unsigned short table[16];  /* table of code length counts */
    unsigned short trans[288]; /* code -> symbol translation table */
+   /* Indexed by the next TINF_FAST_BITS bits of input. For a short code,
+      symbol << 4 | code length. For a longer one, code length 0 and
+      the state of the canonical decoder after TINF_FAST_BITS bits << 4. */
+   unsigned short fast[1 << TINF_FAST_BITS];
 } TINF_TREE;
 
 struct TINF_DATA;
 typedef struct TINF_DATA {
    const unsigned char *source;
-   unsigned int tag;
-   unsigned int bitcount;
+   const unsigned char *sourceLimit; /* first byte past the input */
+   unsigned int tag;      /* bit buffer, next bit is the lowest */
+   unsigned int bitcount; /* bits in tag, only ever from real input */
 
     /* Buffer start */
     unsigned char *destStart;
@@ -57,6 +68,21 @@ typedef struct TINF_DATA {
        fail again. */
     int (*destGrow)(struct TINF_DATA *data, unsigned int lastAlloc);
 
+   /* Called once source reaches sourceLimit. Points source and sourceLimit
+      at more input and returns 0, or returns -1 at the end of the input.
+      May be NULL. It may not return on error (longjmp). */
+   int (*readSource)(struct TINF_DATA *data);
+
+   /* state between calls of tinf_uncompress_stream() */
+   int bfinal;            /* the current block is the last one */
+   int btype;             /* of the current block, -1 between blocks */
+   unsigned int curlen;   /* bytes left of a match or a stored block */
+   unsigned int curdist;  /* distance of the match */
+   unsigned char *dict;   /* ring of the last 1 << dictBits output bytes */
+   unsigned int dictBits;
+   unsigned int dictIdx;
+   unsigned int dictFill; /* bytes of the ring written so far */
+
    TINF_TREE ltree; /* dynamic length/symbol tree */
    TINF_TREE dtree; /* dynamic distance tree */
 } TINF_DATA;
@@ -66,7 +92,8 @@ typedef struct TINF_DATA {
 
 /* Step 1: Allocate TINF_DATA structure */
 /* Step 2: Set destStart, destSize, and destGrow fields */
-/* Step 3: Set source field */
+/* Step 3: Set source, sourceLimit and readSource fields
+   (tinf_zlib_uncompress_dyn sets sourceLimit itself) */
 /* Step 4: Call tinf_uncompress_dyn() */
 /* Step 5: In response to destGrow callback, update destStart and destSize fields */
 /* Step 6: When tinf_uncompress_dyn() returns, buf.dest points to a byte past last uncompressed byte */
@@ -74,6 +101,24 @@ typedef struct TINF_DATA {
 int TINFCC tinf_uncompress_dyn(TINF_DATA *d);
 int TINFCC tinf_zlib_uncompress_dyn(TINF_DATA *d, unsigned int sourceLen);
 
+/* streaming API, output in pieces of any size through a bounded window */
+
+/* Step 1: Set source, sourceLimit and readSource fields */
+/* Step 2: Call tinf_uncompress_stream_init() with 1 << dictBits bytes of
+           memory for the window, larger than any match distance */
+/* Step 3: Optionally call tinf_zlib_parse_header() */
+/* Step 4: Set dest and destRemaining fields, call tinf_uncompress_stream().
+           It returns when destRemaining is 0 (TINF_OK), at the end of the
+           data (TINF_DONE) or on error. Repeat until TINF_DONE. */
+/* Step 5: Optionally read the trailer with tinf_read_byte() */
+
+void TINFCC tinf_uncompress_stream_init(TINF_DATA *d, unsigned char *dict, unsigned int dictBits);
+int TINFCC tinf_uncompress_stream(TINF_DATA *d);
+int TINFCC tinf_zlib_parse_header(TINF_DATA *d);
+
+/* next byte of input from the byte boundary on, -1 at the end */
+int TINFCC tinf_read_byte(TINF_DATA *d);
+
 /* high-level API */
 
 void TINFCC tinf_init();
@@ -88,13 +133,76 @@ int TINFCC tinf_zlib_uncompress(void *dest, unsigned int *destLen,
                                 const void *source, unsigned int sourceLen);
 
 unsigned int TINFCC tinf_adler32(const void *data, unsigned int length);
+unsigned int TINFCC tinf_adler32_update(unsigned int adler, const void *data, unsigned int length);
 
 unsigned int TINFCC tinf_crc32(const void *data, unsigned int length);
+unsigned int TINFCC tinf_crc32_update(unsigned int crc, const void *data, unsigned int length);
 
 /* compression API */
 
 void TINFCC tinf_compress(void *data, const uint8_t *src, unsigned slen);
 
+/* streaming compression API, raw deflate */
+
+#define TINF_DEFLATE_MIN_WBITS 9
+#define TINF_DEFLATE_MAX_WBITS 15
+
+/* memory the caller provides for the window and the hash table */
+#define TINF_DEFLATE_WINDOW_SIZE(wbits) (2u << (wbits))
+#define TINF_DEFLATE_HASH_SIZE(hbits) ((1u << (hbits)) * sizeof(unsigned short))
+/* optional: hash chains, to try more than the last match candidate */
+#define TINF_DEFLATE_PREV_SIZE(wbits) ((1u << (wbits)) * sizeof(unsigned short))
+/* optional: buffer of 1 << sbits symbols, for blocks with dynamic codes */
+#define TINF_DEFLATE_SYMS_SIZE(sbits) (3u << (sbits))
+#define TINF_DEFLATE_MAX_SBITS 15
+
+struct TINF_DEFLATE;
+typedef struct TINF_DEFLATE {
+   unsigned char *window;  /* sliding window, TINF_DEFLATE_WINDOW_SIZE(wbits) */
+   unsigned short *head;   /* last window position per hash */
+   unsigned short *prev;   /* previous position with the same hash, or NULL */
+   unsigned char *syms;    /* symbols of the current block, or NULL */
+   unsigned int sbits;
+   unsigned int wbits;     /* matches reach back 1 << wbits bytes */
+   unsigned int hbits;
+   unsigned int pos;       /* next byte in window to compress */
+   unsigned int fill;      /* bytes in window */
+
+   unsigned int level;
+   unsigned int max_chain; /* match candidates tried per position */
+   unsigned int nice_len;  /* a match this long ends the search */
+   unsigned int lazy_len;  /* shorter matches are checked against the next position */
+   unsigned int have_match;
+   unsigned int match_len; /* match found at pos, if have_match */
+   unsigned int match_dist;
+
+   int block_start;        /* window position of the block, negative if slid out */
+   unsigned int nsyms;
+   unsigned short lfreq[286];
+   unsigned short dfreq[30];
+
+   unsigned int bitbuf;
+   unsigned int bitcount;
+   unsigned char outbuf[64];
+   unsigned int outlen;
+
+   /* Receives the compressed data. It may not return on error (longjmp). */
+   void (*write)(struct TINF_DEFLATE *d, const unsigned char *buf, unsigned int len);
+   void *user;
+} TINF_DEFLATE;
+
+/* Step 1: Set window, head, prev, syms, sbits, write and user fields */
+/* Step 2: Call tinf_deflate_init() with a level from 0 (store) to 9 (best) */
+/* Step 3: Call tinf_deflate_write() with the data, in pieces of any size */
+/* Step 4: Call tinf_deflate_finish() */
+/* Without syms, the output is a single block with fixed Huffman codes,   */
+/* which is written as it is produced. Without prev, each position tries  */
+/* only the last match candidate with the same hash.                      */
+
+void TINFCC tinf_deflate_init(TINF_DEFLATE *d, unsigned int wbits, unsigned int hbits, unsigned int level);
+void TINFCC tinf_deflate_write(TINF_DEFLATE *d, const void *data, unsigned int len);
+void TINFCC tinf_deflate_finish(TINF_DEFLATE *d);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
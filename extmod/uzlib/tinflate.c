@@ -32,6 +32,8 @@
  *    any source distribution.
  */
 
+#include <string.h>
+
 #include "tinf.h"
 
 /* --------------------------------------------------- *
@@ -123,13 +125,50 @@ static void tinf_build_bits_base(unsigned char *bits, unsigned short *base, int
 }
 #endif
 
+/* reverse the low num bits of code */
+static unsigned int tinf_reverse(unsigned int code, int num)
+{
+   unsigned int rev = 0;
+
+   for (; num; --num, code >>= 1) rev = (rev << 1) | (code & 1);
+
+   return rev;
+}
+
+/* build the lookup table of a tree from its length counts and symbols */
+static void tinf_build_fast(TINF_TREE *t)
+{
+   unsigned int code = 0, idx = 0, len, i, j;
+
+   /* Assign the canonical codes in order. A code of len bits fills every
+      entry whose low len bits are the code, which arrives first bit first. */
+   for (len = 1; len <= TINF_FAST_BITS; ++len, code <<= 1)
+   {
+      for (i = 0; i < t->table[len]; ++i, ++code, ++idx)
+      {
+         for (j = tinf_reverse(code, len); j < (1u << TINF_FAST_BITS); j += 1u << len)
+         {
+            t->fast[j] = (t->trans[idx] << 4) | len;
+         }
+      }
+   }
+   code >>= 1;
+
+   /* code is now the first TINF_FAST_BITS prefix of the longer codes; how far
+      a prefix is past it is where tinf_decode_symbol continues from */
+   for (i = code; i < (1u << TINF_FAST_BITS); ++i)
+   {
+      t->fast[tinf_reverse(i, TINF_FAST_BITS)] = (i - code) << 4;
+   }
+}
+
 /* build the fixed huffman trees */
 static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
 {
    int i;
 
    /* build fixed length tree */
-   for (i = 0; i < 7; ++i) lt->table[i] = 0;
+   for (i = 0; i < 16; ++i) lt->table[i] = 0;
 
    lt->table[7] = 24;
    lt->table[8] = 152;
@@ -141,11 +180,14 @@ static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
    for (i = 0; i < 112; ++i) lt->trans[24 + 144 + 8 + i] = 144 + i;
 
    /* build fixed distance tree */
-   for (i = 0; i < 5; ++i) dt->table[i] = 0;
+   for (i = 0; i < 16; ++i) dt->table[i] = 0;
 
    dt->table[5] = 32;
 
    for (i = 0; i < 32; ++i) dt->trans[i] = i;
+
+   tinf_build_fast(lt);
+   tinf_build_fast(dt);
 }
 
 /* given an array of code lengths, build a tree */
@@ -174,76 +216,125 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
    {
       if (lengths[i]) t->trans[offs[lengths[i]]++] = i;
    }
+
+   tinf_build_fast(t);
 }
 
 /* ---------------------- *
  * -- decode functions -- *
  * ---------------------- */
 
-/* get one bit from source stream */
-static int tinf_getbit(TINF_DATA *d)
+/* make sure source has input left, -1 at the end */
+static int tinf_more_source(TINF_DATA *d)
+{
+   if (d->source < d->sourceLimit) return 0;
+
+   return d->readSource ? d->readSource(d) : -1;
+}
+
+/* top up the bit buffer with whole bytes, as far as the input goes */
+static void tinf_refill(TINF_DATA *d)
 {
-   unsigned int bit;
+   while (d->bitcount <= 8 * sizeof(d->tag) - 8 && tinf_more_source(d) == 0)
+   {
+      d->tag |= (unsigned int)*d->source++ << d->bitcount;
+      d->bitcount += 8;
+   }
+}
+
+int tinf_read_byte(TINF_DATA *d)
+{
+   /* drop the bits up to the byte boundary */
+   d->tag >>= d->bitcount & 7;
+   d->bitcount &= ~7;
 
-   /* check if tag is empty */
-   if (!d->bitcount--)
+   /* whole bytes in the bit buffer come first */
+   if (d->bitcount)
    {
-      /* load next tag */
-      d->tag = *d->source++;
-      d->bitcount = 7;
+      int c = d->tag & 0xff;
+      d->tag >>= 8;
+      d->bitcount -= 8;
+      return c;
    }
 
-   /* shift bit out of tag */
-   bit = d->tag & 0x01;
-   d->tag >>= 1;
+   if (tinf_more_source(d)) return -1;
 
-   return bit;
+   return *d->source++;
 }
 
 /* read a num bit value from a stream and add base */
 static unsigned int tinf_read_bits(TINF_DATA *d, int num, int base)
 {
-   unsigned int val = 0;
+   unsigned int val;
 
-   /* read num bits */
-   if (num)
-   {
-      unsigned int limit = 1 << (num);
-      unsigned int mask;
+   if (d->bitcount < num) tinf_refill(d);
 
-      for (mask = 1; mask < limit; mask *= 2)
-         if (tinf_getbit(d)) val += mask;
-   }
+   val = d->tag & ((1u << num) - 1);
+   d->tag >>= num;
+
+   /* past the end of the input: the missing bits read as 0, and the next
+      symbol fails to decode */
+   d->bitcount = d->bitcount < num ? 0 : d->bitcount - num;
 
    return val + base;
 }
 
-/* given a data stream and a tree, decode a symbol */
+/* given a data stream and a tree, decode a symbol, -1 if it's invalid */
 static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 {
-   int sum = 0, cur = 0, len = 0;
+   unsigned int entry;
+   int sum, cur, len;
+
+   if (d->bitcount < 15) tinf_refill(d);
+
+   entry = t->fast[d->tag & ((1u << TINF_FAST_BITS) - 1)];
+   len = entry & 15;
+
+   if (len)
+   {
+      if (len > d->bitcount) return -1;
+
+      d->tag >>= len;
+      d->bitcount -= len;
+
+      return entry >> 4;
+   }
+
+   /* longer code, continue bit by bit from where the table left off */
+   if (d->bitcount < TINF_FAST_BITS) return -1;
+
+   d->tag >>= TINF_FAST_BITS;
+   d->bitcount -= TINF_FAST_BITS;
+
+   cur = entry >> 4;
+   for (sum = 0, len = 1; len <= TINF_FAST_BITS; ++len) sum += t->table[len];
 
    /* get more bits while code value is above sum */
    do {
 
-      cur = 2*cur + tinf_getbit(d);
+      if (len == 16 || !d->bitcount) return -1;
 
-      ++len;
+      cur = 2*cur + (d->tag & 1);
+      d->tag >>= 1;
+      d->bitcount--;
 
       sum += t->table[len];
       cur -= t->table[len];
 
+      ++len;
+
    } while (cur >= 0);
 
    return t->trans[sum + cur];
 }
 
 /* given a data stream, decode dynamic trees from it */
-static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
+static int tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
 {
    unsigned char lengths[288+32];
    unsigned int hlit, hdist, hclen;
    unsigned int i, num, length;
+   unsigned char prev;
 
    /* get 5 bits HLIT (257-286) */
    hlit = tinf_read_bits(d, 5, 257);
@@ -273,42 +364,48 @@ static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    {
       int sym = tinf_decode_symbol(d, lt);
 
+      if (sym < 0) return TINF_DATA_ERROR;
+
+      if (sym < 16)
+      {
+         /* values 0-15 represent the actual code lengths */
+         lengths[num++] = sym;
+         continue;
+      }
+
       switch (sym)
       {
       case 16:
          /* copy previous code length 3-6 times (read 2 bits) */
-         {
-            unsigned char prev = lengths[num - 1];
-            for (length = tinf_read_bits(d, 2, 3); length; --length)
-            {
-               lengths[num++] = prev;
-            }
-         }
+         if (num == 0) return TINF_DATA_ERROR;
+         prev = lengths[num - 1];
+         length = tinf_read_bits(d, 2, 3);
          break;
       case 17:
          /* repeat code length 0 for 3-10 times (read 3 bits) */
-         for (length = tinf_read_bits(d, 3, 3); length; --length)
-         {
-            lengths[num++] = 0;
-         }
-         break;
-      case 18:
-         /* repeat code length 0 for 11-138 times (read 7 bits) */
-         for (length = tinf_read_bits(d, 7, 11); length; --length)
-         {
-            lengths[num++] = 0;
-         }
+         prev = 0;
+         length = tinf_read_bits(d, 3, 3);
          break;
       default:
-         /* values 0-15 represent the actual code lengths */
-         lengths[num++] = sym;
+         /* repeat code length 0 for 11-138 times (read 7 bits) */
+         prev = 0;
+         length = tinf_read_bits(d, 7, 11);
          break;
       }
+
+      if (length > hlit + hdist - num) return TINF_DATA_ERROR;
+
+      for (; length; --length)
+      {
+         lengths[num++] = prev;
+      }
    }
 
    /* build dynamic trees */
    tinf_build_tree(lt, lengths, hlit);
    tinf_build_tree(dt, lengths + hlit, hdist);
+
+   return TINF_OK;
 }
 
 /* ----------------------------- *
@@ -322,6 +419,8 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    {
       int sym = tinf_decode_symbol(d, lt);
 
+      if (sym < 0) return TINF_DATA_ERROR;
+
       /* check for end of block */
       if (sym == 256)
       {
@@ -345,14 +444,17 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
          int i;
 
          sym -= 257;
+         if (sym >= 29) return TINF_DATA_ERROR;
 
          /* possibly get more bits from length code */
          length = tinf_read_bits(d, length_bits[sym], length_base[sym]);
 
          dist = tinf_decode_symbol(d, dt);
+         if (dist < 0 || dist >= 30) return TINF_DATA_ERROR;
 
          /* possibly get more bits from distance code */
          offs = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
+         if (offs > d->dest - d->destStart) return TINF_DATA_ERROR;
 
          if (d->destRemaining < length)
          {
@@ -372,22 +474,38 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    }
 }
 
-/* inflate an uncompressed block of data */
-static int tinf_inflate_uncompressed_block(TINF_DATA *d)
+/* get the length of an uncompressed block, -1 if it's invalid */
+static int tinf_stored_length(TINF_DATA *d)
 {
    unsigned int length, invlength;
-   unsigned int i;
+   unsigned char hdr[4];
+   int i, c;
 
-   /* get length */
-   length = d->source[1];
-   length = 256*length + d->source[0];
+   /* the header starts at the byte boundary */
+   for (i = 0; i < 4; ++i)
+   {
+      c = tinf_read_byte(d);
+      if (c < 0) return -1;
+      hdr[i] = c;
+   }
 
-   /* get one's complement of length */
-   invlength = d->source[3];
-   invlength = 256*invlength + d->source[2];
+   length = 256*hdr[1] + hdr[0];
+   invlength = 256*hdr[3] + hdr[2];
 
    /* check length */
-   if (length != (~invlength & 0x0000ffff)) return TINF_DATA_ERROR;
+   if (length != (~invlength & 0x0000ffff)) return -1;
+
+   return length;
+}
+
+/* inflate an uncompressed block of data */
+static int tinf_inflate_uncompressed_block(TINF_DATA *d)
+{
+   int length, c;
+   int i;
+
+   length = tinf_stored_length(d);
+   if (length < 0) return TINF_DATA_ERROR;
 
    if (d->destRemaining < length)
    {
@@ -395,15 +513,15 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
       if (res) return res;
    }
 
-   d->source += 4;
-
    /* copy block */
-   for (i = length; i; --i) *d->dest++ = *d->source++;
+   for (i = length; i; --i)
+   {
+      c = tinf_read_byte(d);
+      if (c < 0) return TINF_DATA_ERROR;
+      *d->dest++ = c;
+   }
    d->destRemaining -= length;
 
-   /* make sure we start next block on a byte boundary */
-   d->bitcount = 0;
-
    return TINF_OK;
 }
 
@@ -421,7 +539,8 @@ static int tinf_inflate_fixed_block(TINF_DATA *d)
 static int tinf_inflate_dynamic_block(TINF_DATA *d)
 {
    /* decode trees from stream */
-   tinf_decode_trees(d, &d->ltree, &d->dtree);
+   int res = tinf_decode_trees(d, &d->ltree, &d->dtree);
+   if (res != TINF_OK) return res;
 
    /* decode block using decoded trees */
    return tinf_inflate_block_data(d, &d->ltree, &d->dtree);
@@ -454,9 +573,12 @@ int tinf_uncompress(void *dest, unsigned int *destLen,
 
    /* initialise data */
    d.source = (const unsigned char *)source;
+   d.sourceLimit = d.source + sourceLen;
+   d.readSource = 0;
 
    d.destStart = (unsigned char *)dest;
-   d.destRemaining = *destLen;
+   d.destSize = *destLen;
+   d.destGrow = 0;
 
    res = tinf_uncompress_dyn(&d);
 
@@ -471,6 +593,7 @@ int tinf_uncompress_dyn(TINF_DATA *d)
    int bfinal;
 
    /* initialise data */
+   d->tag = 0;
    d->bitcount = 0;
 
    d->dest = d->destStart;
@@ -482,7 +605,7 @@ int tinf_uncompress_dyn(TINF_DATA *d)
       int res;
 
       /* read final block flag */
-      bfinal = tinf_getbit(d);
+      bfinal = tinf_read_bits(d, 1, 0);
 
       /* read block type (2 bits) */
       btype = tinf_read_bits(d, 2, 0);
@@ -512,3 +635,112 @@ int tinf_uncompress_dyn(TINF_DATA *d)
 
    return TINF_OK;
 }
+
+/* ----------------------------- *
+ * -- streaming decompression -- *
+ * ----------------------------- */
+
+void tinf_uncompress_stream_init(TINF_DATA *d, unsigned char *dict, unsigned int dictBits)
+{
+   d->tag = 0;
+   d->bitcount = 0;
+   d->bfinal = 0;
+   d->btype = -1;
+   d->curlen = 0;
+   d->dict = dict;
+   d->dictBits = dictBits;
+   d->dictIdx = 0;
+   d->dictFill = 0;
+   memset(dict, 0, 1u << dictBits);
+}
+
+/* put one byte of output, and keep it for later matches */
+static void tinf_stream_put(TINF_DATA *d, unsigned char c)
+{
+   *d->dest++ = c;
+   d->destRemaining--;
+
+   d->dict[d->dictIdx] = c;
+   d->dictIdx = (d->dictIdx + 1) & ((1u << d->dictBits) - 1);
+   if (d->dictFill < (1u << d->dictBits)) d->dictFill++;
+}
+
+int tinf_uncompress_stream(TINF_DATA *d)
+{
+   unsigned int mask = (1u << d->dictBits) - 1;
+
+   while (d->destRemaining)
+   {
+      int sym;
+
+      /* continue a match or a stored block */
+      if (d->curlen)
+      {
+         if (d->btype == 0)
+         {
+            int c = tinf_read_byte(d);
+            if (c < 0) return TINF_DATA_ERROR;
+            tinf_stream_put(d, c);
+         } else {
+            tinf_stream_put(d, d->dict[(d->dictIdx - d->curdist) & mask]);
+         }
+         d->curlen--;
+         continue;
+      }
+
+      /* between blocks, or at the end of a stored one */
+      if (d->btype <= 0)
+      {
+         if (d->bfinal) return TINF_DONE;
+
+         d->bfinal = tinf_read_bits(d, 1, 0);
+         d->btype = tinf_read_bits(d, 2, 0);
+
+         switch (d->btype)
+         {
+         case 0:
+            sym = tinf_stored_length(d);
+            if (sym < 0) return TINF_DATA_ERROR;
+            d->curlen = sym;
+            break;
+         case 1:
+            tinf_build_fixed_trees(&d->ltree, &d->dtree);
+            break;
+         case 2:
+            if (tinf_decode_trees(d, &d->ltree, &d->dtree) != TINF_OK) return TINF_DATA_ERROR;
+            break;
+         default:
+            return TINF_DATA_ERROR;
+         }
+         continue;
+      }
+
+      sym = tinf_decode_symbol(d, &d->ltree);
+
+      if (sym < 0) return TINF_DATA_ERROR;
+
+      if (sym < 256)
+      {
+         tinf_stream_put(d, sym);
+      } else if (sym == 256) {
+         /* end of block */
+         d->btype = -1;
+      } else {
+         int dist;
+
+         sym -= 257;
+         if (sym >= 29) return TINF_DATA_ERROR;
+
+         d->curlen = tinf_read_bits(d, length_bits[sym], length_base[sym]);
+
+         dist = tinf_decode_symbol(d, &d->dtree);
+         if (dist < 0 || dist >= 30) return TINF_DATA_ERROR;
+
+         /* the match has to be in the window, and in the output so far */
+         d->curdist = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
+         if (d->curdist > d->dictFill) return TINF_DATA_ERROR;
+      }
+   }
+
+   return TINF_OK;
+}
@@ -41,9 +41,11 @@ int tinf_zlib_uncompress(void *dest, unsigned int *destLen,
 
    /* initialise data */
    d.source = (const unsigned char *)source;
+   d.readSource = 0;
 
    d.destStart = (unsigned char *)dest;
-   d.destRemaining = *destLen;
+   d.destSize = *destLen;
+   d.destGrow = 0;
 
    res = tinf_zlib_uncompress_dyn(&d, sourceLen);
 
@@ -52,12 +54,40 @@ int tinf_zlib_uncompress(void *dest, unsigned int *destLen,
    return res;
 }
 
+/* read the zlib header, return the window size in bits */
+int tinf_zlib_parse_header(TINF_DATA *d)
+{
+   int cmf, flg;
+
+   cmf = tinf_read_byte(d);
+   flg = tinf_read_byte(d);
+
+   if (cmf < 0 || flg < 0) return TINF_DATA_ERROR;
+
+   /* check checksum */
+   if ((256*cmf + flg) % 31) return TINF_DATA_ERROR;
+
+   /* check method is deflate */
+   if ((cmf & 0x0f) != 8) return TINF_DATA_ERROR;
+
+   /* check window size is valid */
+   if ((cmf >> 4) > 7) return TINF_DATA_ERROR;
+
+   /* check there is no preset dictionary */
+   if (flg & 0x20) return TINF_DATA_ERROR;
+
+   return (cmf >> 4) + 8;
+}
+
 int tinf_zlib_uncompress_dyn(TINF_DATA *d, unsigned int sourceLen)
 {
    unsigned int a32;
    int res;
    unsigned char cmf, flg;
 
+   /* header and adler32 checksum */
+   if (sourceLen < 6) return TINF_DATA_ERROR;
+
    /* -- get header bytes -- */
 
    cmf = d->source[0];
@@ -84,6 +114,7 @@ int tinf_zlib_uncompress_dyn(TINF_DATA *d, unsigned int sourceLen)
    a32 = 256*a32 + d->source[sourceLen - 2];
    a32 = 256*a32 + d->source[sourceLen - 1];
 
+   d->sourceLimit = d->source + sourceLen - 4;
    d->source += 2;
 
    /* -- inflate -- */
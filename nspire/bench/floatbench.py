@@ -0,0 +1,113 @@
+# Float benchmarks: run on the default (double) and the single-precision
+# build ("make float") and compare the two outputs.
+#
+# Every benchmark prints the time it took in ms, every accuracy check the
+# relative error against the exact result (0 is exact, 1e-7 is about the
+# precision of a float, 1e-16 of a double).
+
+import math
+
+try:
+    from nsp import ticks, ticks_diff
+except ImportError:
+    import utime
+    def ticks():
+        return int(utime.clock() * 1000)
+    def ticks_diff(new, old):
+        return new - old
+
+try:
+    import ndarray, umath
+except ImportError:
+    ndarray = umath = None
+
+def bench(name, f):
+    t = ticks()
+    f()
+    print("%-24s %8d ms" % (name, ticks_diff(ticks(), t)))
+
+def accuracy(name, val, ref):
+    print("%-24s %8.1e" % (name, abs((val - ref) / ref)))
+
+# Speed
+
+def arith():
+    x, y = 1.0, 3.0
+    for i in range(20000):
+        x = x * 1.0001 + 0.5 / y
+        y = y + 0.25
+    return x
+
+def mandel():
+    n = 0
+    for py in range(24):
+        for px in range(32):
+            cr, ci = px / 10.0 - 2.2, py / 10.0 - 1.2
+            zr = zi = 0.0
+            i = 0
+            while i < 50 and zr * zr + zi * zi < 4.0:
+                zr, zi = zr * zr - zi * zi + cr, 2.0 * zr * zi + ci
+                i += 1
+            n += i
+    return n
+
+def transcendental():
+    s = 0.0
+    for i in range(1, 2001):
+        x = i * 0.001
+        s += math.sin(x) + math.cos(x) + math.sqrt(x) + math.exp(x) + math.log(x)
+    return s
+
+def matrix():
+    n = 16
+    a = ndarray.zeros((n, n))
+    for r in range(n):
+        for c in range(n):
+            a[r, c] = 1.0 / (r + c + 1) + (r == c)
+    b = ndarray.ones(n)
+    for i in range(5):
+        ndarray.solve(a, b)
+        ndarray.inv(a)
+
+def vector():
+    xs = ndarray.linspace(0, 6.283, 320, ndarray.float32)
+    ys = ndarray.zeros(320, ndarray.float32)
+    for i in range(50):
+        umath.sin(xs, out=ys)
+        umath.pow(ys, 2, out=ys)
+
+bench("arith", arith)
+bench("mandel", mandel)
+bench("transcendental", transcendental)
+if ndarray:
+    bench("ndarray solve/inv 16x16", matrix)
+    bench("umath sin/pow 320", vector)
+
+# Accuracy
+
+accuracy("sin(1)", math.sin(1), 0.8414709848078965)
+accuracy("cos(2)", math.cos(2), -0.4161468365471424)
+accuracy("tan(0.5)", math.tan(0.5), 0.5463024898437905)
+accuracy("exp(1)", math.exp(1), 2.718281828459045)
+accuracy("log(10)", math.log(10), 2.302585092994046)
+accuracy("sqrt(2)", math.sqrt(2), 1.4142135623730951)
+accuracy("atan2(1, 2)", math.atan2(1, 2), 0.4636476090008061)
+accuracy("pow(2, 0.5)", math.pow(2, 0.5), 1.4142135623730951)
+
+s = 0.0
+for k in range(1, 1001):
+    s += 1.0 / (k * k)
+accuracy("sum 1/k^2, k <= 1000", s, 1.64393456668156)
+
+if ndarray:
+    # Hilbert matrix, badly conditioned: the solution should be all ones
+    n = 6
+    h = ndarray.zeros((n, n))
+    for r in range(n):
+        for c in range(n):
+            h[r, c] = 1.0 / (r + c + 1)
+    x = ndarray.solve(h, h.sum(1))
+    err = 0.0
+    for v in x:
+        err = max(err, abs(v - 1))
+    accuracy("hilbert 6x6 solve", 1 + err, 1)
@@ -0,0 +1,504 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "objtuple.h"
+#include "timer.h"
+#include "eventloop.h"
+
+#include <libndls.h>
+
+/*
+ * Cooperative event loop.
+ *
+ * Small example:
+ *
+ * from nsp import EventLoop, Texture
+ * loop = EventLoop()
+ * screen = Texture(320, 240, None)
+ * x = 0
+ * def left(pressed):
+ *     global x
+ *     if pressed: x -= 10
+ * def frame(dt):
+ *     screen.fill(0xFFFF)
+ *     screen.setPx(160 + x, 120, 0x0000)
+ *     screen.display()
+ * def blink():
+ *     while True:
+ *         yield 500 # Sleep for 500 ms
+ *         print("blink")
+ * loop.onKey("LEFT", left)
+ * loop.onKey("ESC", lambda pressed: loop.stop())
+ * loop.onFrame(frame, 30)
+ * loop.spawn(blink())
+ * loop.run()
+ *
+ * run() calls the registered callbacks and resumes the tasks until stop() is called or
+ * nothing is left, the CPU is idle in between. Exceptions raised by a callback or task
+ * leave run(), the loop can be run again afterwards.
+ *
+ * A task is a generator. What it yields decides when it is resumed:
+ * None: In the next round of the loop.
+ * A number: After that many milliseconds.
+ * (stream, n): Once up to n bytes could be read from stream without blocking, they are
+ *   sent into the generator (an empty result means end of file). Errors are raised in it.
+ *
+ * Available functions:
+ * onKey(key, callback): callback(pressed) is called when the key is pressed or released.
+ *   Keys: "ESC", "ENTER", "UP", "DOWN", "LEFT", "RIGHT", "TAB", "DEL", "CTRL", "SHIFT",
+ *   "MENU" and "SPACE".
+ * every(ms, callback): callback() is called every ms milliseconds.
+ * onFrame(callback, fps = 30): callback(dt) is called fps times per second, dt is the
+ *   time since the last frame in milliseconds.
+ * spawn(generator): Adds a task.
+ * All of the above return an id for cancel(id), which removes the callback or task.
+ * run(): Runs the loop.
+ * stop(): Makes run() return after the current round.
+ *
+ * Timing needs the timer of the CX, on other models it has a resolution of one second.
+ */
+
+#define EVENTLOOP_KEY 0
+#define EVENTLOOP_TIMER 1
+#define EVENTLOOP_FRAME 2
+#define EVENTLOOP_TASK 3
+
+typedef struct eventloop_entry_t
+{
+	mp_int_t id;
+	byte kind;
+	bool pressed; // EVENTLOOP_KEY
+	bool sleeping; // EVENTLOOP_TASK, until next
+	t_key key;
+	mp_obj_t callback; // Or the generator, MP_OBJ_NULL once cancelled
+	mp_obj_t stream; // EVENTLOOP_TASK waiting for data, otherwise MP_OBJ_NULL
+	mp_uint_t read_size;
+	byte *read_buf; // Kept for every poll and the next reads of the task
+	mp_uint_t read_alloc;
+	uint32_t period, next; // Ticks
+	uint32_t last; // EVENTLOOP_FRAME, ticks of the last call
+} eventloop_entry_t;
+
+typedef struct eventloop_obj_t
+{
+	mp_obj_base_t base;
+	eventloop_entry_t *entries;
+	mp_uint_t len, alloc;
+	mp_int_t next_id;
+	bool running, stopped;
+} eventloop_obj_t;
+
+static uint32_t eventloop_ticks()
+{
+	if(!nsp_timer_start())
+		return *(volatile uint32_t*)0x90090000 * NSP_TIMER_HZ;
+
+	return nsp_timer_ticks();
+}
+
+static uint32_t eventloop_ms_to_ticks(mp_int_t ms)
+{
+	if(ms < 0)
+		ms = 0;
+	return (uint64_t)ms * NSP_TIMER_HZ / 1000;
+}
+
+// Whether deadline is reached at now, as signed difference because of wrap around
+static inline bool eventloop_due(uint32_t now, uint32_t deadline)
+{
+	return (int32_t)(now - deadline) >= 0;
+}
+
+static bool eventloop_get_key(qstr name, t_key *key)
+{
+	switch(name)
+	{
+		case MP_QSTR_ESC: *key = KEY_NSPIRE_ESC; return true;
+		case MP_QSTR_ENTER: *key = KEY_NSPIRE_ENTER; return true;
+		case MP_QSTR_UP: *key = KEY_NSPIRE_UP; return true;
+		case MP_QSTR_DOWN: *key = KEY_NSPIRE_DOWN; return true;
+		case MP_QSTR_LEFT: *key = KEY_NSPIRE_LEFT; return true;
+		case MP_QSTR_RIGHT: *key = KEY_NSPIRE_RIGHT; return true;
+		case MP_QSTR_TAB: *key = KEY_NSPIRE_TAB; return true;
+		case MP_QSTR_DEL: *key = KEY_NSPIRE_DEL; return true;
+		case MP_QSTR_CTRL: *key = KEY_NSPIRE_CTRL; return true;
+		case MP_QSTR_SHIFT: *key = KEY_NSPIRE_SHIFT; return true;
+		case MP_QSTR_MENU: *key = KEY_NSPIRE_MENU; return true;
+		case MP_QSTR_SPACE: *key = KEY_NSPIRE_SPACE; return true;
+		default: return false;
+	}
+}
+
+static eventloop_obj_t *eventloop_get(mp_obj_t self_in)
+{
+	if(mp_obj_get_type(self_in) != &nsp_eventloop_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	return self_in;
+}
+
+static eventloop_entry_t *eventloop_add(eventloop_obj_t *self, byte kind, mp_obj_t callback)
+{
+	if(self->len == self->alloc)
+	{
+		mp_uint_t alloc = self->alloc ? self->alloc * 2 : 4;
+		self->entries = m_renew(eventloop_entry_t, self->entries, self->alloc, alloc);
+		self->alloc = alloc;
+	}
+
+	eventloop_entry_t *entry = &self->entries[self->len++];
+	entry->id = self->next_id++;
+	entry->kind = kind;
+	entry->pressed = false;
+	entry->sleeping = false;
+	entry->callback = callback;
+	entry->stream = MP_OBJ_NULL;
+	entry->read_size = 0;
+	entry->read_buf = NULL;
+	entry->read_alloc = 0;
+	entry->period = 0;
+	entry->next = entry->last = eventloop_ticks();
+	return entry;
+}
+
+static mp_obj_t nsp_eventloop_make_new(mp_obj_t nobody_cares, uint n_args, uint n_kw, const mp_obj_t *args)
+{
+	mp_arg_check_num(n_args, n_kw, 0, 0, false);
+
+	eventloop_obj_t *self = m_new_obj(eventloop_obj_t);
+	self->base.type = &nsp_eventloop_type;
+	self->entries = NULL;
+	self->len = self->alloc = 0;
+	self->next_id = 1;
+	self->running = self->stopped = false;
+
+	return self;
+}
+
+static mp_obj_t nsp_eventloop_onKey(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t callback)
+{
+	eventloop_obj_t *self = eventloop_get(self_in);
+
+	t_key key;
+	if(!eventloop_get_key(mp_obj_str_get_qstr(key_in), &key))
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Unknown key!"));
+
+	eventloop_entry_t *entry = eventloop_add(self, EVENTLOOP_KEY, callback);
+	entry->key = key;
+	entry->pressed = isKeyPressed(key);
+	return MP_OBJ_NEW_SMALL_INT(entry->id);
+}
+static MP_DEFINE_CONST_FUN_OBJ_3(nsp_eventloop_onKey_obj, nsp_eventloop_onKey);
+
+static mp_obj_t nsp_eventloop_every(mp_obj_t self_in, mp_obj_t ms, mp_obj_t callback)
+{
+	eventloop_obj_t *self = eventloop_get(self_in);
+	uint32_t period = eventloop_ms_to_ticks(mp_obj_get_int(ms));
+
+	eventloop_entry_t *entry = eventloop_add(self, EVENTLOOP_TIMER, callback);
+	entry->period = period ? period : 1;
+	entry->next += entry->period;
+	return MP_OBJ_NEW_SMALL_INT(entry->id);
+}
+static MP_DEFINE_CONST_FUN_OBJ_3(nsp_eventloop_every_obj, nsp_eventloop_every);
+
+static mp_obj_t nsp_eventloop_onFrame(uint n_args, const mp_obj_t *args)
+{
+	eventloop_obj_t *self = eventloop_get(args[0]);
+	mp_int_t fps = n_args == 3 ? mp_obj_get_int(args[2]) : 30;
+	if(fps <= 0)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "fps must be positive!"));
+
+	eventloop_entry_t *entry = eventloop_add(self, EVENTLOOP_FRAME, args[1]);
+	entry->period = NSP_TIMER_HZ / fps ? NSP_TIMER_HZ / fps : 1;
+	return MP_OBJ_NEW_SMALL_INT(entry->id);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_eventloop_onFrame_obj, 2, 3, nsp_eventloop_onFrame);
+
+static mp_obj_t nsp_eventloop_spawn(mp_obj_t self_in, mp_obj_t gen)
+{
+	eventloop_obj_t *self = eventloop_get(self_in);
+	if(!MP_OBJ_IS_TYPE(gen, &mp_type_gen_instance))
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "A generator is needed!"));
+
+	return MP_OBJ_NEW_SMALL_INT(eventloop_add(self, EVENTLOOP_TASK, gen)->id);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(nsp_eventloop_spawn_obj, nsp_eventloop_spawn);
+
+static mp_obj_t nsp_eventloop_cancel(mp_obj_t self_in, mp_obj_t id_in)
+{
+	eventloop_obj_t *self = eventloop_get(self_in);
+	mp_int_t id = mp_obj_get_int(id_in);
+
+	// Only marked here, run() might be iterating over the entries
+	for(mp_uint_t i = 0; i < self->len; ++i)
+		if(self->entries[i].id == id)
+			self->entries[i].callback = MP_OBJ_NULL;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(nsp_eventloop_cancel_obj, nsp_eventloop_cancel);
+
+static mp_obj_t nsp_eventloop_stop(mp_obj_t self_in)
+{
+	eventloop_get(self_in)->stopped = true;
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_eventloop_stop_obj, nsp_eventloop_stop);
+
+static void eventloop_compact(eventloop_obj_t *self)
+{
+	mp_uint_t len = 0;
+	for(mp_uint_t i = 0; i < self->len; ++i)
+	{
+		if(self->entries[i].callback != MP_OBJ_NULL)
+			self->entries[len++] = self->entries[i];
+		else
+			m_del(byte, self->entries[i].read_buf, self->entries[i].read_alloc);
+	}
+
+	// Let the garbage collector have the removed callbacks
+	for(mp_uint_t i = len; i < self->len; ++i)
+	{
+		self->entries[i].callback = self->entries[i].stream = MP_OBJ_NULL;
+		self->entries[i].read_buf = NULL;
+	}
+
+	self->len = len;
+}
+
+// Tries to read for a task waiting on a stream. Returns false if it would block,
+// otherwise sets *data to the result or *error to the exception. Nothing is
+// allocated until there is a result.
+static bool eventloop_try_read(eventloop_entry_t *entry, mp_obj_t *data, mp_obj_t *error)
+{
+	const mp_obj_type_t *type = mp_obj_get_type(entry->stream);
+	byte *buf = entry->read_buf;
+	int errcode;
+	mp_uint_t len = type->stream_p->read(entry->stream, buf, entry->read_size, &errcode);
+
+	if(len == MP_STREAM_ERROR)
+	{
+#if MICROPY_STREAMS_NON_BLOCK
+		if(errcode == EAGAIN || errcode == EWOULDBLOCK)
+			return false;
+#endif
+		*error = mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errcode));
+		return true;
+	}
+
+	if(type->stream_p->is_text)
+		*data = mp_obj_new_str((const char*)buf, len, false);
+	else
+		*data = mp_obj_new_bytes(buf, len);
+	return true;
+}
+
+// Resumes a task and handles what it yielded
+static void eventloop_resume(eventloop_obj_t *self, mp_uint_t i, mp_obj_t send, mp_obj_t error, uint32_t now)
+{
+	mp_obj_t gen = self->entries[i].callback, ret;
+	mp_vm_return_kind_t kind = mp_resume(gen, error == MP_OBJ_NULL ? send : MP_OBJ_NULL, error, &ret);
+
+	// The task may have added entries, which can move them
+	eventloop_entry_t *entry = &self->entries[i];
+	if(kind == MP_VM_RETURN_NORMAL)
+	{
+		entry->callback = MP_OBJ_NULL;
+		return;
+	}
+	if(kind == MP_VM_RETURN_EXCEPTION)
+	{
+		entry->callback = MP_OBJ_NULL;
+		nlr_raise(ret);
+	}
+
+	entry->stream = MP_OBJ_NULL;
+	entry->sleeping = false;
+	if(ret == mp_const_none)
+		return;
+
+	if(MP_OBJ_IS_TYPE(ret, &mp_type_tuple))
+	{
+		mp_obj_t *items;
+		mp_obj_get_array_fixed_n(ret, 2, &items);
+		const mp_obj_type_t *type = mp_obj_get_type(items[0]);
+		mp_int_t size = mp_obj_get_int(items[1]);
+		if(type->stream_p == NULL || type->stream_p->read == NULL || size <= 0)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "A readable stream and a size are needed!"));
+
+		if(entry->read_alloc < (mp_uint_t)size)
+		{
+			entry->read_buf = m_renew(byte, entry->read_buf, entry->read_alloc, size);
+			entry->read_alloc = size;
+		}
+		entry->stream = items[0];
+		entry->read_size = size;
+		return;
+	}
+
+	entry->sleeping = true;
+	entry->next = now + eventloop_ms_to_ticks(mp_obj_get_int(ret));
+}
+
+// One round: every entry which is due is called once
+static void eventloop_round(eventloop_obj_t *self)
+{
+	const uint32_t now = eventloop_ticks();
+	// Entries added by callbacks wait for the next round
+	const mp_uint_t len = self->len;
+
+	for(mp_uint_t i = 0; i < len && !self->stopped; ++i)
+	{
+		eventloop_entry_t *entry = &self->entries[i];
+		mp_obj_t callback = entry->callback;
+		if(callback == MP_OBJ_NULL)
+			continue;
+
+		switch(entry->kind)
+		{
+			case EVENTLOOP_KEY:
+			{
+				bool pressed = isKeyPressed(entry->key);
+				if(pressed != entry->pressed)
+				{
+					entry->pressed = pressed;
+					mp_call_function_1(callback, MP_BOOL(pressed));
+				}
+				break;
+			}
+			case EVENTLOOP_TIMER:
+			case EVENTLOOP_FRAME:
+			{
+				if(!eventloop_due(now, entry->next))
+					break;
+
+				const uint32_t last = entry->last;
+				entry->last = now;
+				// Skip missed periods instead of calling several times in a row
+				entry->next += entry->period;
+				if(eventloop_due(now, entry->next))
+					entry->next = now + entry->period;
+
+				if(entry->kind == EVENTLOOP_TIMER)
+					mp_call_function_0(callback);
+				else
+					mp_call_function_1(callback, mp_obj_new_int_from_uint((uint64_t)(now - last) * 1000 / NSP_TIMER_HZ));
+				break;
+			}
+			case EVENTLOOP_TASK:
+			{
+				mp_obj_t data = mp_const_none, error = MP_OBJ_NULL;
+				if(entry->sleeping && !eventloop_due(now, entry->next))
+					break;
+				if(entry->stream != MP_OBJ_NULL && !eventloop_try_read(entry, &data, &error))
+					break;
+
+				eventloop_resume(self, i, data, error, now);
+				break;
+			}
+		}
+	}
+
+	eventloop_compact(self);
+}
+
+// Idles until the next timer, sleeping task or key change. Streams can't wake
+// the CPU, so tasks waiting on one are polled again after a single idle().
+static void eventloop_wait(eventloop_obj_t *self)
+{
+	uint32_t now = eventloop_ticks(), deadline = now;
+	bool timed = false, keys = false, polling = false;
+
+	for(mp_uint_t i = 0; i < self->len; ++i)
+	{
+		const eventloop_entry_t *entry = &self->entries[i];
+		if(entry->kind == EVENTLOOP_KEY)
+			keys = true;
+		else if(entry->kind == EVENTLOOP_TASK && !entry->sleeping)
+		{
+			if(entry->stream == MP_OBJ_NULL)
+				return; // Ready
+			polling = true;
+		}
+		else if(!timed || (int32_t)(entry->next - deadline) < 0)
+		{
+			deadline = entry->next;
+			timed = true;
+		}
+	}
+
+	if(polling)
+	{
+		idle();
+		return;
+	}
+
+	while(!timed || !eventloop_due(now, deadline))
+	{
+		for(mp_uint_t i = 0; keys && i < self->len; ++i)
+			if(self->entries[i].kind == EVENTLOOP_KEY && isKeyPressed(self->entries[i].key) != self->entries[i].pressed)
+				return;
+
+		idle();
+		now = eventloop_ticks();
+	}
+}
+
+static mp_obj_t nsp_eventloop_run(mp_obj_t self_in)
+{
+	eventloop_obj_t *self = eventloop_get(self_in);
+	if(self->running)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_RuntimeError, "The loop is already running!"));
+
+	self->running = true;
+	self->stopped = false;
+
+	nlr_buf_t nlr;
+	if(nlr_push(&nlr) == 0)
+	{
+		while(!self->stopped && self->len > 0)
+		{
+			eventloop_round(self);
+			if(!self->stopped && self->len > 0)
+				eventloop_wait(self);
+		}
+		nlr_pop();
+	}
+	else
+	{
+		self->running = false;
+		eventloop_compact(self);
+		nlr_raise(nlr.ret_val);
+	}
+
+	self->running = false;
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_eventloop_run_obj, nsp_eventloop_run);
+
+static const mp_map_elem_t nsp_eventloop_locals_dict_table[] = {
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_onKey), (mp_obj_t) &nsp_eventloop_onKey_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_every), (mp_obj_t) &nsp_eventloop_every_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_onFrame), (mp_obj_t) &nsp_eventloop_onFrame_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_spawn), (mp_obj_t) &nsp_eventloop_spawn_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_cancel), (mp_obj_t) &nsp_eventloop_cancel_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_run), (mp_obj_t) &nsp_eventloop_run_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_stop), (mp_obj_t) &nsp_eventloop_stop_obj },
+};
+
+static MP_DEFINE_CONST_DICT(nsp_eventloop_locals_dict, nsp_eventloop_locals_dict_table);
+
+const mp_obj_type_t nsp_eventloop_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_EventLoop,
+    .make_new = nsp_eventloop_make_new,
+    .locals_dict = (mp_obj_t)&nsp_eventloop_locals_dict
+};
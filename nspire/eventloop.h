@@ -0,0 +1 @@
+extern const mp_obj_type_t nsp_eventloop_type;
@@ -38,6 +38,8 @@
 #include "obj.h"
 #include "runtime.h"
 #include "stream.h"
+#include "lexer.h"
+#include "importcache.h"
 
 typedef struct _mp_obj_fdfile_t {
     mp_obj_base_t base;
@@ -164,6 +166,10 @@ STATIC mp_obj_t fdfile_make_new(mp_obj_t type_in, uint n_args, uint n_kw, const
     if (fd == -1) {
         nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
     }
+    if (mode & O_CREAT) {
+        // The file may not have existed before, cached import lookups are stale
+        nsp_import_cache_invalidate();
+    }
     o->fd = fd;
     return o;
 }
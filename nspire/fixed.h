@@ -0,0 +1,39 @@
+#include <stdint.h>
+
+// Q16.16 fixed point: 16 integer bits, 16 fractional bits. Arithmetic and
+// conversion from int wrap around modulo 2^32 of the raw value, which is done
+// in uint32_t because signed overflow is undefined.
+typedef int32_t fix16_t;
+
+#define FIX16_ONE (1 << 16)
+#define FIX16_FROM_INT(i) ((fix16_t)((uint32_t)(i) << 16))
+
+static inline fix16_t fix16_add(fix16_t a, fix16_t b) {
+    return (uint32_t)a + (uint32_t)b;
+}
+
+static inline fix16_t fix16_sub(fix16_t a, fix16_t b) {
+    return (uint32_t)a - (uint32_t)b;
+}
+
+static inline fix16_t fix16_mul(fix16_t a, fix16_t b) {
+    return ((int64_t)a * b) >> 16;
+}
+
+// b must not be 0
+static inline fix16_t fix16_div(fix16_t a, fix16_t b) {
+    return ((int64_t)a * FIX16_ONE) / b;
+}
+
+// Angles in radians
+fix16_t fix16_sin(fix16_t a);
+fix16_t fix16_cos(fix16_t a);
+// a must not be negative
+fix16_t fix16_sqrt(fix16_t a);
+
+extern const mp_obj_type_t mp_type_fix16;
+extern const mp_obj_module_t mp_module_fixed;
+
+mp_obj_t fix16_new(fix16_t val);
+// Accepts Q16, int and float, raises OverflowError for floats out of range
+fix16_t fix16_from_obj(mp_obj_t obj);
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "texture.h"
+#include "font.h"
+
+/*
+ * Proportional bitmap fonts.
+ *
+ * Small example:
+ *
+ * from nsp import Texture, Font
+ * font = Font("/documents/fonts/sans12.nfnt.tns")
+ * t = Texture(320, 240, None)
+ * t.fill(0xFFFF)
+ * x = t.drawText(font, "Score: ", 4, 4, 0x0000)
+ * t.drawText(font, str(1234), x, 4, 0xF800)
+ * t.display()
+ *
+ * Font(path) loads a font file, Font(data) parses a bytes-like object. The glyphs are
+ * rasterized into an atlas once, Texture.drawText then only copies the set pixels.
+ * tools/mkfont.py converts BDF fonts into this format.
+ *
+ * Available functions:
+ * width(str): Returns the width of str in pixels, of the longest line if there are
+ *   several. The widths of the last strings measured are cached.
+ * height(): Returns the height of a line in pixels.
+ * Texture.drawText(font, str, x, y, color): Draws str with its top left corner at (x/y)
+ *   and returns the x position after the last character. '\n' starts a new line.
+ *   Glyphs are clipped to the texture, characters missing in the font are drawn as '?'.
+ *
+ * File format, all numbers little endian:
+ * Header: "NSPF", version (1), line height, ascent, first character,
+ *   number of glyphs (16 bits), number of kerning pairs (16 bits).
+ * Glyph table, 3 bytes each: bitmap width, advance, x offset (signed).
+ * Kerning table, 3 bytes each, sorted: left character, right character, adjustment (signed).
+ * Bitmaps of all glyphs: each has line height rows of (width + 7) / 8 bytes,
+ *   the most significant bit is the leftmost pixel.
+ */
+
+#define NSP_FONT_HEADER_SIZE 12
+#define NSP_FONT_CACHE_SIZE 8
+
+typedef struct nsp_font_glyph_t
+{
+	uint16_t atlas_x;
+	uint8_t width, advance;
+	int8_t x_offset;
+} nsp_font_glyph_t;
+
+typedef struct nsp_font_width_t
+{
+	mp_obj_t str;
+	mp_int_t width;
+} nsp_font_width_t;
+
+typedef struct nsp_font_obj_t
+{
+	mp_obj_base_t base;
+	uint8_t height, ascent, first;
+	uint16_t count, n_kerning;
+	nsp_font_glyph_t *glyphs;
+	uint16_t *kerning_pairs; // left << 8 | right, sorted
+	int8_t *kerning;
+	uint32_t kerning_left[256 / 32]; // Characters which have kerning pairs
+	uint8_t *atlas; // One byte per pixel, the glyphs next to each other
+	uint16_t atlas_width;
+	nsp_font_width_t cache[NSP_FONT_CACHE_SIZE];
+} nsp_font_obj_t;
+
+static void nsp_font_invalid()
+{
+	nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid font file!"));
+}
+
+static void nsp_font_parse(nsp_font_obj_t *self, const uint8_t *data, mp_uint_t len)
+{
+	if(len < NSP_FONT_HEADER_SIZE || memcmp(data, "NSPF", 4) != 0 || data[4] != 1)
+		nsp_font_invalid();
+
+	self->height = data[5];
+	self->ascent = data[6];
+	self->first = data[7];
+	self->count = data[8] | data[9] << 8;
+	self->n_kerning = data[10] | data[11] << 8;
+	if(self->first + self->count > 256)
+		nsp_font_invalid();
+
+	const uint8_t *glyph_table = data + NSP_FONT_HEADER_SIZE;
+	const uint8_t *kerning_table = glyph_table + self->count * 3;
+	const uint8_t *bitmaps = kerning_table + self->n_kerning * 3;
+	if(bitmaps > data + len)
+		nsp_font_invalid();
+
+	self->glyphs = m_new(nsp_font_glyph_t, self->count);
+	mp_uint_t atlas_width = 0, bitmap_size = 0;
+	for(unsigned int i = 0; i < self->count; ++i)
+	{
+		nsp_font_glyph_t *glyph = &self->glyphs[i];
+		glyph->atlas_x = atlas_width;
+		glyph->width = glyph_table[i * 3];
+		glyph->advance = glyph_table[i * 3 + 1];
+		glyph->x_offset = glyph_table[i * 3 + 2];
+		atlas_width += glyph->width;
+		bitmap_size += (glyph->width + 7) / 8 * self->height;
+	}
+	if(atlas_width > 0xFFFF || bitmap_size > (mp_uint_t)(data + len - bitmaps))
+		nsp_font_invalid();
+
+	self->kerning_pairs = m_new(uint16_t, self->n_kerning);
+	self->kerning = m_new(int8_t, self->n_kerning);
+	memset(self->kerning_left, 0, sizeof(self->kerning_left));
+	for(unsigned int i = 0; i < self->n_kerning; ++i)
+	{
+		const uint8_t *pair = kerning_table + i * 3;
+		self->kerning_pairs[i] = pair[0] << 8 | pair[1];
+		self->kerning[i] = pair[2];
+		self->kerning_left[pair[0] / 32] |= 1u << (pair[0] % 32);
+		if(i > 0 && self->kerning_pairs[i] <= self->kerning_pairs[i - 1])
+			nsp_font_invalid();
+	}
+
+	// Rasterize all glyphs into the atlas
+	self->atlas_width = atlas_width;
+	self->atlas = m_new(uint8_t, atlas_width * self->height);
+	const uint8_t *bits = bitmaps;
+	for(unsigned int i = 0; i < self->count; ++i)
+	{
+		const nsp_font_glyph_t *glyph = &self->glyphs[i];
+		const unsigned int stride = (glyph->width + 7) / 8;
+		for(unsigned int y = 0; y < self->height; ++y, bits += stride)
+		{
+			uint8_t *row = self->atlas + glyph->atlas_x + y * atlas_width;
+			for(unsigned int x = 0; x < glyph->width; ++x)
+				row[x] = (bits[x / 8] >> (7 - x % 8)) & 1;
+		}
+	}
+}
+
+static mp_obj_t nsp_font_make_new(mp_obj_t nobody_cares, uint n_args, uint n_kw, const mp_obj_t *args)
+{
+	mp_arg_check_num(n_args, n_kw, 1, 1, false);
+
+	nsp_font_obj_t *self = m_new_obj(nsp_font_obj_t);
+	memset(self, 0, sizeof(*self));
+	self->base.type = &nsp_font_type;
+
+	if(!MP_OBJ_IS_STR(args[0]))
+	{
+		mp_buffer_info_t bufinfo;
+		mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+		nsp_font_parse(self, bufinfo.buf, bufinfo.len);
+		return self;
+	}
+
+	const char *path = mp_obj_str_get_str(args[0]);
+	FILE *file = fopen(path, "rb");
+	if(!file)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not open font file!"));
+
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t *data = len > 0 ? m_new_maybe(uint8_t, len) : NULL;
+	bool ok = data && fread(data, 1, len, file) == (size_t)len;
+	fclose(file);
+
+	if(!ok)
+	{
+		if(data)
+			m_del(uint8_t, data, len);
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not read font file!"));
+	}
+
+	// If parsing fails, the garbage collector takes care of data
+	nsp_font_parse(self, data, len);
+	m_del(uint8_t, data, len);
+
+	return self;
+}
+
+static void nsp_font_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind)
+{
+	nsp_font_obj_t *self = self_in;
+	print(env, "Font (height=%u, glyphs=%u, kerning=%u)", self->height, self->count, self->n_kerning);
+}
+
+// Next character of the UTF-8 string, Latin-1 bytes are taken as they are
+static unsigned int nsp_font_next_char(const byte **str, const byte *end)
+{
+	const byte *s = *str;
+	unsigned int c = *s++;
+	if(c >= 0xC0 && c < 0xF8 && s < end && (*s & 0xC0) == 0x80)
+	{
+		unsigned int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+		c &= 0x3F >> extra;
+		for(; extra && s < end && (*s & 0xC0) == 0x80; --extra)
+			c = c << 6 | (*s++ & 0x3F);
+	}
+	*str = s;
+	return c;
+}
+
+static const nsp_font_glyph_t *nsp_font_glyph(const nsp_font_obj_t *self, unsigned int c)
+{
+	if(c >= self->first && c - self->first < self->count)
+		return &self->glyphs[c - self->first];
+	if('?' >= self->first && '?' - self->first < self->count)
+		return &self->glyphs['?' - self->first];
+	return NULL;
+}
+
+static int nsp_font_kerning(const nsp_font_obj_t *self, unsigned int left, unsigned int right)
+{
+	if(left > 0xFF || right > 0xFF || !(self->kerning_left[left / 32] & (1u << (left % 32))))
+		return 0;
+
+	const uint16_t key = left << 8 | right;
+	int lo = 0, hi = self->n_kerning - 1;
+	while(lo <= hi)
+	{
+		const int mid = (lo + hi) / 2;
+		if(self->kerning_pairs[mid] == key)
+			return self->kerning[mid];
+		if(self->kerning_pairs[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return 0;
+}
+
+static nsp_font_obj_t *nsp_font_get(mp_obj_t font)
+{
+	if(mp_obj_get_type(font) != &nsp_font_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	return font;
+}
+
+static mp_int_t nsp_font_measure(const nsp_font_obj_t *self, const byte *str, mp_uint_t len)
+{
+	const byte *end = str + len;
+	mp_int_t x = 0, width = 0;
+	unsigned int prev = 0x100;
+
+	while(str < end)
+	{
+		const unsigned int c = nsp_font_next_char(&str, end);
+		if(c == '\n')
+		{
+			if(x > width)
+				width = x;
+			x = 0;
+			prev = 0x100;
+			continue;
+		}
+
+		const nsp_font_glyph_t *glyph = nsp_font_glyph(self, c);
+		if(!glyph)
+			continue;
+
+		x += nsp_font_kerning(self, prev, c) + glyph->advance;
+		prev = c;
+	}
+
+	return x > width ? x : width;
+}
+
+// Strings are immutable, so the object itself is the key of the cache
+static mp_int_t nsp_font_cached_width(nsp_font_obj_t *self, mp_obj_t str)
+{
+	nsp_font_width_t *entry = &self->cache[((uintptr_t)str >> 3) % NSP_FONT_CACHE_SIZE];
+	if(entry->str == str)
+		return entry->width;
+
+	mp_uint_t len;
+	const char *data = mp_obj_str_get_data(str, &len);
+	entry->width = nsp_font_measure(self, (const byte*)data, len);
+	entry->str = str;
+	return entry->width;
+}
+
+static mp_obj_t nsp_font_width(mp_obj_t self_in, mp_obj_t str)
+{
+	return mp_obj_new_int(nsp_font_cached_width(nsp_font_get(self_in), str));
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(nsp_font_width_obj, nsp_font_width);
+
+static mp_obj_t nsp_font_height(mp_obj_t self_in)
+{
+	return MP_OBJ_NEW_SMALL_INT(nsp_font_get(self_in)->height);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_font_height_obj, nsp_font_height);
+
+mp_int_t nsp_font_draw(struct nsp_texture_obj_t *tex, mp_obj_t font, mp_obj_t str, mp_int_t x, mp_int_t y, uint16_t color)
+{
+	nsp_font_obj_t *self = nsp_font_get(font);
+	const mp_int_t start_x = x;
+	mp_uint_t len;
+	const byte *s = (const byte*)mp_obj_str_get_data(str, &len), *end = s + len;
+	unsigned int prev = 0x100;
+
+	while(s < end)
+	{
+		const unsigned int c = nsp_font_next_char(&s, end);
+		if(c == '\n')
+		{
+			x = start_x;
+			y += self->height;
+			prev = 0x100;
+			continue;
+		}
+
+		const nsp_font_glyph_t *glyph = nsp_font_glyph(self, c);
+		if(!glyph)
+			continue;
+
+		x += nsp_font_kerning(self, prev, c);
+		prev = c;
+
+		// Clip the glyph to the texture
+		const mp_int_t gx = x + glyph->x_offset;
+		mp_int_t x0 = gx < 0 ? 0 : gx, x1 = gx + glyph->width;
+		mp_int_t y0 = y < 0 ? 0 : y, y1 = y + self->height;
+		if(x1 > tex->width)
+			x1 = tex->width;
+		if(y1 > tex->height)
+			y1 = tex->height;
+
+		for(mp_int_t py = y0; x0 < x1 && py < y1; ++py)
+		{
+			const uint8_t *mask = self->atlas + glyph->atlas_x + (py - y) * self->atlas_width + (x0 - gx);
+			uint16_t *px = tex->bitmap + x0 + py * tex->width, *px_end = px + (x1 - x0);
+			for(; px < px_end; ++px, ++mask)
+				if(*mask)
+					*px = color;
+		}
+
+		x += glyph->advance;
+	}
+
+	return x;
+}
+
+static const mp_map_elem_t nsp_font_locals_dict_table[] = {
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_width), (mp_obj_t) &nsp_font_width_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_height), (mp_obj_t) &nsp_font_height_obj },
+};
+
+static MP_DEFINE_CONST_DICT(nsp_font_locals_dict, nsp_font_locals_dict_table);
+
+const mp_obj_type_t nsp_font_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Font,
+	.print = nsp_font_print,
+    .make_new = nsp_font_make_new,
+    .locals_dict = (mp_obj_t)&nsp_font_locals_dict
+};
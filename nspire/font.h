@@ -0,0 +1,4 @@
+extern const mp_obj_type_t nsp_font_type;
+
+// Draws str onto tex, returns the x position after the last character
+mp_int_t nsp_font_draw(struct nsp_texture_obj_t *tex, mp_obj_t font, mp_obj_t str, mp_int_t x, mp_int_t y, uint16_t color);
@@ -28,6 +28,9 @@
 
 #include "py/mpstate.h"
 #include "py/gc.h"
+#include "py/obj.h"
+#include "timer.h"
+#include "hud.h"
 
 #if MICROPY_ENABLE_GC
 
@@ -125,6 +128,7 @@ STATIC void gc_helper_get_regs(regs_t arr) {
 void gc_collect(void) {
     //gc_dump_info();
 
+    uint32_t start = nsp_timer_ticks();
     gc_collect_start();
     regs_t regs;
     gc_helper_get_regs(regs);
@@ -132,6 +136,7 @@ void gc_collect(void) {
     void **regs_ptr = (void**)(void*)&regs;
     gc_collect_root(regs_ptr, ((mp_uint_t)MP_STATE_VM(stack_top) - (mp_uint_t)&regs) / sizeof(mp_uint_t));
     gc_collect_end();
+    nsp_hud_gc_collected(start);
 
     //printf("-----\n");
     //gc_dump_info();
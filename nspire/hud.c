@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "gc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "timer.h"
+#include "hud.h"
+
+#include <libndls.h>
+
+/*
+ * Frame-time and memory HUD.
+ *
+ * Small example:
+ *
+ * import nsp
+ * nsp.hud(True)
+ *
+ * Once enabled, every Texture.display() draws a strip over the top lines of the
+ * screen (the texture itself is left untouched) showing, updated once per second:
+ * FPS, frame time min/avg/max in ms, GC heap used/free and duration and age of the
+ * last garbage collection.
+ *
+ * hud(): Returns whether the HUD is enabled.
+ * hud(enable): Enables or disables the HUD. Only available on CX models.
+ */
+
+#define HUD_HEIGHT 7
+#define HUD_FG 0xFFFF
+#define HUD_BG 0x0000
+
+bool nsp_hud_enabled = false;
+
+// Stats of the current one-second window
+static uint32_t last_frame, window_start, window_frames, window_sum, window_min, window_max;
+// Stats of the last complete window, these are shown
+static uint32_t shown_fps10, shown_min, shown_avg, shown_max;
+// gc_info() walks the whole heap, so it's only asked once per window
+static uint32_t shown_used, shown_free;
+
+static bool gc_seen;
+static uint32_t gc_last, gc_duration;
+
+/* 3x5 font for ' ' to 'Z', row-major, MSB is the top left pixel */
+static const uint16_t hud_font[] = {
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x52a5, 0x0000, 0x0000,
+	0x2922, 0x224a, 0x0000, 0x05d0, 0x0014, 0x01c0, 0x0002, 0x12a4,
+	0x7b6f, 0x2c97, 0x73e7, 0x72cf, 0x5bc9, 0x79cf, 0x79ef, 0x7292,
+	0x7bef, 0x7bcf, 0x0410, 0x0000, 0x0000, 0x0e38, 0x0000, 0x0000,
+	0x0000, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b,
+	0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a,
+	0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd,
+	0x5aad, 0x5a92, 0x72a7,
+};
+
+static void hud_update_heap()
+{
+	gc_info_t info;
+	gc_info(&info);
+	shown_used = info.used;
+	shown_free = info.free;
+}
+
+static void hud_reset()
+{
+	last_frame = window_start = nsp_timer_ticks();
+	window_frames = window_sum = window_max = 0;
+	window_min = UINT32_MAX;
+	shown_fps10 = shown_min = shown_avg = shown_max = 0;
+	hud_update_heap();
+}
+
+void nsp_hud_gc_collected(uint32_t start)
+{
+	if(!nsp_hud_enabled)
+		return;
+
+	gc_last = nsp_timer_ticks();
+	gc_duration = gc_last - start;
+	gc_seen = true;
+}
+
+// Ticks to tenths of milliseconds
+static uint32_t hud_ticks_to_tms(uint32_t ticks)
+{
+	return (uint64_t) ticks * 10000 / NSP_TIMER_HZ;
+}
+
+static void hud_draw_text(uint16_t *screen, unsigned int x, const char *str)
+{
+	for(; *str && x + 3 <= 320; str++, x += 4)
+	{
+		char c = *str;
+		if(c >= 'a' && c <= 'z')
+			c -= 'a' - 'A';
+
+		if(c < ' ' || c > 'Z')
+			continue;
+
+		uint16_t glyph = hud_font[c - ' '];
+		uint16_t *line = screen + 320 + x;
+		for(unsigned int bit = 1 << 14; bit; bit >>= 3, line += 320)
+		{
+			if(glyph & bit) line[0] = HUD_FG;
+			if(glyph & (bit >> 1)) line[1] = HUD_FG;
+			if(glyph & (bit >> 2)) line[2] = HUD_FG;
+		}
+	}
+}
+
+void nsp_hud_frame(uint16_t *screen)
+{
+	uint32_t now = nsp_timer_ticks();
+	uint32_t frame = now - last_frame;
+	last_frame = now;
+
+	window_frames++;
+	window_sum += frame;
+	if(frame < window_min) window_min = frame;
+	if(frame > window_max) window_max = frame;
+
+	uint32_t window = now - window_start;
+	if(window >= NSP_TIMER_HZ)
+	{
+		shown_fps10 = (uint64_t) window_frames * NSP_TIMER_HZ * 10 / window;
+		shown_min = hud_ticks_to_tms(window_min);
+		shown_avg = hud_ticks_to_tms(window_sum / window_frames);
+		shown_max = hud_ticks_to_tms(window_max);
+		hud_update_heap();
+		// Not part of the next frame
+		last_frame = nsp_timer_ticks();
+
+		window_start = now;
+		window_frames = window_sum = window_max = 0;
+		window_min = UINT32_MAX;
+	}
+
+	char text[81];
+	int len = snprintf(text, sizeof(text), "FPS %lu.%lu MS %lu.%lu/%lu.%lu/%lu.%lu HEAP %luK/%luK",
+	                   (unsigned long) shown_fps10 / 10, (unsigned long) shown_fps10 % 10,
+	                   (unsigned long) shown_min / 10, (unsigned long) shown_min % 10,
+	                   (unsigned long) shown_avg / 10, (unsigned long) shown_avg % 10,
+	                   (unsigned long) shown_max / 10, (unsigned long) shown_max % 10,
+	                   (unsigned long) shown_used / 1024, (unsigned long) shown_free / 1024);
+
+	if(gc_seen && len > 0 && len < (int) sizeof(text))
+	{
+		uint32_t duration = hud_ticks_to_tms(gc_duration);
+		snprintf(text + len, sizeof(text) - len, " GC %lu.%luMS %luS AGO",
+		         (unsigned long) duration / 10, (unsigned long) duration % 10,
+		         (unsigned long) (now - gc_last) / NSP_TIMER_HZ);
+	}
+
+	uint16_t *ptr = screen, *end = screen + 320 * HUD_HEIGHT;
+	while(ptr < end)
+		*ptr++ = HUD_BG;
+
+	hud_draw_text(screen, 1, text);
+}
+
+static mp_obj_t nsp_hud(uint n_args, const mp_obj_t *args)
+{
+	if(n_args == 0)
+		return MP_BOOL(nsp_hud_enabled);
+
+	bool enable = mp_obj_is_true(args[0]);
+	if(enable && !nsp_timer_start())
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "The HUD requires a CX!"));
+
+	if(enable && !nsp_hud_enabled)
+	{
+		hud_reset();
+		gc_seen = false;
+	}
+
+	nsp_hud_enabled = enable;
+
+	return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_hud_obj, 0, 1, nsp_hud);
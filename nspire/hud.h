@@ -0,0 +1,8 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+extern bool nsp_hud_enabled;
+extern const mp_obj_fun_builtin_t nsp_hud_obj;
+
+void nsp_hud_frame(uint16_t *screen);
+void nsp_hud_gc_collected(uint32_t start);
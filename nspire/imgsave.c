@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "texture.h"
+#include "imgsave.h"
+#include "importcache.h"
+#include "extmod/uzlib/tinf.h"
+
+/*
+ * Small example:
+ *
+ * from nsp import Texture
+ * t = Texture(320, 240, None)
+ * t.fill(0x001F)
+ * t.save("/documents/shot.png.tns")
+ * t.save("/documents/shot.bmp.tns", "bmp")
+ *
+ * Backend of Texture.save(path, fmt). The image is converted and written row by row, so
+ * apart from a few row buffers only the state of the compressor is allocated (about 20 KiB),
+ * whatever the size of the texture. The file is removed again if writing fails.
+ *
+ * BMP: 16-bit with RGB565 bit masks, which is exactly the texture data. Uncompressed.
+ * PNG: 8-bit RGB. Every row gets the filter with the smallest sum of absolute values and the
+ *      result is deflated with a 4 KiB window into IDAT chunks of 4 KiB.
+ *      If the texture has a transparent color, it's stored in a tRNS chunk.
+ */
+
+#define PNG_WBITS 12
+#define PNG_HBITS 12
+#define PNG_IDAT_SIZE 4096
+
+typedef struct {
+	int fd;
+	uint8_t *idat;
+	unsigned int idat_len;
+} png_out_t;
+
+static void imgsave_write(int fd, const void *buf, size_t len)
+{
+	while(len > 0)
+	{
+		int r = write(fd, buf, len);
+		if(r <= 0)
+			nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(r < 0 ? errno : EIO)));
+
+		buf = (const uint8_t*)buf + r;
+		len -= r;
+	}
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	put_le16(p, v);
+	put_le16(p + 2, v >> 16);
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void save_bmp(nsp_texture_obj_t *tex, int fd)
+{
+	unsigned int row_size = (tex->width * 2 + 3) & ~3u;
+	uint32_t data_size = row_size * tex->height;
+	uint8_t hdr[66];
+
+	// BITMAPFILEHEADER
+	memset(hdr, 0, sizeof(hdr));
+	hdr[0] = 'B';
+	hdr[1] = 'M';
+	put_le32(hdr + 2, sizeof(hdr) + data_size);
+	put_le32(hdr + 10, sizeof(hdr));
+	// BITMAPINFOHEADER, positive height: rows are stored bottom-up
+	put_le32(hdr + 14, 40);
+	put_le32(hdr + 18, tex->width);
+	put_le32(hdr + 22, tex->height);
+	put_le16(hdr + 26, 1);
+	put_le16(hdr + 28, 16);
+	put_le32(hdr + 30, 3); // BI_BITFIELDS
+	put_le32(hdr + 34, data_size);
+	put_le32(hdr + 38, 2835); // 72 DPI
+	put_le32(hdr + 42, 2835);
+	// Masks of red, green and blue
+	put_le32(hdr + 54, 0xF800);
+	put_le32(hdr + 58, 0x07E0);
+	put_le32(hdr + 62, 0x001F);
+	imgsave_write(fd, hdr, sizeof(hdr));
+
+	uint8_t *row = m_new(uint8_t, row_size);
+	memset(row, 0, row_size);
+	for(int y = tex->height - 1; y >= 0; --y)
+	{
+		const uint16_t *src = tex->bitmap + y * tex->width;
+		for(unsigned int x = 0; x < tex->width; ++x)
+			put_le16(row + x * 2, src[x]);
+
+		imgsave_write(fd, row, row_size);
+	}
+	m_del(uint8_t, row, row_size);
+}
+
+static void png_chunk(int fd, const char *type, const uint8_t *data, uint32_t len)
+{
+	uint8_t buf[8];
+	put_be32(buf, len);
+	memcpy(buf + 4, type, 4);
+	imgsave_write(fd, buf, 8);
+	imgsave_write(fd, data, len);
+
+	uint32_t crc = tinf_crc32_update(0, type, 4);
+	crc = tinf_crc32_update(crc, data, len);
+	put_be32(buf, crc);
+	imgsave_write(fd, buf, 4);
+}
+
+// Output of the compressor, collected into IDAT chunks
+static void png_idat_write(TINF_DEFLATE *d, const unsigned char *buf, unsigned int len)
+{
+	png_out_t *out = d->user;
+	while(len > 0)
+	{
+		unsigned int n = PNG_IDAT_SIZE - out->idat_len;
+		if(n > len)
+			n = len;
+
+		memcpy(out->idat + out->idat_len, buf, n);
+		out->idat_len += n;
+		buf += n;
+		len -= n;
+
+		if(out->idat_len == PNG_IDAT_SIZE)
+		{
+			png_chunk(out->fd, "IDAT", out->idat, out->idat_len);
+			out->idat_len = 0;
+		}
+	}
+}
+
+static inline unsigned int expand5(unsigned int v)
+{
+	return (v << 3) | (v >> 2);
+}
+
+static inline unsigned int expand6(unsigned int v)
+{
+	return (v << 2) | (v >> 4);
+}
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if(pa <= pb && pa <= pc)
+		return a;
+
+	return pb <= pc ? b : c;
+}
+
+// Filter type f applied to byte i of the row cur, prev is the row above
+static inline uint8_t png_filter(int f, const uint8_t *cur, const uint8_t *prev, unsigned int i)
+{
+	int a = i >= 3 ? cur[i - 3] : 0, b = prev[i], c = i >= 3 ? prev[i - 3] : 0;
+	switch(f)
+	{
+	case 1:
+		return cur[i] - a;
+	case 2:
+		return cur[i] - b;
+	case 3:
+		return cur[i] - ((a + b) >> 1);
+	case 4:
+		return cur[i] - paeth(a, b, c);
+	default:
+		return cur[i];
+	}
+}
+
+static void save_png(nsp_texture_obj_t *tex, int fd)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	imgsave_write(fd, signature, sizeof(signature));
+
+	uint8_t ihdr[13];
+	put_be32(ihdr, tex->width);
+	put_be32(ihdr + 4, tex->height);
+	ihdr[8] = 8; // Bit depth
+	ihdr[9] = 2; // RGB
+	ihdr[10] = 0; // Deflate
+	ihdr[11] = 0; // Adaptive filtering
+	ihdr[12] = 0; // Not interlaced
+	png_chunk(fd, "IHDR", ihdr, sizeof(ihdr));
+
+	if(tex->has_transparency)
+	{
+		uint16_t c = tex->transparent_color;
+		uint8_t trns[6] = { 0, expand5(c >> 11), 0, expand6((c >> 5) & 0x3F), 0, expand5(c & 0x1F) };
+		png_chunk(fd, "tRNS", trns, sizeof(trns));
+	}
+
+	unsigned int row_size = tex->width * 3;
+	uint8_t *cur = m_new(uint8_t, row_size), *prev = m_new(uint8_t, row_size), *filtered = m_new(uint8_t, row_size + 1);
+	memset(prev, 0, row_size);
+
+	png_out_t out;
+	out.fd = fd;
+	out.idat = m_new(uint8_t, PNG_IDAT_SIZE);
+	out.idat_len = 0;
+
+	TINF_DEFLATE d;
+	d.window = m_new(uint8_t, TINF_DEFLATE_WINDOW_SIZE(PNG_WBITS));
+	d.head = m_new(unsigned short, 1 << PNG_HBITS);
+	d.prev = NULL;
+	d.syms = NULL;
+	d.write = png_idat_write;
+	d.user = &out;
+
+	// zlib header: deflate, window of 1 << PNG_WBITS, FCHECK makes it a multiple of 31
+	uint8_t zhdr[2] = { ((PNG_WBITS - 8) << 4) | 8, 0 };
+	zhdr[1] = (31 - (zhdr[0] << 8) % 31) % 31;
+	png_idat_write(&d, zhdr, 2);
+
+	tinf_deflate_init(&d, PNG_WBITS, PNG_HBITS, 1);
+	uint32_t adler = 1;
+
+	for(unsigned int y = 0; y < tex->height; ++y)
+	{
+		const uint16_t *src = tex->bitmap + y * tex->width;
+		for(unsigned int x = 0; x < tex->width; ++x)
+		{
+			cur[x * 3] = expand5(src[x] >> 11);
+			cur[x * 3 + 1] = expand6((src[x] >> 5) & 0x3F);
+			cur[x * 3 + 2] = expand5(src[x] & 0x1F);
+		}
+
+		int best = 0;
+		uint32_t best_sum = UINT32_MAX;
+		for(int f = 0; f < 5; ++f)
+		{
+			uint32_t sum = 0;
+			for(unsigned int i = 0; i < row_size && sum < best_sum; ++i)
+				sum += abs((int8_t) png_filter(f, cur, prev, i));
+
+			if(sum < best_sum)
+			{
+				best_sum = sum;
+				best = f;
+			}
+		}
+
+		filtered[0] = best;
+		for(unsigned int i = 0; i < row_size; ++i)
+			filtered[i + 1] = png_filter(best, cur, prev, i);
+
+		adler = tinf_adler32_update(adler, filtered, row_size + 1);
+		tinf_deflate_write(&d, filtered, row_size + 1);
+
+		uint8_t *tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+
+	tinf_deflate_finish(&d);
+	uint8_t trailer[4];
+	put_be32(trailer, adler);
+	png_idat_write(&d, trailer, 4);
+	if(out.idat_len)
+		png_chunk(fd, "IDAT", out.idat, out.idat_len);
+
+	png_chunk(fd, "IEND", NULL, 0);
+
+	m_del(uint8_t, d.window, TINF_DEFLATE_WINDOW_SIZE(PNG_WBITS));
+	m_del(unsigned short, d.head, 1 << PNG_HBITS);
+	m_del(uint8_t, out.idat, PNG_IDAT_SIZE);
+	m_del(uint8_t, filtered, row_size + 1);
+	m_del(uint8_t, prev, row_size);
+	m_del(uint8_t, cur, row_size);
+}
+
+void nsp_imgsave(nsp_texture_obj_t *tex, const char *path, int format)
+{
+	if(!tex->bitmap)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "The texture has been deleted!"));
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
+
+#ifndef NSP_HOST
+	nsp_import_cache_invalidate();
+#endif
+
+	nlr_buf_t nlr;
+	if(nlr_push(&nlr) == 0)
+	{
+		if(format == NSP_IMGSAVE_PNG)
+			save_png(tex, fd);
+		else
+			save_bmp(tex, fd);
+
+		nlr_pop();
+	}
+	else
+	{
+		// Don't leave a truncated image behind
+		close(fd);
+		unlink(path);
+		nlr_raise(nlr.ret_val);
+	}
+
+	if(close(fd) != 0)
+		nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno)));
+}
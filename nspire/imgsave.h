@@ -0,0 +1,5 @@
+#define NSP_IMGSAVE_BMP 0
+#define NSP_IMGSAVE_PNG 1
+
+// Writes tex to the file path in the given format
+void nsp_imgsave(struct nsp_texture_obj_t *tex, const char *path, int format);
@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+
+#include "mpconfig.h"
+#include "misc.h"
+#include "qstr.h"
+#include "lexer.h"
+#include "importcache.h"
+
+/*
+ * Cache for mp_import_stat.
+ *
+ * Every import probes "dir/name" and "dir/name.py" for each entry of sys.path,
+ * which means several stat() calls on the (slow) flash filesystem per import.
+ * Instead, the first probe into a directory reads its listing once and keeps the
+ * names in memory. Probes for names which aren't in the listing are answered
+ * without touching the filesystem, names which are get stat()ed once and the
+ * result is remembered.
+ *
+ * The cache lives as long as the interpreter and is thrown away whenever the
+ * script creates, removes or renames something (see nsp_import_cache_invalidate).
+ */
+
+#define IMPORT_CACHE_DIRS (8)
+
+enum {
+    ENTRY_UNKNOWN = 0,
+    ENTRY_FILE,
+    ENTRY_DIR,
+    ENTRY_OTHER,
+};
+
+typedef struct _import_cache_dir_t {
+    char *path;
+    // Packed entries: one type byte followed by the 0-terminated name
+    char *entries;
+    uint entries_len;
+} import_cache_dir_t;
+
+static import_cache_dir_t cache_dirs[IMPORT_CACHE_DIRS];
+static uint cache_next;
+
+static void import_cache_dir_free(import_cache_dir_t *d)
+{
+    free(d->path);
+    free(d->entries);
+    d->path = NULL;
+    d->entries = NULL;
+    d->entries_len = 0;
+}
+
+static bool import_cache_dir_fill(import_cache_dir_t *d, const char *dir_path, uint dir_len)
+{
+    d->path = malloc(dir_len + 1);
+    if (!d->path)
+        return false;
+
+    memcpy(d->path, dir_path, dir_len);
+    d->path[dir_len] = 0;
+
+    DIR *dir = opendir(d->path);
+    if (!dir)
+        return true; // Directory doesn't exist: no entries, every probe misses
+
+    uint alloc = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        uint name_len = strlen(de->d_name);
+        if (d->entries_len + name_len + 2 > alloc) {
+            uint new_alloc = alloc ? alloc * 2 : 256;
+            while (new_alloc < d->entries_len + name_len + 2)
+                new_alloc *= 2;
+            char *new_entries = realloc(d->entries, new_alloc);
+            if (!new_entries) {
+                closedir(dir);
+                import_cache_dir_free(d);
+                return false;
+            }
+            d->entries = new_entries;
+            alloc = new_alloc;
+        }
+        d->entries[d->entries_len++] = ENTRY_UNKNOWN;
+        memcpy(d->entries + d->entries_len, de->d_name, name_len + 1);
+        d->entries_len += name_len + 1;
+    }
+    closedir(dir);
+
+    return true;
+}
+
+static import_cache_dir_t *import_cache_get_dir(const char *dir_path, uint dir_len)
+{
+    for (uint i = 0; i < IMPORT_CACHE_DIRS; i++) {
+        import_cache_dir_t *d = &cache_dirs[i];
+        if (d->path && strncmp(d->path, dir_path, dir_len) == 0 && d->path[dir_len] == 0)
+            return d;
+    }
+
+    // Not cached yet, replace the oldest slot
+    import_cache_dir_t *d = &cache_dirs[cache_next];
+    cache_next = (cache_next + 1) % IMPORT_CACHE_DIRS;
+    import_cache_dir_free(d);
+
+    if (!import_cache_dir_fill(d, dir_path, dir_len))
+        return NULL;
+
+    return d;
+}
+
+static mp_import_stat_t import_stat_uncached(const char *path, char *type)
+{
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) {
+            *type = ENTRY_DIR;
+            return MP_IMPORT_STAT_DIR;
+        } else if (S_ISREG(st.st_mode)) {
+            *type = ENTRY_FILE;
+            return MP_IMPORT_STAT_FILE;
+        }
+    }
+    *type = ENTRY_OTHER;
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+mp_import_stat_t nsp_import_cache_stat(const char *path)
+{
+    char type;
+    const char *slash = strrchr(path, '/');
+
+    // Relative to the current directory, no listing to cache
+    if (!slash)
+        return import_stat_uncached(path, &type);
+
+    const char *name = slash + 1;
+    // Keep "/" for files in the root directory
+    uint dir_len = slash == path ? 1 : slash - path;
+    import_cache_dir_t *d = import_cache_get_dir(path, dir_len);
+    if (!d)
+        return import_stat_uncached(path, &type);
+
+    char *entry = d->entries, *end = d->entries + d->entries_len;
+    while (entry < end) {
+        char *entry_name = entry + 1;
+        if (strcmp(entry_name, name) == 0) {
+            switch (*entry) {
+                case ENTRY_FILE:
+                    return MP_IMPORT_STAT_FILE;
+                case ENTRY_DIR:
+                    return MP_IMPORT_STAT_DIR;
+                case ENTRY_OTHER:
+                    return MP_IMPORT_STAT_NO_EXIST;
+                default: {
+                    mp_import_stat_t ret = import_stat_uncached(path, &type);
+                    *entry = type;
+                    return ret;
+                }
+            }
+        }
+        entry = entry_name + strlen(entry_name) + 1;
+    }
+
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+void nsp_import_cache_invalidate()
+{
+    for (uint i = 0; i < IMPORT_CACHE_DIRS; i++)
+        import_cache_dir_free(&cache_dirs[i]);
+
+    cache_next = 0;
+}
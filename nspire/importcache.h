@@ -0,0 +1,2 @@
+mp_import_stat_t nsp_import_cache_stat(const char *path);
+void nsp_import_cache_invalidate();
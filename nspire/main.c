@@ -52,6 +52,7 @@
 #include "pfenv.h"
 #include "genhdr/py-version.h"
 #include "input.h"
+#include "importcache.h"
 #include "stackctrl.h"
 
 // Command line options, with their defaults
@@ -66,6 +67,8 @@ long heap_size = 2*1024*1024;
 
 void nsp_texture_init();
 void nsp_texture_deinit();
+void nsp_profile_deinit();
+void nsp_timer_deinit();
 
 static bool should_exit = false;
 static uint exit_val;
@@ -235,12 +238,18 @@ int main(int argc, char **argv) {
         wait_key_pressed();
     }
 
+    nsp_profile_deinit();
+
     mp_deinit();
 
     free(heap);
 
+    nsp_import_cache_invalidate();
+
     nsp_texture_deinit();
 
+    nsp_timer_deinit();
+
     if(should_exit)
         return exit_val;
 	
@@ -248,15 +257,7 @@ int main(int argc, char **argv) {
 }
 
 mp_import_stat_t mp_import_stat(const char *path) {
-    struct stat st;
-    if (stat(path, &st) == 0) {
-        if (S_ISDIR(st.st_mode)) {
-            return MP_IMPORT_STAT_DIR;
-        } else if (S_ISREG(st.st_mode)) {
-            return MP_IMPORT_STAT_FILE;
-        }
-    }
-    return MP_IMPORT_STAT_NO_EXIST;
+    return nsp_import_cache_stat(path);
 }
 
 int DEBUG_printf(const char *fmt, ...) {
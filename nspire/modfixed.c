@@ -0,0 +1,425 @@
+#include <stdint.h>
+#include <math.h>
+
+#include "mpconfig.h"
+#include "misc.h"
+#include "nlr.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "runtime0.h"
+#include "binary.h"
+#include "fixed.h"
+
+/*
+ * Small example:
+ *
+ * from fixed import Q16, sin
+ * x = Q16(10)
+ * v = Q16(0.5)
+ * for i in range(100):
+ *     x += v * sin(Q16(i) / 10)
+ * print(x, x.toint())
+ *
+ * Q16 numbers are Q16.16 fixed point (range about +-32768, resolution 1/65536),
+ * so arithmetic on them needs no floating point at all. The right operand may
+ * also be an int or a float, the left one has to be a Q16. Results and ints
+ * out of range wrap around, floats out of range raise OverflowError.
+ *
+ * Arrays of Q16 are array.array('i') buffers holding the raw values. The bulk
+ * functions write into dst, which may be one of the operands. Operands are such
+ * buffers of the same length as dst or single numbers.
+ *
+ * Available functions:
+ * Q16(x=0): x is an int, float or Q16. Methods: toint(), tofloat(), raw().
+ * fromraw(n): Q16 with the raw value n.
+ * sqrt(x), sin(x), cos(x): sin and cos interpolate a table (error < 2/65536).
+ * add(dst, a, b), sub(dst, a, b), mul(dst, a, b): Elementwise.
+ * convert(dst, src): Copies between a Q16 buffer and a float ('f', 'd') or
+ *     int ('h', 'b', ...) buffer, in either direction.
+ */
+
+typedef struct _mp_obj_fix16_t {
+    mp_obj_base_t base;
+    fix16_t val;
+} mp_obj_fix16_t;
+
+// sin from 0 to pi/2 in 256 steps
+STATIC const int32_t fix16_sin_table[257] = {
+    0, 402, 804, 1206, 1608, 2010, 2412, 2814, 3216, 3617, 4019, 4420,
+    4821, 5222, 5623, 6023, 6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+    9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391, 12785, 13180, 13573, 13966,
+    14359, 14751, 15143, 15534, 15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+    19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699, 22078, 22457, 22834, 23210,
+    23586, 23961, 24335, 24708, 25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+    28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538, 30893, 31248, 31600, 31952,
+    32303, 32652, 33000, 33347, 33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+    36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716, 39040, 39362, 39683, 40002,
+    40320, 40636, 40951, 41264, 41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+    44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056, 46341, 46624, 46906, 47186,
+    47464, 47741, 48015, 48288, 48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+    50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398, 52639, 52878, 53114, 53349,
+    53581, 53812, 54040, 54267, 54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+    56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607, 57798, 57986, 58172, 58356,
+    58538, 58718, 58896, 59071, 59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+    60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568, 61705, 61839, 61971, 62101,
+    62228, 62353, 62476, 62596, 62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+    63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197, 64277, 64354, 64429, 64501,
+    64571, 64639, 64704, 64766, 64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+    65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436, 65457, 65476, 65492, 65505,
+    65516, 65525, 65531, 65535, 65536,
+};
+
+// Angle in units of 1/2^32 turn
+STATIC fix16_t fix16_sin_turn(uint32_t phase) {
+    uint32_t quadrant = phase >> 30, p = phase & 0x3FFFFFFF;
+    if (quadrant & 1) {
+        p = 0x40000000 - p;
+    }
+    uint32_t i = p >> 22, frac = p & 0x3FFFFF;
+    int32_t val = fix16_sin_table[i];
+    if (frac) {
+        val += ((int64_t)(fix16_sin_table[i + 1] - val) * frac) >> 22;
+    }
+    return quadrant & 2 ? -val : val;
+}
+
+// Radians to 1/2^32 turns: a * 2^32 / (2 * pi * 65536), with a in Q16.16
+#define FIX16_RAD_TO_TURN(a) ((uint32_t)(((int64_t)(a) * 683565276) >> 16))
+
+fix16_t fix16_sin(fix16_t a) {
+    return fix16_sin_turn(FIX16_RAD_TO_TURN(a));
+}
+
+fix16_t fix16_cos(fix16_t a) {
+    return fix16_sin_turn(FIX16_RAD_TO_TURN(a) + 0x40000000);
+}
+
+fix16_t fix16_sqrt(fix16_t a) {
+    // Integer square root of a * 65536, one result bit per iteration
+    uint64_t x = (uint64_t)a << 16, res = 0, bit = (uint64_t)1 << 62;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+mp_obj_t fix16_new(fix16_t val) {
+    mp_obj_fix16_t *o = m_new_obj(mp_obj_fix16_t);
+    o->base.type = &mp_type_fix16;
+    o->val = val;
+    return o;
+}
+
+STATIC fix16_t fix16_from_float(mp_float_t x) {
+    mp_float_t val = MICROPY_FLOAT_C_FUN(floor)(x * FIX16_ONE + MICROPY_FLOAT_CONST(0.5));
+    // Converting a value out of range is undefined, this is also false for nan
+    if (!(val >= MICROPY_FLOAT_CONST(-2147483648.0) && val < MICROPY_FLOAT_CONST(2147483648.0))) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_OverflowError, "float out of range for Q16"));
+    }
+    return (fix16_t)val;
+}
+
+STATIC bool fix16_from_obj_maybe(mp_obj_t obj, fix16_t *val) {
+    if (MP_OBJ_IS_TYPE(obj, &mp_type_fix16)) {
+        *val = ((mp_obj_fix16_t*)obj)->val;
+    } else if (MP_OBJ_IS_SMALL_INT(obj) || MP_OBJ_IS_TYPE(obj, &mp_type_int)) {
+        *val = FIX16_FROM_INT(mp_obj_get_int(obj));
+    } else if (MP_OBJ_IS_TYPE(obj, &mp_type_float)) {
+        *val = fix16_from_float(mp_obj_float_get(obj));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+fix16_t fix16_from_obj(mp_obj_t obj) {
+    fix16_t val;
+    if (!fix16_from_obj_maybe(obj, &val)) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError, "can't convert %s to Q16", mp_obj_get_type_str(obj)));
+    }
+    return val;
+}
+
+STATIC void fix16_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind) {
+    mp_obj_fix16_t *self = self_in;
+    if (kind == PRINT_STR) {
+        print(env, "%g", (double)self->val / FIX16_ONE);
+    } else {
+        print(env, "Q16(%g)", (double)self->val / FIX16_ONE);
+    }
+}
+
+STATIC mp_obj_t fix16_make_new(mp_obj_t type_in, uint n_args, uint n_kw, const mp_obj_t *args) {
+    (void)type_in;
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    return fix16_new(n_args == 0 ? 0 : fix16_from_obj(args[0]));
+}
+
+// Integer part, rounded towards 0 like int(float)
+STATIC mp_int_t fix16_trunc(fix16_t val) {
+    return val < 0 ? -(-(int64_t)val >> 16) : val >> 16;
+}
+
+STATIC void fix16_check_divisor(fix16_t b) {
+    if (b == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ZeroDivisionError, "division by zero"));
+    }
+}
+
+// floor(a / b) as an integer
+STATIC int64_t fix16_floor_div(fix16_t a, fix16_t b) {
+    fix16_check_divisor(b);
+    // In 64 bits, INT32_MIN / -1 traps in 32
+    int64_t q = (int64_t)a / b;
+    if (((int64_t)a % b != 0) && ((a < 0) != (b < 0))) {
+        q--;
+    }
+    return q;
+}
+
+STATIC mp_obj_t fix16_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    fix16_t val = ((mp_obj_fix16_t*)self_in)->val;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(val != 0);
+        // Q16(1) == 1, so integral values have to hash like the int
+        case MP_UNARY_OP_HASH: return MP_OBJ_NEW_SMALL_INT((val & (FIX16_ONE - 1)) == 0 ? val >> 16 : val);
+        case MP_UNARY_OP_POSITIVE: return self_in;
+        case MP_UNARY_OP_NEGATIVE: return fix16_new(fix16_sub(0, val));
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t fix16_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    fix16_t a = ((mp_obj_fix16_t*)lhs_in)->val, b;
+    if (!fix16_from_obj_maybe(rhs_in, &b)) {
+        return MP_OBJ_NULL; // op not supported
+    }
+
+    switch (op) {
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD:
+            return fix16_new(fix16_add(a, b));
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT:
+            return fix16_new(fix16_sub(a, b));
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY:
+            return fix16_new(fix16_mul(a, b));
+        case MP_BINARY_OP_TRUE_DIVIDE:
+        case MP_BINARY_OP_INPLACE_TRUE_DIVIDE:
+            fix16_check_divisor(b);
+            return fix16_new(fix16_div(a, b));
+        case MP_BINARY_OP_FLOOR_DIVIDE:
+        case MP_BINARY_OP_INPLACE_FLOOR_DIVIDE:
+            return fix16_new(FIX16_FROM_INT(fix16_floor_div(a, b)));
+        case MP_BINARY_OP_MODULO:
+        case MP_BINARY_OP_INPLACE_MODULO:
+            return fix16_new(a - fix16_floor_div(a, b) * b);
+        case MP_BINARY_OP_LESS: return MP_BOOL(a < b);
+        case MP_BINARY_OP_MORE: return MP_BOOL(a > b);
+        case MP_BINARY_OP_EQUAL: return MP_BOOL(a == b);
+        case MP_BINARY_OP_LESS_EQUAL: return MP_BOOL(a <= b);
+        case MP_BINARY_OP_MORE_EQUAL: return MP_BOOL(a >= b);
+        case MP_BINARY_OP_NOT_EQUAL: return MP_BOOL(a != b);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t fix16_toint(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(fix16_trunc(((mp_obj_fix16_t*)self_in)->val));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fix16_toint_obj, fix16_toint);
+
+STATIC mp_obj_t fix16_tofloat(mp_obj_t self_in) {
+    return mp_obj_new_float((mp_float_t)((mp_obj_fix16_t*)self_in)->val / FIX16_ONE);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fix16_tofloat_obj, fix16_tofloat);
+
+STATIC mp_obj_t fix16_raw(mp_obj_t self_in) {
+    return mp_obj_new_int(((mp_obj_fix16_t*)self_in)->val);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fix16_raw_obj, fix16_raw);
+
+STATIC const mp_map_elem_t fix16_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_toint), (mp_obj_t)&fix16_toint_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tofloat), (mp_obj_t)&fix16_tofloat_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_raw), (mp_obj_t)&fix16_raw_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(fix16_locals_dict, fix16_locals_dict_table);
+
+const mp_obj_type_t mp_type_fix16 = {
+    { &mp_type_type },
+    .name = MP_QSTR_Q16,
+    .print = fix16_print,
+    .make_new = fix16_make_new,
+    .unary_op = fix16_unary_op,
+    .binary_op = fix16_binary_op,
+    .locals_dict = (mp_obj_t)&fix16_locals_dict,
+};
+
+/******************************************************************************/
+// Module functions
+
+STATIC mp_obj_t fixed_fromraw(mp_obj_t raw_in) {
+    return fix16_new(mp_obj_int_get_truncated(raw_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fixed_fromraw_obj, fixed_fromraw);
+
+STATIC mp_obj_t fixed_sqrt(mp_obj_t x_in) {
+    fix16_t x = fix16_from_obj(x_in);
+    if (x < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "math domain error"));
+    }
+    return fix16_new(fix16_sqrt(x));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fixed_sqrt_obj, fixed_sqrt);
+
+STATIC mp_obj_t fixed_sin(mp_obj_t x_in) {
+    return fix16_new(fix16_sin(fix16_from_obj(x_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fixed_sin_obj, fixed_sin);
+
+STATIC mp_obj_t fixed_cos(mp_obj_t x_in) {
+    return fix16_new(fix16_cos(fix16_from_obj(x_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(fixed_cos_obj, fixed_cos);
+
+// A buffer of Q16 values or a single one
+typedef struct _fixed_operand_t {
+    fix16_t *buf;
+    mp_uint_t len;
+    fix16_t val;
+} fixed_operand_t;
+
+STATIC bool fixed_is_fix16_buffer(const mp_buffer_info_t *bufinfo) {
+    return bufinfo->typecode != 'f' && bufinfo->typecode != 'd'
+        && mp_binary_get_size('@', bufinfo->typecode, NULL) == sizeof(fix16_t);
+}
+
+STATIC void fixed_get_operand(mp_obj_t obj, fixed_operand_t *op) {
+    if (fix16_from_obj_maybe(obj, &op->val)) {
+        op->buf = NULL;
+        return;
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_RW);
+    if (!fixed_is_fix16_buffer(&bufinfo)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "Q16 buffers must be array('i')"));
+    }
+    op->buf = bufinfo.buf;
+    op->len = bufinfo.len / sizeof(fix16_t);
+}
+
+STATIC mp_obj_t fixed_bulk(mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in, mp_uint_t op) {
+    fixed_operand_t dst, a, b;
+    fixed_get_operand(dst_in, &dst);
+    fixed_get_operand(a_in, &a);
+    fixed_get_operand(b_in, &b);
+    if (dst.buf == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "dst must be a buffer"));
+    }
+    if ((a.buf && a.len != dst.len) || (b.buf && b.len != dst.len)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffers must have the same length"));
+    }
+
+    fix16_t *d = dst.buf;
+    for (mp_uint_t i = 0; i < dst.len; i++) {
+        fix16_t x = a.buf ? a.buf[i] : a.val, y = b.buf ? b.buf[i] : b.val;
+        switch (op) {
+            case MP_BINARY_OP_ADD: d[i] = fix16_add(x, y); break;
+            case MP_BINARY_OP_SUBTRACT: d[i] = fix16_sub(x, y); break;
+            default: d[i] = fix16_mul(x, y); break;
+        }
+    }
+    return dst_in;
+}
+
+STATIC mp_obj_t fixed_add(mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return fixed_bulk(dst_in, a_in, b_in, MP_BINARY_OP_ADD);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(fixed_add_obj, fixed_add);
+
+STATIC mp_obj_t fixed_sub(mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return fixed_bulk(dst_in, a_in, b_in, MP_BINARY_OP_SUBTRACT);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(fixed_sub_obj, fixed_sub);
+
+STATIC mp_obj_t fixed_mul(mp_obj_t dst_in, mp_obj_t a_in, mp_obj_t b_in) {
+    return fixed_bulk(dst_in, a_in, b_in, MP_BINARY_OP_MULTIPLY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(fixed_mul_obj, fixed_mul);
+
+STATIC mp_obj_t fixed_convert(mp_obj_t dst_in, mp_obj_t src_in) {
+    mp_buffer_info_t dst, src;
+    mp_get_buffer_raise(dst_in, &dst, MP_BUFFER_WRITE);
+    mp_get_buffer_raise(src_in, &src, MP_BUFFER_READ);
+    bool dst_fix = fixed_is_fix16_buffer(&dst), src_fix = fixed_is_fix16_buffer(&src);
+    if (!dst_fix && !src_fix) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "dst or src must be array('i')"));
+    }
+
+    mp_uint_t dst_size = mp_binary_get_size('@', dst.typecode, NULL);
+    mp_uint_t src_size = mp_binary_get_size('@', src.typecode, NULL);
+    mp_uint_t len = dst.len / dst_size;
+    if (src.len / src_size != len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffers must have the same length"));
+    }
+
+    for (mp_uint_t i = 0; i < len; i++) {
+        if (dst_fix && src_fix) {
+            ((fix16_t*)dst.buf)[i] = ((fix16_t*)src.buf)[i];
+        } else if (dst_fix) {
+            if (src.typecode == 'f') {
+                ((fix16_t*)dst.buf)[i] = fix16_from_float(((float*)src.buf)[i]);
+            } else if (src.typecode == 'd') {
+                ((fix16_t*)dst.buf)[i] = fix16_from_float(((double*)src.buf)[i]);
+            } else {
+                mp_obj_t val = mp_binary_get_val_array(src.typecode, src.buf, i);
+                ((fix16_t*)dst.buf)[i] = fix16_from_obj(val);
+            }
+        } else {
+            fix16_t val = ((fix16_t*)src.buf)[i];
+            if (dst.typecode == 'f') {
+                ((float*)dst.buf)[i] = (float)val / FIX16_ONE;
+            } else if (dst.typecode == 'd') {
+                ((double*)dst.buf)[i] = (double)val / FIX16_ONE;
+            } else {
+                mp_binary_set_val_array(dst.typecode, dst.buf, i, MP_OBJ_NEW_SMALL_INT(fix16_trunc(val)));
+            }
+        }
+    }
+    return dst_in;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(fixed_convert_obj, fixed_convert);
+
+STATIC const mp_map_elem_t mp_module_fixed_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_fixed) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Q16), (mp_obj_t)&mp_type_fix16 },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fromraw), (mp_obj_t)&fixed_fromraw_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sqrt), (mp_obj_t)&fixed_sqrt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sin), (mp_obj_t)&fixed_sin_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_cos), (mp_obj_t)&fixed_cos_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_add), (mp_obj_t)&fixed_add_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sub), (mp_obj_t)&fixed_sub_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mul), (mp_obj_t)&fixed_mul_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_convert), (mp_obj_t)&fixed_convert_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_fixed_globals, mp_module_fixed_globals_table);
+
+const mp_obj_module_t mp_module_fixed = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_fixed,
+    .globals = (mp_obj_dict_t*)&mp_module_fixed_globals,
+};
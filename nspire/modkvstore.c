@@ -0,0 +1,595 @@
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "mpconfig.h"
+#include "misc.h"
+#include "nlr.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "runtime0.h"
+#include "importcache.h"
+#include "extmod/uzlib/tinf.h"
+
+/*
+ * Small example:
+ *
+ * import kvstore
+ * db = kvstore.open("/documents/game.kv.tns")
+ * db["level"] = b"\x03"
+ * db["name"] = "Fabian"
+ * buf = bytearray(16)
+ * n = db.readinto("name", buf)
+ * print(db.get("level"), buf[:n], len(db), list(db))
+ * del db["name"]
+ * db.compact()
+ * db.close()
+ *
+ * The file is a log: every assignment or deletion appends one record and
+ * nothing is ever rewritten in place, so a write costs a single append. Each
+ * record carries a CRC32, computed by uzlib. When opening, the log is replayed
+ * into an index in memory (key -> position of the value) and replay stops at
+ * the first incomplete or damaged record, so a store interrupted during a
+ * write (reset, empty batteries) comes back with everything up to the last
+ * complete write. The next write overwrites the damaged tail.
+ *
+ * Overwritten and deleted values stay in the file until compact() rewrites it
+ * with only the live records. This goes through path + "~" which replaces the
+ * original only once complete; if that was interrupted, open() finishes it.
+ *
+ * Keys are str (at most 255 bytes encoded), values anything with the buffer
+ * protocol (bytes, bytearray, array, str) of up to 16 MiB and are returned as
+ * bytes.
+ *
+ * Available functions:
+ * open(path): Opens or creates the store at path. Methods and operators:
+ *     db[key], db[key] = value, del db[key], key in db, len(db), iter(db)
+ *     get(key, default=None)
+ *     readinto(key, buf): Copies as much of the value as fits into buf without
+ *         allocating. Returns the length copied or None if key is missing.
+ *     keys(): List of the keys.
+ *     garbage(): Number of bytes compact() would reclaim.
+ *     compact(): Rewrites the file, returns the number of bytes reclaimed.
+ *     close()
+ */
+
+#define KV_MAGIC "NKV1"
+#define KV_MAGIC_LEN 4
+#define KV_HEADER_LEN 10 // type, key length, value length (u32 LE), crc32 (u32 LE)
+#define KV_PUT 1
+#define KV_DEL 2
+#define KV_MAX_KEY 255
+#define KV_MAX_VALUE (16 * 1024 * 1024)
+#define KV_CHUNK 256
+
+#define KV_RAISE_ERRNO(error_val) \
+    nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(error_val)))
+
+// The index maps a key to a slot index into this array, free slots are
+// chained through next_free.
+typedef struct _kv_slot_t {
+    uint32_t offset; // Of the value in the file
+    uint32_t len;
+} kv_slot_t;
+
+typedef struct _mp_obj_kvstore_t {
+    mp_obj_base_t base;
+    int fd;
+    uint32_t end; // Where the next record goes
+    uint32_t garbage; // Bytes taken by overwritten and deleted records
+    mp_map_t index;
+    kv_slot_t *slots;
+    mp_uint_t slots_len, slots_alloc;
+    mp_int_t next_free;
+    char *path, *tmp_path; // tmp_path is path + "~"
+} mp_obj_kvstore_t;
+
+STATIC const mp_obj_type_t kvstore_type;
+
+STATIC void kv_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+STATIC uint32_t kv_get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+STATIC mp_obj_kvstore_t *kv_get_open(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = self_in;
+    if (self->fd < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Store is closed."));
+    }
+    return self;
+}
+
+// Returns the number of bytes read, which is only less than len at the end of the file
+STATIC mp_uint_t kv_read_at(int fd, uint32_t offset, void *buf, mp_uint_t len) {
+    if (lseek(fd, offset, SEEK_SET) == -1) {
+        KV_RAISE_ERRNO(errno);
+    }
+    mp_uint_t done = 0;
+    while (done < len) {
+        int r = read(fd, (uint8_t*)buf + done, len - done);
+        if (r < 0) {
+            KV_RAISE_ERRNO(errno);
+        }
+        if (r == 0) {
+            break;
+        }
+        done += r;
+    }
+    return done;
+}
+
+STATIC void kv_write_all(int fd, const void *buf, mp_uint_t len) {
+    while (len > 0) {
+        int r = write(fd, buf, len);
+        if (r <= 0) {
+            KV_RAISE_ERRNO(r < 0 ? errno : EIO);
+        }
+        buf = (const uint8_t*)buf + r;
+        len -= r;
+    }
+}
+
+STATIC const char *kv_get_key(mp_obj_t key_in, mp_uint_t *len) {
+    if (!MP_OBJ_IS_STR(key_in)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "Key must be a str."));
+    }
+    uint l;
+    const char *key = mp_obj_str_get_data(key_in, &l);
+    if (l > KV_MAX_KEY) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Key too long."));
+    }
+    *len = l;
+    return key;
+}
+
+STATIC kv_slot_t *kv_lookup(mp_obj_kvstore_t *self, mp_obj_t key) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->index, key, MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        return NULL;
+    }
+    return &self->slots[MP_OBJ_SMALL_INT_VALUE(elem->value)];
+}
+
+STATIC void kv_index_remove(mp_obj_kvstore_t *self, mp_obj_t key, uint32_t key_len) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->index, key, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    if (elem == NULL) {
+        return;
+    }
+    mp_int_t slot = MP_OBJ_SMALL_INT_VALUE(elem->value);
+    self->garbage += KV_HEADER_LEN + key_len + self->slots[slot].len;
+    self->slots[slot].offset = self->next_free;
+    self->next_free = slot;
+}
+
+STATIC void kv_index_set(mp_obj_kvstore_t *self, mp_obj_t key, uint32_t key_len, uint32_t offset, uint32_t len) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->index, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    mp_int_t slot;
+    if (elem->value != MP_OBJ_NULL) {
+        slot = MP_OBJ_SMALL_INT_VALUE(elem->value);
+        self->garbage += KV_HEADER_LEN + key_len + self->slots[slot].len;
+    } else if (self->next_free >= 0) {
+        slot = self->next_free;
+        self->next_free = (int32_t)self->slots[slot].offset;
+    } else {
+        if (self->slots_len == self->slots_alloc) {
+            mp_uint_t n = self->slots_alloc * 2 + 8;
+            self->slots = m_renew(kv_slot_t, self->slots, self->slots_alloc, n);
+            self->slots_alloc = n;
+        }
+        slot = self->slots_len++;
+    }
+    self->slots[slot].offset = offset;
+    self->slots[slot].len = len;
+    elem->value = MP_OBJ_NEW_SMALL_INT(slot);
+}
+
+// Checks the record at offset, returns its total length or 0 if it's damaged
+// or incomplete. On success hdr holds the header and key the key.
+STATIC uint32_t kv_check_record(int fd, uint32_t offset, uint8_t *hdr, uint8_t *key) {
+    if (kv_read_at(fd, offset, hdr, KV_HEADER_LEN) != KV_HEADER_LEN) {
+        return 0;
+    }
+    uint32_t key_len = hdr[1], value_len = kv_get_u32(hdr + 2);
+    if ((hdr[0] != KV_PUT && hdr[0] != KV_DEL) || value_len > KV_MAX_VALUE
+        || (hdr[0] == KV_DEL && value_len != 0)) {
+        return 0;
+    }
+    if (read(fd, key, key_len) != (int)key_len) {
+        return 0;
+    }
+    uint32_t crc = tinf_crc32_update(0, hdr, 6);
+    crc = tinf_crc32_update(crc, key, key_len);
+    uint8_t chunk[KV_CHUNK];
+    for (uint32_t left = value_len; left > 0;) {
+        uint32_t n = left < KV_CHUNK ? left : KV_CHUNK;
+        if (read(fd, chunk, n) != (int)n) {
+            return 0;
+        }
+        crc = tinf_crc32_update(crc, chunk, n);
+        left -= n;
+    }
+    if (crc != kv_get_u32(hdr + 6)) {
+        return 0;
+    }
+    return KV_HEADER_LEN + key_len + value_len;
+}
+
+// Replays the log into the index
+STATIC void kv_load(mp_obj_kvstore_t *self) {
+    uint8_t hdr[KV_HEADER_LEN], key[KV_MAX_KEY];
+    uint32_t offset = KV_MAGIC_LEN, len;
+    while ((len = kv_check_record(self->fd, offset, hdr, key)) != 0) {
+        mp_obj_t key_obj = mp_obj_new_str((const char*)key, hdr[1], false);
+        if (hdr[0] == KV_PUT) {
+            kv_index_set(self, key_obj, hdr[1], offset + KV_HEADER_LEN + hdr[1], len - KV_HEADER_LEN - hdr[1]);
+        } else {
+            kv_index_remove(self, key_obj, hdr[1]);
+            self->garbage += len;
+        }
+        offset += len;
+    }
+    self->end = offset;
+}
+
+STATIC void kv_append(mp_obj_kvstore_t *self, int type, const char *key, mp_uint_t key_len, const void *value, mp_uint_t value_len) {
+    uint8_t buf[KV_HEADER_LEN + KV_MAX_KEY];
+    buf[0] = type;
+    buf[1] = key_len;
+    kv_put_u32(buf + 2, value_len);
+    memcpy(buf + KV_HEADER_LEN, key, key_len);
+    uint32_t crc = tinf_crc32_update(0, buf, 6);
+    crc = tinf_crc32_update(crc, buf + KV_HEADER_LEN, key_len);
+    crc = tinf_crc32_update(crc, value, value_len);
+    kv_put_u32(buf + 6, crc);
+
+    if (lseek(self->fd, self->end, SEEK_SET) == -1) {
+        KV_RAISE_ERRNO(errno);
+    }
+    // A record cut short by an error is ignored by kv_load and overwritten by
+    // the next append, as self->end only moves once it's complete.
+    kv_write_all(self->fd, buf, KV_HEADER_LEN + key_len);
+    kv_write_all(self->fd, value, value_len);
+    self->end += KV_HEADER_LEN + key_len + value_len;
+}
+
+STATIC int kv_open_fd(mp_obj_kvstore_t *self) {
+    int fd = open(self->path, O_RDWR);
+    if (fd == -1 && errno == ENOENT) {
+        // An interrupted compact() may have left only the new file behind
+        if (rename(self->tmp_path, self->path) == 0) {
+            fd = open(self->path, O_RDWR);
+        } else {
+            fd = open(self->path, O_RDWR | O_CREAT, 0644);
+        }
+        nsp_import_cache_invalidate();
+    }
+    if (fd == -1) {
+        KV_RAISE_ERRNO(errno);
+    }
+    return fd;
+}
+
+STATIC mp_obj_t kvstore_open(mp_obj_t path_in) {
+    uint path_len;
+    const char *path = mp_obj_str_get_data(path_in, &path_len);
+    if (path_len + 2 > MICROPY_ALLOC_PATH_MAX) {
+        KV_RAISE_ERRNO(ENAMETOOLONG);
+    }
+
+    mp_obj_kvstore_t *self = m_new_obj_with_finaliser(mp_obj_kvstore_t);
+    self->base.type = &kvstore_type;
+    self->fd = -1;
+    self->garbage = 0;
+    mp_map_init(&self->index, 0);
+    self->slots = NULL;
+    self->slots_len = self->slots_alloc = 0;
+    self->next_free = -1;
+    self->path = m_new(char, path_len + 1);
+    memcpy(self->path, path, path_len);
+    self->path[path_len] = 0;
+    self->tmp_path = m_new(char, path_len + 2);
+    memcpy(self->tmp_path, path, path_len);
+    self->tmp_path[path_len] = '~';
+    self->tmp_path[path_len + 1] = 0;
+
+    self->fd = kv_open_fd(self);
+    uint8_t magic[KV_MAGIC_LEN];
+    mp_uint_t n = kv_read_at(self->fd, 0, magic, KV_MAGIC_LEN);
+    if (n == 0) {
+        kv_write_all(self->fd, KV_MAGIC, KV_MAGIC_LEN);
+    } else if (n != KV_MAGIC_LEN || memcmp(magic, KV_MAGIC, KV_MAGIC_LEN) != 0) {
+        close(self->fd);
+        self->fd = -1;
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Not a kvstore file."));
+    }
+    kv_load(self);
+    return self;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore_open_obj, kvstore_open);
+
+STATIC void kvstore_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind) {
+    mp_obj_kvstore_t *self = self_in;
+    print(env, "<kvstore '%s' %s>", self->path, self->fd < 0 ? "closed" : "open");
+}
+
+// Reads the value of slot into a new bytes object
+STATIC mp_obj_t kv_read_value(mp_obj_kvstore_t *self, kv_slot_t *slot) {
+    byte *data = m_new(byte, slot->len);
+    if (kv_read_at(self->fd, slot->offset, data, slot->len) != slot->len) {
+        m_del(byte, data, slot->len);
+        KV_RAISE_ERRNO(EIO);
+    }
+    mp_obj_t o = mp_obj_new_bytes(data, slot->len);
+    m_del(byte, data, slot->len);
+    return o;
+}
+
+STATIC mp_obj_t kvstore_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_kvstore_t *self = kv_get_open(self_in);
+    mp_uint_t key_len;
+    const char *key = kv_get_key(index, &key_len);
+
+    if (value == MP_OBJ_NULL) {
+        // delete
+        if (kv_lookup(self, index) == NULL) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, index));
+        }
+        kv_append(self, KV_DEL, key, key_len, NULL, 0);
+        kv_index_remove(self, index, key_len);
+        self->garbage += KV_HEADER_LEN + key_len;
+        return mp_const_none;
+    } else if (value == MP_OBJ_SENTINEL) {
+        // load
+        kv_slot_t *slot = kv_lookup(self, index);
+        if (slot == NULL) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, index));
+        }
+        return kv_read_value(self, slot);
+    } else {
+        // store
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(value, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len > KV_MAX_VALUE) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Value too long."));
+        }
+        uint32_t offset = self->end + KV_HEADER_LEN + key_len;
+        kv_append(self, KV_PUT, key, key_len, bufinfo.buf, bufinfo.len);
+        kv_index_set(self, index, key_len, offset, bufinfo.len);
+        return mp_const_none;
+    }
+}
+
+STATIC mp_obj_t kvstore_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = self_in;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(self->index.used != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(kv_get_open(self)->index.used);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t kvstore_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    if (op != MP_BINARY_OP_IN) {
+        return MP_OBJ_NULL; // op not supported
+    }
+    mp_obj_kvstore_t *self = kv_get_open(lhs_in);
+    if (!MP_OBJ_IS_STR(rhs_in)) {
+        return mp_const_false;
+    }
+    return MP_BOOL(kv_lookup(self, rhs_in) != NULL);
+}
+
+STATIC mp_obj_t kvstore_keys(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = kv_get_open(self_in);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (mp_uint_t i = 0; i < self->index.alloc; i++) {
+        mp_obj_t key = self->index.table[i].key;
+        if (key != MP_OBJ_NULL && key != MP_OBJ_SENTINEL) {
+            mp_obj_list_append(list, key);
+        }
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore_keys_obj, kvstore_keys);
+
+STATIC mp_obj_t kvstore_getiter(mp_obj_t self_in) {
+    // Iterates over a snapshot, so the store may be changed meanwhile
+    return mp_getiter(kvstore_keys(self_in));
+}
+
+STATIC mp_obj_t kvstore_get(uint n_args, const mp_obj_t *args) {
+    mp_obj_kvstore_t *self = kv_get_open(args[0]);
+    mp_uint_t key_len;
+    kv_get_key(args[1], &key_len);
+    kv_slot_t *slot = kv_lookup(self, args[1]);
+    if (slot == NULL) {
+        return n_args > 2 ? args[2] : mp_const_none;
+    }
+    return kv_read_value(self, slot);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(kvstore_get_obj, 2, 3, kvstore_get);
+
+STATIC mp_obj_t kvstore_readinto(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t buf_in) {
+    mp_obj_kvstore_t *self = kv_get_open(self_in);
+    mp_uint_t key_len;
+    kv_get_key(key_in, &key_len);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    kv_slot_t *slot = kv_lookup(self, key_in);
+    if (slot == NULL) {
+        return mp_const_none;
+    }
+    mp_uint_t len = slot->len < bufinfo.len ? slot->len : bufinfo.len;
+    if (kv_read_at(self->fd, slot->offset, bufinfo.buf, len) != len) {
+        KV_RAISE_ERRNO(EIO);
+    }
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(kvstore_readinto_obj, kvstore_readinto);
+
+STATIC mp_obj_t kvstore_garbage(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = kv_get_open(self_in);
+    return mp_obj_new_int_from_uint(self->garbage);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore_garbage_obj, kvstore_garbage);
+
+STATIC mp_obj_t kvstore_compact(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = kv_get_open(self_in);
+    const char *tmp_path = self->tmp_path;
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        KV_RAISE_ERRNO(errno);
+    }
+    nsp_import_cache_invalidate();
+
+    // The live records are copied verbatim, CRC included. The new offsets are
+    // only stored in the slots once the new file is in place.
+    uint32_t *offsets = m_new(uint32_t, self->slots_len);
+    uint32_t end = KV_MAGIC_LEN;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        kv_write_all(fd, KV_MAGIC, KV_MAGIC_LEN);
+        uint8_t chunk[KV_CHUNK];
+        for (mp_uint_t i = 0; i < self->index.alloc; i++) {
+            mp_obj_t key = self->index.table[i].key;
+            if (key == MP_OBJ_NULL || key == MP_OBJ_SENTINEL) {
+                continue;
+            }
+            mp_int_t s = MP_OBJ_SMALL_INT_VALUE(self->index.table[i].value);
+            uint len;
+            mp_obj_str_get_data(key, &len);
+            uint32_t start = self->slots[s].offset - len - KV_HEADER_LEN;
+            uint32_t left = KV_HEADER_LEN + len + self->slots[s].len;
+            offsets[s] = end + KV_HEADER_LEN + len;
+            end += left;
+            for (uint32_t pos = start; left > 0;) {
+                uint32_t n = left < KV_CHUNK ? left : KV_CHUNK;
+                if (kv_read_at(self->fd, pos, chunk, n) != n) {
+                    KV_RAISE_ERRNO(EIO);
+                }
+                kv_write_all(fd, chunk, n);
+                pos += n;
+                left -= n;
+            }
+        }
+        nlr_pop();
+    } else {
+        close(fd);
+        unlink(tmp_path);
+        m_del(uint32_t, offsets, self->slots_len);
+        nlr_raise(nlr.ret_val);
+    }
+    close(fd);
+
+    // rename() doesn't replace existing files everywhere, so the old one is
+    // removed first. A crash in between leaves only the new file, which
+    // kv_open_fd picks up.
+    close(self->fd);
+    self->fd = -1;
+    if (unlink(self->path) == -1) {
+        int err = errno;
+        m_del(uint32_t, offsets, self->slots_len);
+        unlink(tmp_path);
+        self->fd = kv_open_fd(self);
+        KV_RAISE_ERRNO(err);
+    }
+    nsp_import_cache_invalidate();
+    if (rename(tmp_path, self->path) == -1) {
+        // Stays closed, open() again retries the rename
+        m_del(uint32_t, offsets, self->slots_len);
+        KV_RAISE_ERRNO(errno);
+    }
+    self->fd = kv_open_fd(self);
+
+    uint32_t reclaimed = self->end - end;
+    for (mp_uint_t i = 0; i < self->index.alloc; i++) {
+        mp_obj_t key = self->index.table[i].key;
+        if (key != MP_OBJ_NULL && key != MP_OBJ_SENTINEL) {
+            mp_int_t s = MP_OBJ_SMALL_INT_VALUE(self->index.table[i].value);
+            self->slots[s].offset = offsets[s];
+        }
+    }
+    m_del(uint32_t, offsets, self->slots_len);
+    self->end = end;
+    self->garbage = 0;
+    return mp_obj_new_int_from_uint(reclaimed);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore_compact_obj, kvstore_compact);
+
+STATIC mp_obj_t kvstore_close(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = self_in;
+    if (self->fd >= 0) {
+        close(self->fd);
+        self->fd = -1;
+        mp_map_deinit(&self->index);
+        m_del(kv_slot_t, self->slots, self->slots_alloc);
+        self->slots = NULL;
+        self->slots_len = self->slots_alloc = 0;
+        self->next_free = -1;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore_close_obj, kvstore_close);
+
+// Finaliser, the memory is about to be freed anyway
+STATIC mp_obj_t kvstore___del__(mp_obj_t self_in) {
+    mp_obj_kvstore_t *self = self_in;
+    if (self->fd >= 0) {
+        close(self->fd);
+        self->fd = -1;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(kvstore___del___obj, kvstore___del__);
+
+STATIC mp_obj_t kvstore___exit__(uint n_args, const mp_obj_t *args) {
+    return kvstore_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(kvstore___exit___obj, 4, 4, kvstore___exit__);
+
+STATIC const mp_map_elem_t kvstore_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_get), (mp_obj_t)&kvstore_get_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_readinto), (mp_obj_t)&kvstore_readinto_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_keys), (mp_obj_t)&kvstore_keys_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_garbage), (mp_obj_t)&kvstore_garbage_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_compact), (mp_obj_t)&kvstore_compact_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_close), (mp_obj_t)&kvstore_close_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__), (mp_obj_t)&kvstore___del___obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___enter__), (mp_obj_t)&mp_identity_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR___exit__), (mp_obj_t)&kvstore___exit___obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(kvstore_locals_dict, kvstore_locals_dict_table);
+
+STATIC const mp_obj_type_t kvstore_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_KVStore,
+    .print = kvstore_print,
+    .unary_op = kvstore_unary_op,
+    .binary_op = kvstore_binary_op,
+    .subscr = kvstore_subscr,
+    .getiter = kvstore_getiter,
+    .locals_dict = (mp_obj_t)&kvstore_locals_dict,
+};
+
+STATIC const mp_map_elem_t mp_module_kvstore_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_kvstore) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_open), (mp_obj_t)&kvstore_open_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_kvstore_globals, mp_module_kvstore_globals_table);
+
+const mp_obj_module_t mp_module_kvstore = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_kvstore,
+    .globals = (mp_obj_dict_t*)&mp_module_kvstore_globals,
+};
@@ -0,0 +1,1109 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "mpconfig.h"
+#include "misc.h"
+#include "nlr.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "runtime0.h"
+#include "objtuple.h"
+#include "objlist.h"
+#include "ndarray.h"
+
+/*
+ * Small example:
+ *
+ * import ndarray
+ * a = ndarray.array([[2, 1], [1, 3]])
+ * b = ndarray.array([3, 5])
+ * x = ndarray.solve(a, b)
+ * print(ndarray.dot(a, x), a.T, a[:, 1].sum())
+ *
+ * Arrays have one or two dimensions and hold int16, float32 or float64 (default)
+ * elements. Indexing with slices returns a view sharing the elements, use copy()
+ * to get an independent array. Arithmetic is done elementwise with a scalar, an
+ * array of the same shape, or a 1-dimensional array which is applied to every row.
+ * The array has to be on the left side of the operator.
+ *
+ * Available functions:
+ * array(obj, dtype=float64): Array from a (nested) list or tuple or another array.
+ * zeros(shape, dtype=float64), ones(shape, dtype=float64): shape is an int or a tuple.
+ * eye(n, dtype=float64): Identity matrix.
+ * linspace(start, stop, num=50, dtype=float64): num evenly spaced values, stop included.
+ * dot(a, b): Matrix product (or dot product of two vectors).
+ * solve(a, b): Solution x of a * x = b using LU decomposition, b can be a vector or a matrix.
+ * inv(a): Inverse of a square matrix.
+ * det(a): Determinant of a square matrix.
+ *
+ * Array attributes and methods:
+ * shape, ndim, size, dtype, T (transposed view)
+ * reshape(shape), transpose(), copy(), astype(dtype), tolist(), fill(value)
+ * sum(axis=None), mean(axis=None), min(axis=None), max(axis=None)
+ */
+
+#define NDARRAY_DTYPE_OK(dtype) ((dtype) == NDARRAY_INT16 || (dtype) == NDARRAY_FLOAT32 || (dtype) == NDARRAY_FLOAT64)
+
+enum {
+    REDUCE_SUM,
+    REDUCE_MEAN,
+    REDUCE_MIN,
+    REDUCE_MAX,
+};
+
+STATIC mp_uint_t ndarray_itemsize(byte dtype) {
+    switch (dtype) {
+        case NDARRAY_INT16: return sizeof(int16_t);
+        case NDARRAY_FLOAT32: return sizeof(float);
+        default: return sizeof(double);
+    }
+}
+
+// Rank used to find the result type of an operation: int16 < float32 < float64
+STATIC int ndarray_dtype_rank(byte dtype) {
+    switch (dtype) {
+        case NDARRAY_INT16: return 0;
+        case NDARRAY_FLOAT32: return 1;
+        default: return 2;
+    }
+}
+
+STATIC byte ndarray_get_dtype(mp_obj_t dtype_in) {
+    mp_int_t dtype = mp_obj_get_int(dtype_in);
+    if (!NDARRAY_DTYPE_OK(dtype)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "invalid dtype"));
+    }
+    return dtype;
+}
+
+mp_float_t ndarray_get(const mp_obj_ndarray_t *self, mp_uint_t row, mp_uint_t col) {
+    mp_int_t i = (mp_int_t)row * self->strides[0] + (mp_int_t)col * self->strides[1];
+    switch (self->dtype) {
+        case NDARRAY_INT16: return ((int16_t*)self->data)[i];
+        case NDARRAY_FLOAT32: return ((float*)self->data)[i];
+        default: return ((double*)self->data)[i];
+    }
+}
+
+void ndarray_set(mp_obj_ndarray_t *self, mp_uint_t row, mp_uint_t col, mp_float_t val) {
+    mp_int_t i = (mp_int_t)row * self->strides[0] + (mp_int_t)col * self->strides[1];
+    switch (self->dtype) {
+        case NDARRAY_INT16: ((int16_t*)self->data)[i] = (mp_int_t)val; break;
+        case NDARRAY_FLOAT32: ((float*)self->data)[i] = val; break;
+        default: ((double*)self->data)[i] = val; break;
+    }
+}
+
+// Element and byte offsets are mp_int_t, so the size in bytes has to fit. Each
+// dimension is checked on its own too, an empty array can't have a huge shape.
+STATIC void ndarray_check_shape(mp_uint_t rows, mp_uint_t cols, byte dtype) {
+    mp_uint_t max = ((mp_uint_t)-1 >> 1) / ndarray_itemsize(dtype);
+    if (rows > max || cols > max || (rows != 0 && cols > max / rows)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "array is too big"));
+    }
+}
+
+STATIC mp_uint_t ndarray_get_dim(mp_obj_t dim_in) {
+    mp_int_t dim = mp_obj_get_int(dim_in);
+    if (dim < 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative dimensions are not allowed"));
+    }
+    return dim;
+}
+
+mp_obj_ndarray_t *ndarray_new(byte dtype, byte ndim, mp_uint_t rows, mp_uint_t cols) {
+    ndarray_check_shape(rows, cols, dtype);
+    mp_obj_ndarray_t *o = m_new_obj(mp_obj_ndarray_t);
+    o->base.type = &mp_type_ndarray;
+    o->dtype = dtype;
+    o->ndim = ndim;
+    o->shape[0] = rows;
+    o->shape[1] = cols;
+    // A vector is stored as a single row; a row stride of 0 lets it be broadcast over a matrix
+    o->strides[0] = ndim == 1 ? 0 : cols;
+    o->strides[1] = 1;
+    o->storage = m_malloc0(rows * cols * ndarray_itemsize(dtype) + 1);
+    o->data = o->storage;
+    return o;
+}
+
+STATIC mp_obj_ndarray_t *ndarray_view(mp_obj_ndarray_t *self) {
+    mp_obj_ndarray_t *o = m_new_obj(mp_obj_ndarray_t);
+    *o = *self;
+    return o;
+}
+
+STATIC bool ndarray_is_contiguous(const mp_obj_ndarray_t *self) {
+    return self->strides[1] == 1 && (self->shape[0] == 1 || self->strides[0] == (mp_int_t)self->shape[1]);
+}
+
+STATIC mp_obj_ndarray_t *ndarray_copy_as(const mp_obj_ndarray_t *self, byte dtype) {
+    mp_obj_ndarray_t *o = ndarray_new(dtype, self->ndim, self->shape[0], self->shape[1]);
+    if (dtype == self->dtype && ndarray_is_contiguous(self)) {
+        memcpy(o->data, self->data, self->shape[0] * self->shape[1] * ndarray_itemsize(dtype));
+        return o;
+    }
+    for (mp_uint_t r = 0; r < self->shape[0]; r++) {
+        for (mp_uint_t c = 0; c < self->shape[1]; c++) {
+            ndarray_set(o, r, c, ndarray_get(self, r, c));
+        }
+    }
+    return o;
+}
+
+mp_obj_ndarray_t *ndarray_get_array(mp_obj_t obj) {
+    if (!MP_OBJ_IS_TYPE(obj, &mp_type_ndarray)) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "ndarray expected"));
+    }
+    return obj;
+}
+
+STATIC bool ndarray_is_sequence(mp_obj_t obj) {
+    return MP_OBJ_IS_TYPE(obj, &mp_type_list) || MP_OBJ_IS_TYPE(obj, &mp_type_tuple);
+}
+
+STATIC mp_obj_ndarray_t *ndarray_from_obj(mp_obj_t obj, byte dtype) {
+    if (MP_OBJ_IS_TYPE(obj, &mp_type_ndarray)) {
+        return ndarray_copy_as(obj, dtype);
+    }
+
+    mp_uint_t rows;
+    mp_obj_t *row_items;
+    mp_obj_get_array(obj, &rows, &row_items);
+
+    if (rows == 0 || !ndarray_is_sequence(row_items[0])) {
+        mp_obj_ndarray_t *o = ndarray_new(dtype, 1, 1, rows);
+        for (mp_uint_t c = 0; c < rows; c++) {
+            ndarray_set(o, 0, c, mp_obj_get_float(row_items[c]));
+        }
+        return o;
+    }
+
+    mp_uint_t cols;
+    mp_obj_t *items;
+    mp_obj_get_array(row_items[0], &cols, &items);
+    mp_obj_ndarray_t *o = ndarray_new(dtype, 2, rows, cols);
+    for (mp_uint_t r = 0; r < rows; r++) {
+        mp_uint_t len;
+        mp_obj_get_array(row_items[r], &len, &items);
+        if (len != cols) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "rows must have the same length"));
+        }
+        for (mp_uint_t c = 0; c < cols; c++) {
+            ndarray_set(o, r, c, mp_obj_get_float(items[c]));
+        }
+    }
+    return o;
+}
+
+STATIC mp_obj_ndarray_t *ndarray_new_shape(mp_obj_t shape_in, byte dtype) {
+    if (MP_OBJ_IS_TYPE(shape_in, &mp_type_tuple)) {
+        mp_uint_t ndim;
+        mp_obj_t *shape;
+        mp_obj_tuple_get(shape_in, &ndim, &shape);
+        if (ndim == 1) {
+            return ndarray_new(dtype, 1, 1, ndarray_get_dim(shape[0]));
+        } else if (ndim == 2) {
+            return ndarray_new(dtype, 2, ndarray_get_dim(shape[0]), ndarray_get_dim(shape[1]));
+        }
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "only 1 or 2 dimensions are supported"));
+    }
+    return ndarray_new(dtype, 1, 1, ndarray_get_dim(shape_in));
+}
+
+STATIC mp_obj_t ndarray_get_obj(const mp_obj_ndarray_t *self, mp_uint_t row, mp_uint_t col) {
+    mp_float_t val = ndarray_get(self, row, col);
+    if (self->dtype == NDARRAY_INT16) {
+        return MP_OBJ_NEW_SMALL_INT((mp_int_t)val);
+    }
+    return mp_obj_new_float(val);
+}
+
+STATIC void ndarray_print_row(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_ndarray_t *self, mp_uint_t row) {
+    print(env, "[");
+    for (mp_uint_t c = 0; c < self->shape[1]; c++) {
+        if (c > 0) {
+            print(env, ", ");
+        }
+        if (self->dtype == NDARRAY_INT16) {
+            print(env, "%d", (int)ndarray_get(self, row, c));
+        } else {
+            print(env, "%g", (double)ndarray_get(self, row, c));
+        }
+    }
+    print(env, "]");
+}
+
+STATIC void ndarray_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_ndarray_t *self = self_in;
+    print(env, "array(");
+    if (self->ndim == 1) {
+        ndarray_print_row(print, env, self, 0);
+    } else {
+        print(env, "[");
+        for (mp_uint_t r = 0; r < self->shape[0]; r++) {
+            if (r > 0) {
+                print(env, ",\n       ");
+            }
+            ndarray_print_row(print, env, self, r);
+        }
+        print(env, "]");
+    }
+    print(env, ", dtype=%s)", qstr_str(self->dtype == NDARRAY_INT16 ? MP_QSTR_int16
+        : self->dtype == NDARRAY_FLOAT32 ? MP_QSTR_float32 : MP_QSTR_float64));
+}
+
+STATIC const mp_arg_t ndarray_array_args[] = {
+    { MP_QSTR_obj, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_dtype, MP_ARG_INT, { .u_int = NDARRAY_FLOAT64 } },
+};
+
+STATIC mp_obj_t ndarray_make_new(mp_obj_t type_in, uint n_args, uint n_kw, const mp_obj_t *args) {
+    (void)type_in;
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    return ndarray_from_obj(args[0], n_args > 1 ? ndarray_get_dtype(args[1]) : NDARRAY_FLOAT64);
+}
+
+STATIC mp_obj_t ndarray_array(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(ndarray_array_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(ndarray_array_args), ndarray_array_args, vals);
+    return ndarray_from_obj(vals[0].u_obj, ndarray_get_dtype(MP_OBJ_NEW_SMALL_INT(vals[1].u_int)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ndarray_array_obj, 1, ndarray_array);
+
+/******************************************************************************/
+// Elementwise operations
+
+STATIC mp_float_t ndarray_op(mp_uint_t op, mp_float_t x, mp_float_t y) {
+    switch (op) {
+        case MP_BINARY_OP_ADD: return x + y;
+        case MP_BINARY_OP_SUBTRACT: return x - y;
+        case MP_BINARY_OP_MULTIPLY: return x * y;
+        case MP_BINARY_OP_TRUE_DIVIDE: return x / y;
+        default: return MICROPY_FLOAT_C_FUN(pow)(x, y);
+    }
+}
+
+// dest = lhs op rhs, where rhs is either an array which broadcasts to lhs or,
+// if it's NULL, the scalar rhs_val
+STATIC void ndarray_apply(mp_uint_t op, mp_obj_ndarray_t *dest, const mp_obj_ndarray_t *lhs, const mp_obj_ndarray_t *rhs, mp_float_t rhs_val) {
+    for (mp_uint_t r = 0; r < lhs->shape[0]; r++) {
+        for (mp_uint_t c = 0; c < lhs->shape[1]; c++) {
+            if (rhs != NULL) {
+                rhs_val = ndarray_get(rhs, r, c);
+            }
+            ndarray_set(dest, r, c, ndarray_op(op, ndarray_get(lhs, r, c), rhs_val));
+        }
+    }
+}
+
+// rhs can be applied to lhs if it has the same shape or is a vector as long as lhs' rows
+STATIC bool ndarray_broadcasts(const mp_obj_ndarray_t *lhs, const mp_obj_ndarray_t *rhs) {
+    return rhs->shape[1] == lhs->shape[1] && (rhs->shape[0] == lhs->shape[0] || rhs->ndim == 1);
+}
+
+STATIC mp_obj_t ndarray_unary_op(mp_uint_t op, mp_obj_t self_in) {
+    mp_obj_ndarray_t *self = self_in;
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return MP_BOOL(self->shape[0] * self->shape[1] != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->ndim == 1 ? self->shape[1] : self->shape[0]);
+        case MP_UNARY_OP_POSITIVE: return ndarray_copy_as(self, self->dtype);
+        case MP_UNARY_OP_NEGATIVE: {
+            mp_obj_ndarray_t *o = ndarray_new(self->dtype, self->ndim, self->shape[0], self->shape[1]);
+            ndarray_apply(MP_BINARY_OP_MULTIPLY, o, self, NULL, -1);
+            return o;
+        }
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t ndarray_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    mp_obj_ndarray_t *lhs = lhs_in;
+    bool inplace = false;
+
+    switch (op) {
+        case MP_BINARY_OP_INPLACE_ADD:
+        case MP_BINARY_OP_INPLACE_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_TRUE_DIVIDE:
+        case MP_BINARY_OP_INPLACE_POWER:
+            op += MP_BINARY_OP_ADD - MP_BINARY_OP_INPLACE_ADD;
+            inplace = true;
+            break;
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_TRUE_DIVIDE:
+        case MP_BINARY_OP_POWER:
+            break;
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+
+    mp_obj_ndarray_t *rhs = NULL;
+    mp_float_t rhs_val = 0;
+    byte dtype = lhs->dtype;
+
+    if (MP_OBJ_IS_TYPE(rhs_in, &mp_type_ndarray)) {
+        rhs = rhs_in;
+        if (!ndarray_broadcasts(lhs, rhs)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "shape mismatch"));
+        }
+        if (ndarray_dtype_rank(rhs->dtype) > ndarray_dtype_rank(dtype)) {
+            dtype = rhs->dtype;
+        }
+    } else if (MP_OBJ_IS_SMALL_INT(rhs_in) || MP_OBJ_IS_TYPE(rhs_in, &mp_type_int)) {
+        rhs_val = mp_obj_get_int(rhs_in);
+    } else if (MP_OBJ_IS_TYPE(rhs_in, &mp_type_float)) {
+        rhs_val = mp_obj_float_get(rhs_in);
+        if (dtype == NDARRAY_INT16) {
+            dtype = NDARRAY_FLOAT64;
+        }
+    } else {
+        return MP_OBJ_NULL; // op not supported
+    }
+
+    if (inplace) {
+        if (rhs != NULL && rhs != lhs && rhs->storage == lhs->storage) {
+            // Overlapping views, e.g. m -= m[0] or a += a.T
+            rhs = ndarray_copy_as(rhs, rhs->dtype);
+        }
+        ndarray_apply(op, lhs, lhs, rhs, rhs_val);
+        return lhs;
+    }
+
+    if (op == MP_BINARY_OP_TRUE_DIVIDE && dtype == NDARRAY_INT16) {
+        dtype = NDARRAY_FLOAT64;
+    }
+    mp_obj_ndarray_t *o = ndarray_new(dtype, lhs->ndim, lhs->shape[0], lhs->shape[1]);
+    ndarray_apply(op, o, lhs, rhs, rhs_val);
+    return o;
+}
+
+/******************************************************************************/
+// Indexing and slicing
+
+// Turns an int or slice index into start, step and number of elements along an
+// axis of length len. Returns false for an int index, which removes the axis.
+STATIC bool ndarray_index(mp_obj_t index, mp_uint_t len, mp_int_t *start, mp_int_t *step, mp_uint_t *count) {
+    if (!MP_OBJ_IS_TYPE(index, &mp_type_slice)) {
+        *start = mp_get_index(&mp_type_ndarray, len, index, false);
+        *step = 1;
+        *count = 1;
+        return false;
+    }
+
+    mp_obj_t start_in, stop_in, step_in;
+    mp_obj_slice_get(index, &start_in, &stop_in, &step_in);
+    *step = step_in == mp_const_none ? 1 : mp_obj_get_int(step_in);
+    if (*step == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "slice step cannot be zero"));
+    }
+
+    mp_int_t lo = *step > 0 ? 0 : -1, hi = *step > 0 ? (mp_int_t)len : (mp_int_t)len - 1;
+    mp_int_t b = *step > 0 ? lo : hi, e = *step > 0 ? hi : lo;
+    if (start_in != mp_const_none) {
+        b = mp_obj_get_int(start_in);
+        if (b < 0) {
+            b += len;
+        }
+        b = MAX(lo, MIN(hi, b));
+    }
+    if (stop_in != mp_const_none) {
+        e = mp_obj_get_int(stop_in);
+        if (e < 0) {
+            e += len;
+        }
+        e = MAX(lo, MIN(hi, e));
+    }
+
+    *start = b;
+    if (*step > 0) {
+        *count = e > b ? (e - b + *step - 1) / *step : 0;
+    } else {
+        *count = b > e ? (b - e - *step - 1) / -*step : 0;
+    }
+    return true;
+}
+
+// Returns the view selected by index, or NULL and the position in row and col
+// if a single element was selected.
+STATIC mp_obj_ndarray_t *ndarray_subscr_view(mp_obj_ndarray_t *self, mp_obj_t index, mp_uint_t *row, mp_uint_t *col) {
+    mp_obj_t axes[2] = { index, mp_const_none };
+    mp_uint_t n_axes = 1;
+    if (MP_OBJ_IS_TYPE(index, &mp_type_tuple)) {
+        mp_obj_t *items;
+        mp_obj_tuple_get(index, &n_axes, &items);
+        if (n_axes > self->ndim || n_axes == 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "too many indices"));
+        }
+        memcpy(axes, items, n_axes * sizeof(mp_obj_t));
+    }
+
+    if (self->ndim == 1) {
+        mp_int_t start, step;
+        mp_uint_t count;
+        if (!ndarray_index(axes[0], self->shape[1], &start, &step, &count)) {
+            *row = 0;
+            *col = start;
+            return NULL;
+        }
+        mp_obj_ndarray_t *o = ndarray_view(self);
+        o->data = (byte*)self->data + start * self->strides[1] * (mp_int_t)ndarray_itemsize(self->dtype);
+        o->shape[1] = count;
+        o->strides[1] *= step;
+        return o;
+    }
+
+    mp_int_t start[2] = { 0, 0 }, step[2] = { 1, 1 };
+    mp_uint_t count[2] = { self->shape[0], self->shape[1] };
+    bool keep[2] = { true, true };
+    keep[0] = ndarray_index(axes[0], self->shape[0], &start[0], &step[0], &count[0]);
+    if (n_axes == 2) {
+        keep[1] = ndarray_index(axes[1], self->shape[1], &start[1], &step[1], &count[1]);
+    }
+
+    if (!keep[0] && !keep[1]) {
+        *row = start[0];
+        *col = start[1];
+        return NULL;
+    }
+
+    mp_obj_ndarray_t *o = ndarray_view(self);
+    o->data = (byte*)self->data + (start[0] * self->strides[0] + start[1] * self->strides[1]) * (mp_int_t)ndarray_itemsize(self->dtype);
+    if (keep[0] && keep[1]) {
+        o->shape[0] = count[0];
+        o->shape[1] = count[1];
+        o->strides[0] *= step[0];
+        o->strides[1] *= step[1];
+    } else {
+        // One axis left, make it the columns of a vector
+        int axis = keep[0] ? 0 : 1;
+        o->ndim = 1;
+        o->shape[0] = 1;
+        o->shape[1] = count[axis];
+        o->strides[0] = 0;
+        o->strides[1] = self->strides[axis] * step[axis];
+    }
+    return o;
+}
+
+STATIC void ndarray_assign(mp_obj_ndarray_t *dest, mp_obj_t value) {
+    if (MP_OBJ_IS_TYPE(value, &mp_type_ndarray) || ndarray_is_sequence(value)) {
+        mp_obj_ndarray_t *src = MP_OBJ_IS_TYPE(value, &mp_type_ndarray) ? value : ndarray_from_obj(value, NDARRAY_FLOAT64);
+        if (!ndarray_broadcasts(dest, src)) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "shape mismatch"));
+        }
+        if (src->storage == dest->storage) {
+            // Overlapping views, e.g. a[1:] = a[:-1]
+            src = ndarray_copy_as(src, src->dtype);
+        }
+        for (mp_uint_t r = 0; r < dest->shape[0]; r++) {
+            for (mp_uint_t c = 0; c < dest->shape[1]; c++) {
+                ndarray_set(dest, r, c, ndarray_get(src, r, c));
+            }
+        }
+        return;
+    }
+
+    mp_float_t val = mp_obj_get_float(value);
+    for (mp_uint_t r = 0; r < dest->shape[0]; r++) {
+        for (mp_uint_t c = 0; c < dest->shape[1]; c++) {
+            ndarray_set(dest, r, c, val);
+        }
+    }
+}
+
+STATIC mp_obj_t ndarray_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_ndarray_t *self = self_in;
+    if (value == MP_OBJ_NULL) {
+        return MP_OBJ_NULL; // delete not supported
+    }
+
+    mp_uint_t row, col;
+    mp_obj_ndarray_t *view = ndarray_subscr_view(self, index, &row, &col);
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return view != NULL ? view : ndarray_get_obj(self, row, col);
+    }
+
+    // store
+    if (view == NULL) {
+        ndarray_set(self, row, col, mp_obj_get_float(value));
+    } else {
+        ndarray_assign(view, value);
+    }
+    return mp_const_none;
+}
+
+STATIC mp_int_t ndarray_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    (void)flags;
+    mp_obj_ndarray_t *self = self_in;
+    if (!ndarray_is_contiguous(self)) {
+        // Only arrays without gaps between their elements can be shared
+        return 1;
+    }
+    bufinfo->buf = self->data;
+    bufinfo->len = self->shape[0] * self->shape[1] * (mp_int_t)ndarray_itemsize(self->dtype);
+    bufinfo->typecode = self->dtype;
+    return 0;
+}
+
+/******************************************************************************/
+// Iterator over the elements of a vector or the rows of a matrix
+
+typedef struct _mp_obj_ndarray_it_t {
+    mp_obj_base_t base;
+    mp_obj_ndarray_t *array;
+    mp_uint_t cur;
+} mp_obj_ndarray_it_t;
+
+STATIC mp_obj_t ndarray_it_iternext(mp_obj_t self_in) {
+    mp_obj_ndarray_it_t *self = self_in;
+    mp_obj_ndarray_t *array = self->array;
+    if (array->ndim == 1) {
+        if (self->cur >= array->shape[1]) {
+            return MP_OBJ_STOP_ITERATION;
+        }
+        return ndarray_get_obj(array, 0, self->cur++);
+    }
+    if (self->cur >= array->shape[0]) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_uint_t row, col;
+    return ndarray_subscr_view(array, MP_OBJ_NEW_SMALL_INT(self->cur++), &row, &col);
+}
+
+STATIC const mp_obj_type_t ndarray_it_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity,
+    .iternext = ndarray_it_iternext,
+};
+
+STATIC mp_obj_t ndarray_getiter(mp_obj_t self_in) {
+    mp_obj_ndarray_it_t *o = m_new_obj(mp_obj_ndarray_it_t);
+    o->base.type = &ndarray_it_type;
+    o->array = self_in;
+    o->cur = 0;
+    return o;
+}
+
+/******************************************************************************/
+// Methods
+
+STATIC mp_obj_t ndarray_transpose(mp_obj_t self_in) {
+    mp_obj_ndarray_t *self = ndarray_get_array(self_in);
+    mp_obj_ndarray_t *o = ndarray_view(self);
+    if (self->ndim == 2) {
+        o->shape[0] = self->shape[1];
+        o->shape[1] = self->shape[0];
+        o->strides[0] = self->strides[1];
+        o->strides[1] = self->strides[0];
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ndarray_transpose_obj, ndarray_transpose);
+
+STATIC mp_obj_t ndarray_reshape(uint n_args, const mp_obj_t *args) {
+    mp_obj_ndarray_t *self = ndarray_get_array(args[0]);
+    mp_uint_t size = self->shape[0] * self->shape[1];
+
+    mp_uint_t ndim = n_args - 1;
+    const mp_obj_t *shape_in = args + 1;
+    if (n_args == 2 && MP_OBJ_IS_TYPE(args[1], &mp_type_tuple)) {
+        mp_obj_tuple_get(args[1], &ndim, (mp_obj_t**)&shape_in);
+    }
+    if (ndim < 1 || ndim > 2) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "only 1 or 2 dimensions are supported"));
+    }
+
+    // One dimension may be -1, it's calculated from the size
+    mp_int_t shape[2] = { 1, 1 };
+    int unknown = -1;
+    for (mp_uint_t i = 0; i < ndim; i++) {
+        shape[i] = mp_obj_get_int(shape_in[i]);
+        if (shape[i] == -1 && unknown == -1) {
+            unknown = i;
+        } else if (shape[i] < 0) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "negative dimensions are not allowed"));
+        }
+    }
+    if (unknown != -1) {
+        mp_int_t known = shape[1 - unknown];
+        shape[unknown] = known > 0 ? size / known : 0;
+    }
+    ndarray_check_shape(shape[0], shape[1], self->dtype);
+    if ((mp_uint_t)shape[0] * (mp_uint_t)shape[1] != size) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "cannot reshape array to this size"));
+    }
+
+    mp_obj_ndarray_t *o = ndarray_is_contiguous(self) ? ndarray_view(self) : ndarray_copy_as(self, self->dtype);
+    o->ndim = ndim;
+    o->shape[0] = ndim == 1 ? 1 : shape[0];
+    o->shape[1] = ndim == 1 ? shape[0] : shape[1];
+    o->strides[0] = ndim == 1 ? 0 : o->shape[1];
+    o->strides[1] = 1;
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ndarray_reshape_obj, 2, 3, ndarray_reshape);
+
+STATIC mp_obj_t ndarray_copy(mp_obj_t self_in) {
+    mp_obj_ndarray_t *self = ndarray_get_array(self_in);
+    return ndarray_copy_as(self, self->dtype);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ndarray_copy_obj, ndarray_copy);
+
+STATIC mp_obj_t ndarray_astype(mp_obj_t self_in, mp_obj_t dtype_in) {
+    return ndarray_copy_as(ndarray_get_array(self_in), ndarray_get_dtype(dtype_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ndarray_astype_obj, ndarray_astype);
+
+STATIC mp_obj_t ndarray_row_list(mp_obj_ndarray_t *self, mp_uint_t row) {
+    mp_obj_list_t *l = mp_obj_new_list(self->shape[1], NULL);
+    for (mp_uint_t c = 0; c < self->shape[1]; c++) {
+        l->items[c] = ndarray_get_obj(self, row, c);
+    }
+    return l;
+}
+
+STATIC mp_obj_t ndarray_tolist(mp_obj_t self_in) {
+    mp_obj_ndarray_t *self = ndarray_get_array(self_in);
+    if (self->ndim == 1) {
+        return ndarray_row_list(self, 0);
+    }
+    mp_obj_list_t *l = mp_obj_new_list(self->shape[0], NULL);
+    for (mp_uint_t r = 0; r < self->shape[0]; r++) {
+        l->items[r] = ndarray_row_list(self, r);
+    }
+    return l;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ndarray_tolist_obj, ndarray_tolist);
+
+STATIC mp_obj_t ndarray_fill(mp_obj_t self_in, mp_obj_t value) {
+    ndarray_assign(ndarray_get_array(self_in), value);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ndarray_fill_obj, ndarray_fill);
+
+// Reduces count elements starting at (row, col), moving by (drow, dcol)
+STATIC mp_float_t ndarray_reduce_line(const mp_obj_ndarray_t *self, int kind, mp_uint_t row, mp_uint_t col, mp_uint_t drow, mp_uint_t dcol, mp_uint_t count) {
+    mp_float_t acc = ndarray_get(self, row, col);
+    for (mp_uint_t i = 1; i < count; i++) {
+        row += drow;
+        col += dcol;
+        mp_float_t val = ndarray_get(self, row, col);
+        switch (kind) {
+            case REDUCE_MIN: if (val < acc) { acc = val; } break;
+            case REDUCE_MAX: if (val > acc) { acc = val; } break;
+            default: acc += val; break;
+        }
+    }
+    if (kind == REDUCE_MEAN) {
+        acc /= count;
+    }
+    return acc;
+}
+
+STATIC mp_obj_t ndarray_reduce(uint n_args, const mp_obj_t *args, int kind) {
+    mp_obj_ndarray_t *self = ndarray_get_array(args[0]);
+    mp_uint_t rows = self->shape[0], cols = self->shape[1];
+    bool keep_dtype = kind == REDUCE_MIN || kind == REDUCE_MAX;
+
+    if (rows * cols == 0) {
+        if (kind == REDUCE_SUM) {
+            return MP_OBJ_NEW_SMALL_INT(0);
+        }
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "empty array"));
+    }
+
+    if (n_args == 1 || args[1] == mp_const_none || self->ndim == 1) {
+        mp_float_t acc;
+        if (kind == REDUCE_MIN || kind == REDUCE_MAX) {
+            acc = ndarray_reduce_line(self, kind, 0, 0, 0, 1, cols);
+            for (mp_uint_t r = 1; r < rows; r++) {
+                mp_float_t val = ndarray_reduce_line(self, kind, r, 0, 0, 1, cols);
+                if (kind == REDUCE_MIN ? val < acc : val > acc) {
+                    acc = val;
+                }
+            }
+        } else {
+            acc = 0;
+            for (mp_uint_t r = 0; r < rows; r++) {
+                acc += ndarray_reduce_line(self, REDUCE_SUM, r, 0, 0, 1, cols);
+            }
+            if (kind == REDUCE_MEAN) {
+                acc /= rows * cols;
+            }
+        }
+        if (self->dtype == NDARRAY_INT16 && kind != REDUCE_MEAN) {
+            return mp_obj_new_int((mp_int_t)acc);
+        }
+        return mp_obj_new_float(acc);
+    }
+
+    mp_int_t axis = mp_obj_get_int(args[1]);
+    if (axis != 0 && axis != 1) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "axis out of range"));
+    }
+    mp_uint_t len = axis == 0 ? cols : rows;
+    mp_obj_ndarray_t *o = ndarray_new(keep_dtype ? self->dtype : NDARRAY_FLOAT64, 1, 1, len);
+    for (mp_uint_t i = 0; i < len; i++) {
+        mp_float_t val;
+        if (axis == 0) {
+            val = ndarray_reduce_line(self, kind, 0, i, 1, 0, rows);
+        } else {
+            val = ndarray_reduce_line(self, kind, i, 0, 0, 1, cols);
+        }
+        ndarray_set(o, 0, i, val);
+    }
+    return o;
+}
+
+STATIC mp_obj_t ndarray_sum(uint n_args, const mp_obj_t *args) {
+    return ndarray_reduce(n_args, args, REDUCE_SUM);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ndarray_sum_obj, 1, 2, ndarray_sum);
+
+STATIC mp_obj_t ndarray_mean(uint n_args, const mp_obj_t *args) {
+    return ndarray_reduce(n_args, args, REDUCE_MEAN);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ndarray_mean_obj, 1, 2, ndarray_mean);
+
+STATIC mp_obj_t ndarray_min(uint n_args, const mp_obj_t *args) {
+    return ndarray_reduce(n_args, args, REDUCE_MIN);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ndarray_min_obj, 1, 2, ndarray_min);
+
+STATIC mp_obj_t ndarray_max(uint n_args, const mp_obj_t *args) {
+    return ndarray_reduce(n_args, args, REDUCE_MAX);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ndarray_max_obj, 1, 2, ndarray_max);
+
+STATIC const mp_map_elem_t ndarray_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR_reshape), (mp_obj_t)&ndarray_reshape_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_transpose), (mp_obj_t)&ndarray_transpose_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_copy), (mp_obj_t)&ndarray_copy_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_astype), (mp_obj_t)&ndarray_astype_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tolist), (mp_obj_t)&ndarray_tolist_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fill), (mp_obj_t)&ndarray_fill_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sum), (mp_obj_t)&ndarray_sum_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mean), (mp_obj_t)&ndarray_mean_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_min), (mp_obj_t)&ndarray_min_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_max), (mp_obj_t)&ndarray_max_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(ndarray_locals_dict, ndarray_locals_dict_table);
+
+// A type with load_attr doesn't get its locals_dict searched, so methods are looked up here too
+STATIC void ndarray_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    mp_obj_ndarray_t *self = self_in;
+    switch (attr) {
+        case MP_QSTR_shape:
+            if (self->ndim == 1) {
+                mp_obj_t shape[1] = { MP_OBJ_NEW_SMALL_INT(self->shape[1]) };
+                dest[0] = mp_obj_new_tuple(1, shape);
+            } else {
+                mp_obj_t shape[2] = { MP_OBJ_NEW_SMALL_INT(self->shape[0]), MP_OBJ_NEW_SMALL_INT(self->shape[1]) };
+                dest[0] = mp_obj_new_tuple(2, shape);
+            }
+            return;
+        case MP_QSTR_ndim:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->ndim);
+            return;
+        case MP_QSTR_size:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->shape[0] * self->shape[1]);
+            return;
+        case MP_QSTR_dtype:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->dtype);
+            return;
+        case MP_QSTR_T:
+            dest[0] = ndarray_transpose(self);
+            return;
+    }
+
+    mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&ndarray_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        dest[0] = elem->value;
+        dest[1] = self_in;
+    }
+}
+
+const mp_obj_type_t mp_type_ndarray = {
+    { &mp_type_type },
+    .name = MP_QSTR_ndarray,
+    .print = ndarray_print,
+    .make_new = ndarray_make_new,
+    .unary_op = ndarray_unary_op,
+    .binary_op = ndarray_binary_op,
+    .load_attr = ndarray_load_attr,
+    .subscr = ndarray_subscr,
+    .getiter = ndarray_getiter,
+    .buffer_p = { .get_buffer = ndarray_get_buffer },
+    .locals_dict = (mp_obj_t)&ndarray_locals_dict,
+};
+
+/******************************************************************************/
+// Module functions
+
+STATIC const mp_arg_t ndarray_shape_args[] = {
+    { MP_QSTR_shape, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_dtype, MP_ARG_INT, { .u_int = NDARRAY_FLOAT64 } },
+};
+
+STATIC mp_obj_t ndarray_zeros(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(ndarray_shape_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(ndarray_shape_args), ndarray_shape_args, vals);
+    return ndarray_new_shape(vals[0].u_obj, ndarray_get_dtype(MP_OBJ_NEW_SMALL_INT(vals[1].u_int)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ndarray_zeros_obj, 1, ndarray_zeros);
+
+STATIC mp_obj_t ndarray_ones(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    mp_obj_ndarray_t *o = ndarray_zeros(n_args, args, kw_args);
+    ndarray_assign(o, MP_OBJ_NEW_SMALL_INT(1));
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ndarray_ones_obj, 1, ndarray_ones);
+
+STATIC const mp_arg_t ndarray_eye_args[] = {
+    { MP_QSTR_n, MP_ARG_REQUIRED | MP_ARG_INT, {} },
+    { MP_QSTR_dtype, MP_ARG_INT, { .u_int = NDARRAY_FLOAT64 } },
+};
+
+STATIC mp_obj_t ndarray_eye(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(ndarray_eye_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(ndarray_eye_args), ndarray_eye_args, vals);
+    mp_uint_t n = MAX(0, vals[0].u_int);
+    mp_obj_ndarray_t *o = ndarray_new(ndarray_get_dtype(MP_OBJ_NEW_SMALL_INT(vals[1].u_int)), 2, n, n);
+    for (mp_uint_t i = 0; i < n; i++) {
+        ndarray_set(o, i, i, 1);
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ndarray_eye_obj, 1, ndarray_eye);
+
+STATIC const mp_arg_t ndarray_linspace_args[] = {
+    { MP_QSTR_start, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_stop, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_num, MP_ARG_INT, { .u_int = 50 } },
+    { MP_QSTR_dtype, MP_ARG_INT, { .u_int = NDARRAY_FLOAT64 } },
+};
+
+STATIC mp_obj_t ndarray_linspace(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(ndarray_linspace_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(ndarray_linspace_args), ndarray_linspace_args, vals);
+    mp_float_t start = mp_obj_get_float(vals[0].u_obj), stop = mp_obj_get_float(vals[1].u_obj);
+    mp_uint_t num = MAX(0, vals[2].u_int);
+    mp_obj_ndarray_t *o = ndarray_new(ndarray_get_dtype(MP_OBJ_NEW_SMALL_INT(vals[3].u_int)), 1, 1, num);
+    mp_float_t step = num > 1 ? (stop - start) / (num - 1) : 0;
+    for (mp_uint_t i = 0; i < num; i++) {
+        ndarray_set(o, 0, i, start + i * step);
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ndarray_linspace_obj, 2, ndarray_linspace);
+
+STATIC mp_obj_t ndarray_dot(mp_obj_t a_in, mp_obj_t b_in) {
+    mp_obj_ndarray_t *a = ndarray_get_array(a_in), *b = ndarray_get_array(b_in);
+
+    // A vector on the left is a row, on the right a column
+    mp_uint_t n = a->shape[1];
+    mp_uint_t b_rows = b->ndim == 1 ? b->shape[1] : b->shape[0];
+    mp_uint_t b_cols = b->ndim == 1 ? 1 : b->shape[1];
+    if (b_rows != n) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "shape mismatch"));
+    }
+
+    byte dtype = ndarray_dtype_rank(a->dtype) > ndarray_dtype_rank(b->dtype) ? a->dtype : b->dtype;
+    mp_obj_ndarray_t *o;
+    if (a->ndim == 1 && b->ndim == 1) {
+        o = NULL;
+    } else if (b->ndim == 1) {
+        o = ndarray_new(dtype, 1, 1, a->shape[0]);
+    } else if (a->ndim == 1) {
+        o = ndarray_new(dtype, 1, 1, b_cols);
+    } else {
+        o = ndarray_new(dtype, 2, a->shape[0], b_cols);
+    }
+
+    for (mp_uint_t r = 0; r < a->shape[0]; r++) {
+        for (mp_uint_t c = 0; c < b_cols; c++) {
+            mp_float_t acc = 0;
+            for (mp_uint_t k = 0; k < n; k++) {
+                acc += ndarray_get(a, r, k) * (b->ndim == 1 ? ndarray_get(b, 0, k) : ndarray_get(b, k, c));
+            }
+            if (o == NULL) {
+                return dtype == NDARRAY_INT16 ? mp_obj_new_int((mp_int_t)acc) : mp_obj_new_float(acc);
+            }
+            if (o->ndim == 1) {
+                ndarray_set(o, 0, b->ndim == 1 ? r : c, acc);
+            } else {
+                ndarray_set(o, r, c, acc);
+            }
+        }
+    }
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ndarray_dot_obj, ndarray_dot);
+
+// LU decomposition with partial pivoting of the square matrix a, into a
+// row-major buffer of n * n. perm receives the row permutation. Returns the sign
+// of the permutation, or 0 if the matrix is singular.
+STATIC int ndarray_lu(const mp_obj_ndarray_t *a, mp_float_t *lu, mp_uint_t *perm) {
+    mp_uint_t n = a->shape[0];
+    if (a->ndim != 2 || a->shape[1] != n) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "square matrix expected"));
+    }
+
+    for (mp_uint_t r = 0; r < n; r++) {
+        perm[r] = r;
+        for (mp_uint_t c = 0; c < n; c++) {
+            lu[r * n + c] = ndarray_get(a, r, c);
+        }
+    }
+
+    int sign = 1;
+    for (mp_uint_t k = 0; k < n; k++) {
+        mp_uint_t pivot = k;
+        for (mp_uint_t r = k + 1; r < n; r++) {
+            if (MICROPY_FLOAT_C_FUN(fabs)(lu[r * n + k]) > MICROPY_FLOAT_C_FUN(fabs)(lu[pivot * n + k])) {
+                pivot = r;
+            }
+        }
+        if (lu[pivot * n + k] == 0) {
+            return 0;
+        }
+        if (pivot != k) {
+            for (mp_uint_t c = 0; c < n; c++) {
+                mp_float_t t = lu[k * n + c];
+                lu[k * n + c] = lu[pivot * n + c];
+                lu[pivot * n + c] = t;
+            }
+            mp_uint_t t = perm[k];
+            perm[k] = perm[pivot];
+            perm[pivot] = t;
+            sign = -sign;
+        }
+        for (mp_uint_t r = k + 1; r < n; r++) {
+            mp_float_t f = lu[r * n + k] /= lu[k * n + k];
+            for (mp_uint_t c = k + 1; c < n; c++) {
+                lu[r * n + c] -= f * lu[k * n + c];
+            }
+        }
+    }
+    return sign;
+}
+
+// Solves lu * x = b for every column of b into x, b is left unchanged
+STATIC void ndarray_lu_solve(const mp_float_t *lu, const mp_uint_t *perm, mp_uint_t n, mp_obj_ndarray_t *b, mp_obj_ndarray_t *x) {
+    mp_float_t *y = m_new(mp_float_t, n);
+    mp_uint_t cols = b->ndim == 1 ? 1 : b->shape[1];
+    for (mp_uint_t c = 0; c < cols; c++) {
+        for (mp_uint_t r = 0; r < n; r++) {
+            mp_float_t acc = b->ndim == 1 ? ndarray_get(b, 0, perm[r]) : ndarray_get(b, perm[r], c);
+            for (mp_uint_t k = 0; k < r; k++) {
+                acc -= lu[r * n + k] * y[k];
+            }
+            y[r] = acc;
+        }
+        for (mp_uint_t r = n; r-- > 0;) {
+            mp_float_t acc = y[r];
+            for (mp_uint_t k = r + 1; k < n; k++) {
+                acc -= lu[r * n + k] * y[k];
+            }
+            y[r] = acc / lu[r * n + r];
+        }
+        for (mp_uint_t r = 0; r < n; r++) {
+            if (x->ndim == 1) {
+                ndarray_set(x, 0, r, y[r]);
+            } else {
+                ndarray_set(x, r, c, y[r]);
+            }
+        }
+    }
+    m_del(mp_float_t, y, n);
+}
+
+STATIC mp_obj_t ndarray_solve(mp_obj_t a_in, mp_obj_t b_in) {
+    mp_obj_ndarray_t *a = ndarray_get_array(a_in);
+    mp_obj_ndarray_t *b = MP_OBJ_IS_TYPE(b_in, &mp_type_ndarray) ? b_in : ndarray_from_obj(b_in, NDARRAY_FLOAT64);
+    mp_uint_t n = a->shape[0];
+    if ((b->ndim == 1 ? b->shape[1] : b->shape[0]) != n) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "shape mismatch"));
+    }
+
+    mp_float_t *lu = m_new(mp_float_t, n * n);
+    mp_uint_t *perm = m_new(mp_uint_t, n);
+    if (ndarray_lu(a, lu, perm) == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "matrix is singular"));
+    }
+    mp_obj_ndarray_t *x = ndarray_new(NDARRAY_FLOAT64, b->ndim, b->shape[0], b->shape[1]);
+    ndarray_lu_solve(lu, perm, n, b, x);
+    m_del(mp_float_t, lu, n * n);
+    m_del(mp_uint_t, perm, n);
+    return x;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ndarray_solve_obj, ndarray_solve);
+
+STATIC mp_obj_t ndarray_inv(mp_obj_t a_in) {
+    mp_obj_ndarray_t *a = ndarray_get_array(a_in);
+    mp_uint_t n = a->shape[0];
+    mp_float_t *lu = m_new(mp_float_t, n * n);
+    mp_uint_t *perm = m_new(mp_uint_t, n);
+    if (ndarray_lu(a, lu, perm) == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "matrix is singular"));
+    }
+    mp_obj_ndarray_t *id = ndarray_new(NDARRAY_FLOAT64, 2, n, n);
+    for (mp_uint_t i = 0; i < n; i++) {
+        ndarray_set(id, i, i, 1);
+    }
+    // Solving in place is fine: column c of the identity is only read while computing column c
+    ndarray_lu_solve(lu, perm, n, id, id);
+    m_del(mp_float_t, lu, n * n);
+    m_del(mp_uint_t, perm, n);
+    return id;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ndarray_inv_obj, ndarray_inv);
+
+STATIC mp_obj_t ndarray_det(mp_obj_t a_in) {
+    mp_obj_ndarray_t *a = ndarray_get_array(a_in);
+    mp_uint_t n = a->shape[0];
+    mp_float_t *lu = m_new(mp_float_t, n * n);
+    mp_uint_t *perm = m_new(mp_uint_t, n);
+    mp_float_t det = ndarray_lu(a, lu, perm);
+    for (mp_uint_t i = 0; i < n && det != 0; i++) {
+        det *= lu[i * n + i];
+    }
+    m_del(mp_float_t, lu, n * n);
+    m_del(mp_uint_t, perm, n);
+    return mp_obj_new_float(det);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ndarray_det_obj, ndarray_det);
+
+STATIC const mp_map_elem_t mp_module_ndarray_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_ndarray) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ndarray), (mp_obj_t)&mp_type_ndarray },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_array), (mp_obj_t)&ndarray_array_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_zeros), (mp_obj_t)&ndarray_zeros_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ones), (mp_obj_t)&ndarray_ones_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_eye), (mp_obj_t)&ndarray_eye_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_linspace), (mp_obj_t)&ndarray_linspace_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_dot), (mp_obj_t)&ndarray_dot_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_solve), (mp_obj_t)&ndarray_solve_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_inv), (mp_obj_t)&ndarray_inv_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_det), (mp_obj_t)&ndarray_det_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_int16), MP_OBJ_NEW_SMALL_INT(NDARRAY_INT16) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_float32), MP_OBJ_NEW_SMALL_INT(NDARRAY_FLOAT32) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_float64), MP_OBJ_NEW_SMALL_INT(NDARRAY_FLOAT64) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_ndarray_globals, mp_module_ndarray_globals_table);
+
+const mp_obj_module_t mp_module_ndarray = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_ndarray,
+    .globals = (mp_obj_dict_t*)&mp_module_ndarray_globals,
+};
@@ -8,13 +8,62 @@
 #include "runtime.h"
 #include "objtuple.h"
 #include "texture.h"
+#include "profile.h"
+#include "hud.h"
+#include "plot.h"
+#include "raster3d.h"
+#include "font.h"
+#include "eventloop.h"
+#include "timer.h"
+
+// Seconds since the epoch. The host build has no RTC at this address.
+#ifdef NSP_HOST
+#define NSP_RTC_SECONDS() nsp_host_rtc()
+#else
+#define NSP_RTC_SECONDS() (*(volatile unsigned int*)0x90090000)
+#endif
 
 static mp_obj_t nsp_readRTC()
 {
-	return mp_obj_new_int(*(unsigned int*)0x90090000);
+	return mp_obj_new_int(NSP_RTC_SECONDS());
 }
 static MP_DEFINE_CONST_FUN_OBJ_0(nsp_readRTC_obj, nsp_readRTC);
 
+// Milliseconds from the tick counter, only for measuring differences: the
+// value wraps around at a power of two, take differences with ticks_diff().
+// The 32 bit counter is extended to 64 bits here, so ticks() has to be called
+// at least once per counter period (36 hours) to keep the count continuous.
+// Falls back to the RTC (one second resolution) if there is no timer.
+static uint64_t ticks_total;
+static uint32_t ticks_last;
+
+static mp_obj_t nsp_ticks()
+{
+	uint64_t ms;
+	if(!nsp_timer_start())
+		ms = (uint64_t)NSP_RTC_SECONDS() * 1000;
+	else
+	{
+		uint32_t now = nsp_timer_ticks();
+		ticks_total += (uint32_t)(now - ticks_last);
+		ticks_last = now;
+		ms = ticks_total * 1000 / NSP_TIMER_HZ;
+	}
+
+	return MP_OBJ_NEW_SMALL_INT(ms & MP_SMALL_INT_POSITIVE_MASK);
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(nsp_ticks_obj, nsp_ticks);
+
+// new - old in ms for two values of ticks(), also across the wrap around.
+// Negative if old was taken after new.
+static mp_obj_t nsp_ticks_diff(mp_obj_t new_in, mp_obj_t old_in)
+{
+	mp_uint_t half = (MP_SMALL_INT_POSITIVE_MASK >> 1) + 1;
+	mp_uint_t diff = (mp_uint_t)mp_obj_get_int(new_in) - (mp_uint_t)mp_obj_get_int(old_in);
+	return MP_OBJ_NEW_SMALL_INT((mp_int_t)((diff + half) & MP_SMALL_INT_POSITIVE_MASK) - (mp_int_t)half);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(nsp_ticks_diff_obj, nsp_ticks_diff);
+
 static mp_obj_t nsp_waitKeypress()
 {
 	wait_key_pressed();
@@ -24,8 +73,18 @@ static MP_DEFINE_CONST_FUN_OBJ_0(nsp_waitKeypress_obj, nsp_waitKeypress);
 
 STATIC const mp_map_elem_t mp_module_nsp_globals_table[] = {
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_Texture), (mp_obj_t) &nsp_texture_type },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_Raster3D), (mp_obj_t) &nsp_raster3d_type },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_Font), (mp_obj_t) &nsp_font_type },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_EventLoop), (mp_obj_t) &nsp_eventloop_type },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_waitKeypress), (mp_obj_t) &nsp_waitKeypress_obj },
-	{ MP_OBJ_NEW_QSTR(MP_QSTR_readRTC), (mp_obj_t) &nsp_readRTC_obj }
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_readRTC), (mp_obj_t) &nsp_readRTC_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_ticks), (mp_obj_t) &nsp_ticks_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_ticks_diff), (mp_obj_t) &nsp_ticks_diff_obj },
+#ifndef NSP_HOST
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_profile), (mp_obj_t) &nsp_profile_module },
+#endif
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_hud), (mp_obj_t) &nsp_hud_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_plot), (mp_obj_t) &nsp_plot_obj }
 };
 
 STATIC const mp_obj_dict_t mp_module_nsp_globals = {
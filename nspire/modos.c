@@ -28,6 +28,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
 #include "mpconfig.h"
@@ -37,6 +40,8 @@
 #include "obj.h"
 #include "runtime.h"
 #include "objtuple.h"
+#include "lexer.h"
+#include "importcache.h"
 
 #define RAISE_ERRNO(err_flag, error_val) \
     { if (err_flag == -1) \
@@ -65,9 +70,206 @@ STATIC mp_obj_t mod_os_stat(mp_obj_t path_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_stat_obj, mod_os_stat);
 
+STATIC bool mod_os_is_dot_entry(const char *name) {
+    return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+}
+
+STATIC mp_obj_t mod_os_listdir(uint n_args, const mp_obj_t *args) {
+    const char *path = ".";
+    if (n_args > 0) {
+        path = mp_obj_str_get_str(args[0]);
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        RAISE_ERRNO(-1, errno);
+    }
+
+    // The allocations may raise, don't leak the directory handle then
+    mp_obj_t list;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        list = mp_obj_new_list(0, NULL);
+        struct dirent *de;
+        while ((de = readdir(dir)) != NULL) {
+            if (mod_os_is_dot_entry(de->d_name)) {
+                continue;
+            }
+            mp_obj_list_append(list, mp_obj_new_str(de->d_name, strlen(de->d_name), false));
+        }
+        nlr_pop();
+    } else {
+        closedir(dir);
+        nlr_raise(nlr.ret_val);
+    }
+    closedir(dir);
+
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_listdir_obj, 0, 1, mod_os_listdir);
+
+// Iterator returned by ilistdir(), yields (name, type, size) for each entry.
+// The type comes from the directory entry where the libc provides it, so only
+// regular files and entries of unknown type need a stat(), and no stat tuple
+// is built. If that stat() fails the entry is skipped when it was removed in
+// the meantime, otherwise it's yielded with size -1, and type 0 if unknown.
+// The directory stays open until it's exhausted or the iterator is collected.
+typedef struct _mp_obj_ilistdir_t {
+    mp_obj_base_t base;
+    DIR *dir;
+    uint path_len;
+    char path[MICROPY_ALLOC_PATH_MAX];
+} mp_obj_ilistdir_t;
+
+STATIC void ilistdir_close(mp_obj_ilistdir_t *self) {
+    if (self->dir != NULL) {
+        closedir(self->dir);
+        self->dir = NULL;
+    }
+}
+
+STATIC mp_obj_t ilistdir_iternext(mp_obj_t self_in) {
+    mp_obj_ilistdir_t *self = self_in;
+    if (self->dir == NULL) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+
+    for (;;) {
+        struct dirent *de = readdir(self->dir);
+        if (de == NULL) {
+            ilistdir_close(self);
+            return MP_OBJ_STOP_ITERATION;
+        }
+        if (mod_os_is_dot_entry(de->d_name)) {
+            continue;
+        }
+
+        uint name_len = strlen(de->d_name);
+        mp_int_t type = 0, size = -1;
+        #ifdef _DIRENT_HAVE_D_TYPE
+        if (de->d_type != DT_UNKNOWN && de->d_type != DT_LNK) {
+            type = DTTOIF(de->d_type);
+            // Only regular files still need a stat(), for their size
+            if (de->d_type != DT_REG) {
+                size = 0;
+            }
+        }
+        #endif
+
+        // Reuse the directory prefix kept in self->path, only the name changes
+        if (size < 0 && self->path_len + name_len < MICROPY_ALLOC_PATH_MAX) {
+            memcpy(self->path + self->path_len, de->d_name, name_len + 1);
+            struct stat sb;
+            if (stat(self->path, &sb) == 0) {
+                type = sb.st_mode & S_IFMT;
+                size = sb.st_size;
+            } else if (errno == ENOENT) {
+                // Removed since readdir() returned it
+                continue;
+            }
+        }
+
+        mp_obj_tuple_t *t = mp_obj_new_tuple(3, NULL);
+        t->items[0] = mp_obj_new_str(de->d_name, name_len, false);
+        t->items[1] = MP_OBJ_NEW_SMALL_INT(type);
+        t->items[2] = mp_obj_new_int(size);
+        return t;
+    }
+}
+
+STATIC mp_obj_t ilistdir_del(mp_obj_t self_in) {
+    ilistdir_close(self_in);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ilistdir_del_obj, ilistdir_del);
+
+STATIC const mp_map_elem_t ilistdir_locals_dict_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___del__), (mp_obj_t)&ilistdir_del_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(ilistdir_locals_dict, ilistdir_locals_dict_table);
+
+STATIC const mp_obj_type_t ilistdir_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_ilistdir,
+    .getiter = mp_identity,
+    .iternext = ilistdir_iternext,
+    .locals_dict = (mp_obj_t)&ilistdir_locals_dict,
+};
+
+STATIC mp_obj_t mod_os_ilistdir(uint n_args, const mp_obj_t *args) {
+    const char *path = ".";
+    uint len = 1;
+    if (n_args > 0) {
+        path = mp_obj_str_get_data(args[0], &len);
+    }
+    if (len + 2 > MICROPY_ALLOC_PATH_MAX) {
+        RAISE_ERRNO(-1, ENAMETOOLONG);
+    }
+
+    mp_obj_ilistdir_t *o = m_new_obj_with_finaliser(mp_obj_ilistdir_t);
+    o->base.type = &ilistdir_type;
+    o->dir = opendir(path);
+    if (o->dir == NULL) {
+        RAISE_ERRNO(-1, errno);
+    }
+
+    memcpy(o->path, path, len);
+    if (len == 0 || path[len - 1] != '/') {
+        o->path[len++] = '/';
+    }
+    o->path[len] = 0;
+    o->path_len = len;
+    return o;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_os_ilistdir_obj, 0, 1, mod_os_ilistdir);
+
+STATIC mp_obj_t mod_os_mkdir(mp_obj_t path_in) {
+    const char *path = mp_obj_str_get_str(path_in);
+
+    int r = mkdir(path, 0777);
+    int err = errno;
+    nsp_import_cache_invalidate();
+    RAISE_ERRNO(r, err);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_mkdir_obj, mod_os_mkdir);
+
+STATIC mp_obj_t mod_os_remove(mp_obj_t path_in) {
+    const char *path = mp_obj_str_get_str(path_in);
+
+    int r = unlink(path);
+    int err = errno;
+    nsp_import_cache_invalidate();
+    RAISE_ERRNO(r, err);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_os_remove_obj, mod_os_remove);
+
+STATIC mp_obj_t mod_os_rename(mp_obj_t old_in, mp_obj_t new_in) {
+    const char *old_path = mp_obj_str_get_str(old_in);
+    const char *new_path = mp_obj_str_get_str(new_in);
+
+    int r = rename(old_path, new_path);
+    int err = errno;
+    nsp_import_cache_invalidate();
+    RAISE_ERRNO(r, err);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_os_rename_obj, mod_os_rename);
+
 STATIC const mp_map_elem_t mp_module_os_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR__os) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_stat), (mp_obj_t)&mod_os_stat_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_listdir), (mp_obj_t)&mod_os_listdir_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ilistdir), (mp_obj_t)&mod_os_ilistdir_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scandir), (mp_obj_t)&mod_os_ilistdir_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_mkdir), (mp_obj_t)&mod_os_mkdir_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_remove), (mp_obj_t)&mod_os_remove_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_rename), (mp_obj_t)&mod_os_rename_obj },
 };
 
 STATIC const mp_obj_dict_t mp_module_os_globals = {
@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include <math.h>
+
+#include "mpconfig.h"
+#include "misc.h"
+#include "nlr.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "ndarray.h"
+
+/*
+ * Small example:
+ *
+ * import umath, ndarray
+ * xs = ndarray.linspace(0, 6.28, 320, ndarray.float32)
+ * ys = umath.sin(xs)
+ * umath.pow(ys, 2, out=ys)
+ *
+ * The functions work on whole buffers: ndarrays without gaps (copy() a strided
+ * view first) and array.array objects of type 'f', 'd' or 'h'. Every element is
+ * computed in one C loop; float32 data uses the single-precision routines.
+ * The second argument of atan2 and pow may also be a number.
+ *
+ * The result is written into out if given, which has to be a float32 or float64
+ * buffer of the same length. Otherwise a new ndarray with the shape of the
+ * input is returned, float64 if the input is float64 and float32 otherwise.
+ *
+ * Available functions:
+ * sin(x, out=None), cos(x, out=None), tan(x, out=None)
+ * exp(x, out=None), log(x, out=None), sqrt(x, out=None)
+ * atan2(y, x, out=None), pow(x, y, out=None)
+ */
+
+typedef struct _umath_operand_t {
+    mp_obj_t obj;
+    // NULL for a number
+    void *buf;
+    mp_uint_t len;
+    char typecode;
+    mp_float_t val;
+} umath_operand_t;
+
+STATIC void umath_get_operand(mp_obj_t obj, umath_operand_t *op) {
+    op->obj = obj;
+    if (MP_OBJ_IS_SMALL_INT(obj) || MP_OBJ_IS_TYPE(obj, &mp_type_float) || MP_OBJ_IS_TYPE(obj, &mp_type_int)) {
+        op->buf = NULL;
+        op->len = 1;
+        op->typecode = 'd';
+        op->val = mp_obj_get_float(obj);
+        return;
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(obj, &bufinfo, MP_BUFFER_RW);
+    switch (bufinfo.typecode) {
+        case 'f': op->len = bufinfo.len / sizeof(float); break;
+        case 'd': op->len = bufinfo.len / sizeof(double); break;
+        case 'h': op->len = bufinfo.len / sizeof(int16_t); break;
+        default:
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "buffer must be of type 'f', 'd' or 'h'"));
+    }
+    op->buf = bufinfo.buf;
+    op->typecode = bufinfo.typecode;
+}
+
+STATIC mp_float_t umath_load(const umath_operand_t *op, mp_uint_t i) {
+    switch (op->typecode) {
+        case 'f': return ((float*)op->buf)[i];
+        case 'h': return ((int16_t*)op->buf)[i];
+        default: return op->buf ? ((double*)op->buf)[i] : op->val;
+    }
+}
+
+STATIC void umath_store(umath_operand_t *op, mp_uint_t i, mp_float_t val) {
+    if (op->typecode == 'f') {
+        ((float*)op->buf)[i] = val;
+    } else {
+        ((double*)op->buf)[i] = val;
+    }
+}
+
+// Sets up the output buffer for an input like in
+STATIC void umath_get_out(mp_obj_t out_in, const umath_operand_t *in, umath_operand_t *out) {
+    if (out_in != mp_const_none) {
+        umath_get_operand(out_in, out);
+        if (out->buf == NULL || out->typecode == 'h') {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "out must be a float buffer"));
+        }
+        if (out->len != in->len) {
+            nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "out has the wrong length"));
+        }
+        return;
+    }
+
+    byte dtype = in->typecode == 'd' ? NDARRAY_FLOAT64 : NDARRAY_FLOAT32;
+    mp_obj_ndarray_t *o;
+    if (MP_OBJ_IS_TYPE(in->obj, &mp_type_ndarray)) {
+        mp_obj_ndarray_t *shape = in->obj;
+        o = ndarray_new(dtype, shape->ndim, shape->shape[0], shape->shape[1]);
+    } else {
+        o = ndarray_new(dtype, 1, 1, in->len);
+    }
+    umath_get_operand(o, out);
+}
+
+STATIC const mp_arg_t umath_unary_args[] = {
+    { MP_QSTR_x, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_out, MP_ARG_KW_ONLY | MP_ARG_OBJ, { .u_obj = mp_const_none } },
+};
+
+STATIC mp_obj_t umath_unary(uint n_args, const mp_obj_t *args, mp_map_t *kw_args, float (*fun_f)(float), double (*fun_d)(double)) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(umath_unary_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(umath_unary_args), umath_unary_args, vals);
+
+    umath_operand_t in, out;
+    umath_get_operand(vals[0].u_obj, &in);
+    if (in.buf == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "buffer expected"));
+    }
+    umath_get_out(vals[1].u_obj, &in, &out);
+
+    if (in.typecode == 'f' && out.typecode == 'f') {
+        const float *x = in.buf;
+        float *y = out.buf;
+        for (mp_uint_t i = 0; i < in.len; i++) {
+            y[i] = fun_f(x[i]);
+        }
+    } else if (out.typecode == 'f') {
+        for (mp_uint_t i = 0; i < in.len; i++) {
+            umath_store(&out, i, fun_f(umath_load(&in, i)));
+        }
+    } else {
+        for (mp_uint_t i = 0; i < in.len; i++) {
+            umath_store(&out, i, fun_d(umath_load(&in, i)));
+        }
+    }
+    return out.obj;
+}
+
+STATIC const mp_arg_t umath_binary_args[] = {
+    { MP_QSTR_x, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_y, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+    { MP_QSTR_out, MP_ARG_KW_ONLY | MP_ARG_OBJ, { .u_obj = mp_const_none } },
+};
+
+STATIC mp_obj_t umath_binary(uint n_args, const mp_obj_t *args, mp_map_t *kw_args, float (*fun_f)(float, float), double (*fun_d)(double, double)) {
+    mp_arg_val_t vals[MP_ARRAY_SIZE(umath_binary_args)];
+    mp_arg_parse_all(n_args, args, kw_args, MP_ARRAY_SIZE(umath_binary_args), umath_binary_args, vals);
+
+    umath_operand_t a, b, out;
+    umath_get_operand(vals[0].u_obj, &a);
+    umath_get_operand(vals[1].u_obj, &b);
+    if (a.buf == NULL) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "buffer expected"));
+    }
+    if (b.buf != NULL && b.len != a.len) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "buffers must have the same length"));
+    }
+    umath_get_out(vals[2].u_obj, &a, &out);
+
+    if (a.typecode == 'f' && out.typecode == 'f' && (b.buf == NULL || b.typecode == 'f')) {
+        const float *x = a.buf, *y = b.buf;
+        float *z = out.buf;
+        if (y == NULL) {
+            float val = b.val;
+            for (mp_uint_t i = 0; i < a.len; i++) {
+                z[i] = fun_f(x[i], val);
+            }
+        } else {
+            for (mp_uint_t i = 0; i < a.len; i++) {
+                z[i] = fun_f(x[i], y[i]);
+            }
+        }
+    } else if (out.typecode == 'f') {
+        for (mp_uint_t i = 0; i < a.len; i++) {
+            umath_store(&out, i, fun_f(umath_load(&a, i), umath_load(&b, i)));
+        }
+    } else {
+        for (mp_uint_t i = 0; i < a.len; i++) {
+            umath_store(&out, i, fun_d(umath_load(&a, i), umath_load(&b, i)));
+        }
+    }
+    return out.obj;
+}
+
+#define UMATH_FUN_1(py_name, c_name) \
+    STATIC mp_obj_t umath_ ## py_name(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) { \
+        return umath_unary(n_args, args, kw_args, c_name ## f, c_name); \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_KW(umath_ ## py_name ## _obj, 1, umath_ ## py_name);
+
+#define UMATH_FUN_2(py_name, c_name) \
+    STATIC mp_obj_t umath_ ## py_name(uint n_args, const mp_obj_t *args, mp_map_t *kw_args) { \
+        return umath_binary(n_args, args, kw_args, c_name ## f, c_name); \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_KW(umath_ ## py_name ## _obj, 2, umath_ ## py_name);
+
+UMATH_FUN_1(sin, sin)
+UMATH_FUN_1(cos, cos)
+UMATH_FUN_1(tan, tan)
+UMATH_FUN_1(exp, exp)
+UMATH_FUN_1(log, log)
+UMATH_FUN_1(sqrt, sqrt)
+UMATH_FUN_2(atan2, atan2)
+UMATH_FUN_2(pow, pow)
+
+STATIC const mp_map_elem_t mp_module_umath_globals_table[] = {
+    { MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_umath) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sin), (mp_obj_t)&umath_sin_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_cos), (mp_obj_t)&umath_cos_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_tan), (mp_obj_t)&umath_tan_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_exp), (mp_obj_t)&umath_exp_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_log), (mp_obj_t)&umath_log_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sqrt), (mp_obj_t)&umath_sqrt_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_atan2), (mp_obj_t)&umath_atan2_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_pow), (mp_obj_t)&umath_pow_obj },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_umath_globals, mp_module_umath_globals_table);
+
+const mp_obj_module_t mp_module_umath = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_umath,
+    .globals = (mp_obj_dict_t*)&mp_module_umath_globals,
+};
@@ -35,7 +35,10 @@
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_HELPER_LEXER_UNIX   (1)
 #define MICROPY_ENABLE_SOURCE_LINE  (1)
+// Set to MICROPY_FLOAT_IMPL_FLOAT by the single-precision build (make float)
+#ifndef MICROPY_FLOAT_IMPL
 #define MICROPY_FLOAT_IMPL          (MICROPY_FLOAT_IMPL_DOUBLE)
+#endif
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_STREAMS_NON_BLOCK   (1)
 #define MICROPY_OPT_COMPUTED_GOTO   (1)
@@ -67,10 +70,18 @@
 
 extern const struct _mp_obj_module_t mp_module_os;
 extern const struct _mp_obj_module_t mp_module_nsp;
+extern const struct _mp_obj_module_t mp_module_ndarray;
+extern const struct _mp_obj_module_t mp_module_umath;
+extern const struct _mp_obj_module_t mp_module_fixed;
+extern const struct _mp_obj_module_t mp_module_kvstore;
 
 #define MICROPY_PORT_BUILTIN_MODULES \
 	{ MP_OBJ_NEW_QSTR(MP_QSTR__os), (mp_obj_t) &mp_module_os }, \
-	{ MP_OBJ_NEW_QSTR(MP_QSTR_nsp), (mp_obj_t) &mp_module_nsp }
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_nsp), (mp_obj_t) &mp_module_nsp }, \
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_ndarray), (mp_obj_t) &mp_module_ndarray }, \
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_umath), (mp_obj_t) &mp_module_umath }, \
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_fixed), (mp_obj_t) &mp_module_fixed }, \
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_kvstore), (mp_obj_t) &mp_module_kvstore }
 
 typedef int mp_int_t;
 typedef unsigned int mp_uint_t;
@@ -11,3 +11,7 @@ MICROPY_PY_TIME = 0
 
 # ffi module requires libffi (libffi-dev Debian package)
 MICROPY_PY_FFI = 0
+
+# Float implementation: double (default, exact like CPython) or float
+# (single precision, faster on the FPU-less ARM926, see "make float")
+MICROPY_FLOAT = double
@@ -0,0 +1,25 @@
+#define NDARRAY_INT16 ('h')
+#define NDARRAY_FLOAT32 ('f')
+#define NDARRAY_FLOAT64 ('d')
+
+// Vectors (ndim == 1) are stored as a single row with a row stride of 0.
+// Strides are in elements and may be negative.
+typedef struct _mp_obj_ndarray_t {
+    mp_obj_base_t base;
+    byte dtype;
+    byte ndim;
+    mp_uint_t shape[2];
+    mp_int_t strides[2];
+    // Start of the allocation, shared between views
+    void *storage;
+    // First element
+    void *data;
+} mp_obj_ndarray_t;
+
+extern const mp_obj_type_t mp_type_ndarray;
+extern const mp_obj_module_t mp_module_ndarray;
+
+mp_obj_ndarray_t *ndarray_new(byte dtype, byte ndim, mp_uint_t rows, mp_uint_t cols);
+mp_obj_ndarray_t *ndarray_get_array(mp_obj_t obj);
+mp_float_t ndarray_get(const mp_obj_ndarray_t *self, mp_uint_t row, mp_uint_t col);
+void ndarray_set(mp_obj_ndarray_t *self, mp_uint_t row, mp_uint_t col, mp_float_t val);
@@ -0,0 +1,382 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "texture.h"
+#include "plot.h"
+
+/*
+ * Function plotter.
+ *
+ * Small example:
+ *
+ * import nsp, ndarray, umath
+ * xs = ndarray.linspace(-3.14, 3.14, 320, ndarray.float32)
+ * t = nsp.Texture(320, 240, None)
+ * t.fill(0xFFFF)
+ * nsp.plot(t, umath.sin(xs), -3.14, 3.14, -1.5, 1.5, 0x001F, axes=0x0000, grid=0xC618)
+ * t.display()
+ *
+ * plot(tex, ys, x0, x1, y0, y1, color, axes=-1, grid=-1, aa=False):
+ * Draws the samples in ys as a connected curve onto the whole texture.
+ * The samples are evenly spaced from x0 (left border) to x1 (right border), y0 is at
+ * the bottom border and y1 at the top. ys can be a float32, float64 or int16 buffer
+ * (ndarray or array.array) or a list or tuple of numbers.
+ * Segments are clipped to the texture, samples which are NaN or infinite leave a gap.
+ * If aa is True, the segments are drawn anti-aliased by blending with the texture.
+ * If axes is a color, the axes through 0 are drawn with tick marks at the grid steps.
+ * If grid is a color, grid lines are drawn at steps of 1, 2 or 5 times a power of ten.
+ */
+
+#define PLOT_MAX_LINES 32
+// Samples far off the texture are moved closer, so the clipping stays exact enough
+#define PLOT_FAR 1e6f
+
+typedef struct plot_samples_t
+{
+	const void *buf; // NULL for a list or tuple
+	mp_obj_t *items;
+	mp_uint_t len;
+	char typecode;
+} plot_samples_t;
+
+static void plot_get_samples(mp_obj_t obj, plot_samples_t *s)
+{
+	mp_buffer_info_t bufinfo;
+	if(!mp_get_buffer(obj, &bufinfo, MP_BUFFER_READ))
+	{
+		s->buf = NULL;
+		mp_obj_get_array(obj, &s->len, &s->items);
+		return;
+	}
+
+	switch(bufinfo.typecode)
+	{
+		case 'f': s->len = bufinfo.len / sizeof(float); break;
+		case 'd': s->len = bufinfo.len / sizeof(double); break;
+		case 'h': s->len = bufinfo.len / sizeof(int16_t); break;
+		default:
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "buffer must be of type 'f', 'd' or 'h'"));
+	}
+	s->buf = bufinfo.buf;
+	s->typecode = bufinfo.typecode;
+}
+
+static inline float plot_sample(const plot_samples_t *s, mp_uint_t i)
+{
+	if(!s->buf)
+		return mp_obj_get_float(s->items[i]);
+
+	switch(s->typecode)
+	{
+		case 'f': return ((const float*)s->buf)[i];
+		case 'h': return ((const int16_t*)s->buf)[i];
+		default: return ((const double*)s->buf)[i];
+	}
+}
+
+// Mixes fg into bg with alpha out of 256, per RGB565 channel
+static inline uint16_t plot_blend(uint16_t bg, uint16_t fg, unsigned int alpha)
+{
+	const unsigned int inv = 256 - alpha;
+	unsigned int r = ((fg >> 11) * alpha + (bg >> 11) * inv) >> 8;
+	unsigned int g = (((fg >> 5) & 0x3F) * alpha + ((bg >> 5) & 0x3F) * inv) >> 8;
+	unsigned int b = ((fg & 0x1F) * alpha + (bg & 0x1F) * inv) >> 8;
+	return (r << 11) | (g << 5) | b;
+}
+
+static inline void plot_blend_px(nsp_texture_obj_t *tex, int x, int y, uint16_t color, unsigned int alpha)
+{
+	if((unsigned int)x >= tex->width || (unsigned int)y >= tex->height || alpha == 0)
+		return;
+
+	uint16_t *px = tex->bitmap + x + y * tex->width;
+	*px = alpha >= 256 ? color : plot_blend(*px, color, alpha);
+}
+
+static void plot_hline(nsp_texture_obj_t *tex, int x0, int x1, int y, uint16_t color)
+{
+	if((unsigned int)y >= tex->height)
+		return;
+
+	if(x0 < 0)
+		x0 = 0;
+	if(x1 >= tex->width)
+		x1 = tex->width - 1;
+
+	uint16_t *px = tex->bitmap + y * tex->width;
+	for(int x = x0; x <= x1; ++x)
+		px[x] = color;
+}
+
+static void plot_vline(nsp_texture_obj_t *tex, int x, int y0, int y1, uint16_t color)
+{
+	if((unsigned int)x >= tex->width)
+		return;
+
+	if(y0 < 0)
+		y0 = 0;
+	if(y1 >= tex->height)
+		y1 = tex->height - 1;
+
+	uint16_t *px = tex->bitmap + x + y0 * tex->width;
+	for(int y = y0; y <= y1; ++y, px += tex->width)
+		*px = color;
+}
+
+// Liang-Barsky clipping of a segment against [0, xmax] x [0, ymax].
+// Returns false if nothing of it is visible.
+static bool plot_clip(float *x0, float *y0, float *x1, float *y1, float xmax, float ymax)
+{
+	const float dx = *x1 - *x0, dy = *y1 - *y0;
+	const float p[4] = { -dx, dx, -dy, dy };
+	const float q[4] = { *x0, xmax - *x0, *y0, ymax - *y0 };
+	float t0 = 0, t1 = 1;
+
+	for(int i = 0; i < 4; ++i)
+	{
+		if(p[i] == 0)
+		{
+			if(q[i] < 0)
+				return false;
+			continue;
+		}
+
+		const float t = q[i] / p[i];
+		if(p[i] < 0)
+		{
+			if(t > t1)
+				return false;
+			if(t > t0)
+				t0 = t;
+		}
+		else
+		{
+			if(t < t0)
+				return false;
+			if(t < t1)
+				t1 = t;
+		}
+	}
+
+	*x1 = *x0 + t1 * dx;
+	*y1 = *y0 + t1 * dy;
+	*x0 += t0 * dx;
+	*y0 += t0 * dy;
+	return true;
+}
+
+// Bresenham, the endpoints have to be inside the texture
+static void plot_line(nsp_texture_obj_t *tex, int x0, int y0, int x1, int y1, uint16_t color)
+{
+	const int dx = x1 > x0 ? x1 - x0 : x0 - x1, sx = x1 > x0 ? 1 : -1;
+	const int dy = y1 > y0 ? y0 - y1 : y1 - y0, sy = y1 > y0 ? tex->width : -tex->width;
+	const int stepy = y1 > y0 ? 1 : -1;
+	uint16_t *px = tex->bitmap + x0 + y0 * tex->width;
+	int err = dx + dy;
+
+	for(;;)
+	{
+		*px = color;
+		if(x0 == x1 && y0 == y1)
+			break;
+
+		const int e2 = 2 * err;
+		if(e2 >= dy)
+		{
+			err += dy;
+			x0 += sx;
+			px += sx;
+		}
+		if(e2 <= dx)
+		{
+			err += dx;
+			y0 += stepy;
+			px += sy;
+		}
+	}
+}
+
+// Xiaolin Wu's line in 16.16 fixed point: two pixels per step along the major axis,
+// weighted by the distance to the ideal line.
+static void plot_line_aa(nsp_texture_obj_t *tex, float fx0, float fy0, float fx1, float fy1, uint16_t color)
+{
+	int32_t x0 = fx0 * 65536, y0 = fy0 * 65536, x1 = fx1 * 65536, y1 = fy1 * 65536;
+	const bool steep = (y1 > y0 ? y1 - y0 : y0 - y1) > (x1 > x0 ? x1 - x0 : x0 - x1);
+	int32_t tmp;
+
+	if(steep)
+	{
+		tmp = x0; x0 = y0; y0 = tmp;
+		tmp = x1; x1 = y1; y1 = tmp;
+	}
+	if(x0 > x1)
+	{
+		tmp = x0; x0 = x1; x1 = tmp;
+		tmp = y0; y0 = y1; y1 = tmp;
+	}
+
+	const int32_t dx = x1 - x0;
+	const int32_t gradient = dx ? ((int64_t)(y1 - y0) << 16) / dx : 0;
+	const int xs = (x0 + 0x8000) >> 16, xe = (x1 + 0x8000) >> 16;
+	int32_t y = y0 + (int32_t)(((int64_t)gradient * ((xs << 16) - x0)) >> 16);
+
+	for(int x = xs; x <= xe; ++x, y += gradient)
+	{
+		const int yi = y >> 16;
+		const unsigned int frac = (y >> 8) & 0xFF;
+		if(steep)
+		{
+			plot_blend_px(tex, yi, x, color, 256 - frac);
+			plot_blend_px(tex, yi + 1, x, color, frac);
+		}
+		else
+		{
+			plot_blend_px(tex, x, yi, color, 256 - frac);
+			plot_blend_px(tex, x, yi + 1, color, frac);
+		}
+	}
+}
+
+// Grid step for about eight lines over range: 1, 2 or 5 times a power of ten
+static float plot_step(float range)
+{
+	const float raw = range / 8;
+	float mag = 1;
+	while(mag > raw)
+		mag /= 10;
+	while(mag * 10 <= raw)
+		mag *= 10;
+
+	const float norm = raw / mag;
+	if(norm < 1.5f)
+		return mag;
+	if(norm < 3.5f)
+		return 2 * mag;
+	if(norm < 7.5f)
+		return 5 * mag;
+	return 10 * mag;
+}
+
+static const mp_arg_t nsp_plot_args[] = {
+	{ MP_QSTR_tex, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_ys, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_x0, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_x1, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_y0, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_y1, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_color, MP_ARG_REQUIRED | MP_ARG_INT, {} },
+	{ MP_QSTR_axes, MP_ARG_KW_ONLY | MP_ARG_INT, { .u_int = -1 } },
+	{ MP_QSTR_grid, MP_ARG_KW_ONLY | MP_ARG_INT, { .u_int = -1 } },
+	{ MP_QSTR_aa, MP_ARG_KW_ONLY | MP_ARG_BOOL, { .u_bool = false } },
+};
+
+static mp_obj_t nsp_plot(uint n_args, const mp_obj_t *args, mp_map_t *kw_args)
+{
+	mp_arg_val_t args_val[sizeof(nsp_plot_args)/sizeof(*nsp_plot_args)];
+	mp_arg_parse_all(n_args, args, kw_args, sizeof(nsp_plot_args)/sizeof(*nsp_plot_args), nsp_plot_args, args_val);
+
+	if(mp_obj_get_type(args_val[0].u_obj) != &nsp_texture_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	nsp_texture_obj_t *tex = args_val[0].u_obj;
+	plot_samples_t samples;
+	plot_get_samples(args_val[1].u_obj, &samples);
+	const float x0 = mp_obj_get_float(args_val[2].u_obj), x1 = mp_obj_get_float(args_val[3].u_obj);
+	const float y0 = mp_obj_get_float(args_val[4].u_obj), y1 = mp_obj_get_float(args_val[5].u_obj);
+	const uint16_t color = args_val[6].u_int;
+	const mp_int_t axes = args_val[7].u_int, grid = args_val[8].u_int;
+	const bool aa = args_val[9].u_bool;
+
+	if(!(x1 != x0 && y1 != y0 && isfinite(x1 - x0) && isfinite(y1 - y0)))
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Empty plot range."));
+
+	if(tex->width == 0 || tex->height == 0)
+		return mp_const_none;
+
+	const float xmax = tex->width - 1, ymax = tex->height - 1;
+	const float xscale = xmax / (x1 - x0), yscale = ymax / (y1 - y0);
+
+	if(grid != -1 || axes != -1)
+	{
+		const float xstep = plot_step(fabsf(x1 - x0)), ystep = plot_step(fabsf(y1 - y0));
+		const float xlo = x0 < x1 ? x0 : x1, xhi = x0 < x1 ? x1 : x0;
+		const float ylo = y0 < y1 ? y0 : y1, yhi = y0 < y1 ? y1 : y0;
+		const int ax = (0 - x0) * xscale + 0.5f, ay = (y1 - 0) * yscale + 0.5f;
+		const bool has_ax = xlo <= 0 && 0 <= xhi, has_ay = ylo <= 0 && 0 <= yhi;
+
+		// Counted, as adding a tiny step to a big float might not change it
+		const float gx0 = ceilf(xlo / xstep), gy0 = ceilf(ylo / ystep);
+		for(int i = 0; i < PLOT_MAX_LINES && (gx0 + i) * xstep <= xhi; ++i)
+		{
+			const float gx = (gx0 + i) * xstep;
+			const int px = (gx - x0) * xscale + 0.5f;
+			if(grid != -1)
+				plot_vline(tex, px, 0, tex->height - 1, grid);
+			if(axes != -1 && has_ay)
+				plot_vline(tex, px, ay - 2, ay + 2, axes);
+		}
+
+		for(int i = 0; i < PLOT_MAX_LINES && (gy0 + i) * ystep <= yhi; ++i)
+		{
+			const float gy = (gy0 + i) * ystep;
+			const int py = (y1 - gy) * yscale + 0.5f;
+			if(grid != -1)
+				plot_hline(tex, 0, tex->width - 1, py, grid);
+			if(axes != -1 && has_ax)
+				plot_hline(tex, ax - 2, ax + 2, py, axes);
+		}
+
+		if(axes != -1)
+		{
+			if(has_ax)
+				plot_vline(tex, ax, 0, tex->height - 1, axes);
+			if(has_ay)
+				plot_hline(tex, 0, tex->width - 1, ay, axes);
+		}
+	}
+
+	const float dx = samples.len > 1 ? xmax / (samples.len - 1) : 0;
+	float last_x = 0, last_y = 0;
+	bool have_last = false;
+
+	for(mp_uint_t i = 0; i < samples.len; ++i)
+	{
+		const float v = plot_sample(&samples, i);
+		if(!isfinite(v))
+		{
+			have_last = false;
+			continue;
+		}
+
+		const float sx = i * dx;
+		float sy = (y1 - v) * yscale;
+		if(!(sy > -PLOT_FAR))
+			sy = -PLOT_FAR;
+		else if(sy > PLOT_FAR)
+			sy = PLOT_FAR;
+		float cx0 = have_last ? last_x : sx, cy0 = have_last ? last_y : sy, cx1 = sx, cy1 = sy;
+		last_x = sx;
+		last_y = sy;
+
+		// A lone sample is drawn as a point, otherwise the segment from the previous one
+		if((have_last || samples.len == 1) && plot_clip(&cx0, &cy0, &cx1, &cy1, xmax, ymax))
+		{
+			if(aa)
+				plot_line_aa(tex, cx0, cy0, cx1, cy1, color);
+			else
+				plot_line(tex, cx0 + 0.5f, cy0 + 0.5f, cx1 + 0.5f, cy1 + 0.5f, color);
+		}
+
+		have_last = true;
+	}
+
+	return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(nsp_plot_obj, 7, nsp_plot);
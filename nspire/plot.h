@@ -0,0 +1 @@
+extern const mp_obj_fun_builtin_t nsp_plot_obj;
@@ -0,0 +1,491 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "profile.h"
+
+#include <libndls.h>
+
+/*
+ * Sampling profiler, driven by a hardware timer interrupt.
+ *
+ * Small example:
+ *
+ * from nsp import profile
+ *
+ * @profile.track
+ * def update(world): ...
+ *
+ * profile.start(1000)
+ * main_loop()
+ * profile.stop()
+ * profile.report("/documents/profile.txt.tns")
+ * profile.collapsed("/documents/profile.folded.tns")
+ *
+ * The VM doesn't expose the currently executing frame, so samples are attributed
+ * to the innermost tracked function or region instead. Every distinct chain of
+ * tracked functions/regions gets a node in a fixed-size calling-context tree and
+ * the timer interrupt only increments the sample counter of the current node.
+ * Samples taken outside of any tracked function are counted for the root.
+ *
+ * Available functions:
+ * start(hz = 1000): Starts sampling at hz samples per second. Only available on CX models.
+ * stop(): Stops sampling. Collected samples are kept.
+ * reset(): Discards all collected samples and tracked call chains.
+ * track(func, name = func.__name__): Returns a wrapper around func which is tracked as region name.
+ *                                    The wrapper isn't a function, so it doesn't bind to instances:
+ *                                    as decorator it only works on plain functions. To track a method,
+ *                                    wrap the bound method (self.update = profile.track(self.update))
+ *                                    or use enter()/leave() inside it.
+ * enter(name): Starts a region, must be followed by a matching leave().
+ * leave(): Ends the innermost region.
+ * report(path = None): Writes a flat (self) and cumulative report, to path or the console.
+ * collapsed(path): Writes the samples in collapsed-stack format, as used by flamegraph.pl.
+ */
+
+#define PROFILE_MAX_NODES 256
+#define PROFILE_MAX_DEPTH 32
+
+// CX: second half of the second timer (SP804), runs at 32768 Hz
+#define TIMER_BASE 0x900D0020
+#define TIMER_LOAD (*(volatile uint32_t*)(TIMER_BASE + 0x00))
+#define TIMER_CONTROL (*(volatile uint32_t*)(TIMER_BASE + 0x08))
+#define TIMER_INTCLR (*(volatile uint32_t*)(TIMER_BASE + 0x0C))
+#define TIMER_MIS (*(volatile uint32_t*)(TIMER_BASE + 0x14))
+#define TIMER_BGLOAD (*(volatile uint32_t*)(TIMER_BASE + 0x18))
+#define TIMER_CLOCK 32768
+#define TIMER_IRQ 18
+
+// CX: interrupt controller (PL190)
+#define VIC_IRQ_STATUS (*(volatile uint32_t*)0xDC000000)
+#define VIC_INT_SELECT (*(volatile uint32_t*)0xDC00000C)
+#define VIC_INT_ENABLE (*(volatile uint32_t*)0xDC000010)
+#define VIC_INT_ENCLEAR (*(volatile uint32_t*)0xDC000014)
+
+// Address of the IRQ handler, loaded by the "ldr pc, [pc, #0x18]" at the IRQ vector
+#define IRQ_HANDLER_PTR (*(volatile uint32_t*)0x38)
+
+typedef struct {
+	qstr name;
+	uint16_t parent;
+	uint32_t samples;
+} profile_node_t;
+
+static profile_node_t nodes[PROFILE_MAX_NODES];
+static unsigned int num_nodes = 1;
+static volatile uint16_t current_node;
+// Regions entered while the tree or depth was exhausted, they are attributed to their parent
+static unsigned int overflow_depth;
+static volatile uint32_t total_samples;
+
+static bool running;
+static unsigned int sample_hz;
+static uint32_t old_irq_handler;
+static uint32_t old_timer_control, old_timer_load;
+
+static inline uint32_t irq_disable()
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr\n"
+	             "orr r0, %0, #0x80\n"
+	             "msr cpsr_c, r0" : "=r" (cpsr) : : "r0");
+	return cpsr;
+}
+
+static inline void irq_restore(uint32_t cpsr)
+{
+	asm volatile("msr cpsr_c, %0" : : "r" (cpsr));
+}
+
+/* Called in IRQ mode. Returns the address of the handler to chain to, or 0 if the
+ * interrupt was ours alone and can be returned from directly. */
+__attribute__((used)) uint32_t nsp_profile_irq()
+{
+	if(!(TIMER_MIS & 1))
+		return old_irq_handler;
+
+	TIMER_INTCLR = 1;
+	nodes[current_node].samples++;
+	total_samples++;
+
+	return (VIC_IRQ_STATUS & ~(1 << TIMER_IRQ)) ? old_irq_handler : 0;
+}
+
+static void __attribute__((naked)) profile_irq_handler()
+{
+	asm volatile(
+		"sub sp, sp, #8\n"              // Slot for the chained handler, keeps 8-byte alignment
+		"stmfd sp!, {r0-r3, r12, lr}\n"
+		"bl nsp_profile_irq\n"
+		"str r0, [sp, #28]\n"
+		"cmp r0, #0\n"
+		"ldmfd sp!, {r0-r3, r12, lr}\n"
+		"add sp, sp, #4\n"
+		"ldrne pc, [sp], #4\n"          // Not only ours: let the OS handle the rest
+		"add sp, sp, #4\n"
+		"subs pc, lr, #4\n"
+	);
+}
+
+static void profile_stop()
+{
+	if(!running)
+		return;
+
+	uint32_t cpsr = irq_disable();
+	VIC_INT_ENCLEAR = 1 << TIMER_IRQ;
+	TIMER_CONTROL = 0;
+	TIMER_INTCLR = 1;
+	TIMER_LOAD = old_timer_load;
+	TIMER_CONTROL = old_timer_control;
+	IRQ_HANDLER_PTR = old_irq_handler;
+	irq_restore(cpsr);
+
+	running = false;
+}
+
+void nsp_profile_deinit()
+{
+	profile_stop();
+}
+
+static void profile_enter(qstr name)
+{
+	if(overflow_depth)
+	{
+		overflow_depth++;
+		return;
+	}
+
+	unsigned int parent = current_node, depth = 0;
+	for(unsigned int n = parent; n; n = nodes[n].parent)
+		depth++;
+
+	for(unsigned int i = 1; i < num_nodes; i++)
+	{
+		if(nodes[i].parent == parent && nodes[i].name == name)
+		{
+			current_node = i;
+			return;
+		}
+	}
+
+	if(num_nodes == PROFILE_MAX_NODES || depth == PROFILE_MAX_DEPTH)
+	{
+		overflow_depth = 1;
+		return;
+	}
+
+	nodes[num_nodes].name = name;
+	nodes[num_nodes].parent = parent;
+	nodes[num_nodes].samples = 0;
+	current_node = num_nodes++;
+}
+
+static void profile_leave()
+{
+	if(overflow_depth)
+		overflow_depth--;
+	else if(current_node)
+		current_node = nodes[current_node].parent;
+}
+
+static mp_obj_t nsp_profile_start(uint n_args, const mp_obj_t *args)
+{
+	if(!has_colors)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "The profiler requires a CX!"));
+
+	int hz = n_args > 0 ? mp_obj_get_int(args[0]) : 1000;
+	if(hz < 1 || hz > TIMER_CLOCK / 8)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Sampling rate out of range!"));
+
+	profile_stop();
+	sample_hz = hz;
+
+	uint32_t cpsr = irq_disable();
+	old_timer_control = TIMER_CONTROL;
+	old_timer_load = TIMER_LOAD;
+	TIMER_CONTROL = 0;
+	TIMER_LOAD = TIMER_CLOCK / hz;
+	TIMER_BGLOAD = TIMER_CLOCK / hz;
+	TIMER_INTCLR = 1;
+	TIMER_CONTROL = 0xE2; // Enabled, periodic, interrupt enabled, 32-bit
+
+	old_irq_handler = IRQ_HANDLER_PTR;
+	IRQ_HANDLER_PTR = (uint32_t) profile_irq_handler;
+	VIC_INT_SELECT &= ~(1 << TIMER_IRQ);
+	VIC_INT_ENABLE = 1 << TIMER_IRQ;
+	irq_restore(cpsr);
+
+	running = true;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_profile_start_obj, 0, 1, nsp_profile_start);
+
+static mp_obj_t nsp_profile_stop()
+{
+	profile_stop();
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(nsp_profile_stop_obj, nsp_profile_stop);
+
+static mp_obj_t nsp_profile_reset()
+{
+	uint32_t cpsr = irq_disable();
+	num_nodes = 1;
+	current_node = 0;
+	overflow_depth = 0;
+	nodes[0].samples = 0;
+	total_samples = 0;
+	irq_restore(cpsr);
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(nsp_profile_reset_obj, nsp_profile_reset);
+
+static mp_obj_t nsp_profile_enter(mp_obj_t name)
+{
+	profile_enter(mp_obj_str_get_qstr(name));
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_profile_enter_obj, nsp_profile_enter);
+
+static mp_obj_t nsp_profile_leave()
+{
+	profile_leave();
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(nsp_profile_leave_obj, nsp_profile_leave);
+
+/* Tracked function wrapper. The call is passed on unchanged, there's no descriptor
+ * protocol for native types, so a wrapped method would be called without self. */
+
+typedef struct nsp_profile_tracked_obj_t {
+	mp_obj_base_t base;
+	mp_obj_t fun;
+	qstr name;
+} nsp_profile_tracked_obj_t;
+
+static mp_obj_t nsp_profile_tracked_call(mp_obj_t self_in, uint n_args, uint n_kw, const mp_obj_t *args)
+{
+	nsp_profile_tracked_obj_t *self = self_in;
+
+	profile_enter(self->name);
+
+	nlr_buf_t nlr;
+	if(nlr_push(&nlr) == 0)
+	{
+		mp_obj_t res = mp_call_function_n_kw(self->fun, n_args, n_kw, args);
+		nlr_pop();
+		profile_leave();
+		return res;
+	}
+	else
+	{
+		profile_leave();
+		nlr_raise(nlr.ret_val);
+	}
+}
+
+static void nsp_profile_tracked_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind)
+{
+	nsp_profile_tracked_obj_t *self = self_in;
+	print(env, "<tracked %s>", qstr_str(self->name));
+}
+
+static const mp_obj_type_t nsp_profile_tracked_type = {
+	{ &mp_type_type },
+	.name = MP_QSTR_track,
+	.print = nsp_profile_tracked_print,
+	.call = nsp_profile_tracked_call,
+};
+
+static mp_obj_t nsp_profile_track(uint n_args, const mp_obj_t *args)
+{
+	nsp_profile_tracked_obj_t *o = m_new_obj(nsp_profile_tracked_obj_t);
+	o->base.type = &nsp_profile_tracked_type;
+	o->fun = args[0];
+
+	if(n_args > 1)
+		o->name = mp_obj_str_get_qstr(args[1]);
+	else
+	{
+		mp_obj_t dest[2];
+		mp_load_method_maybe(args[0], MP_QSTR___name__, dest);
+		o->name = dest[0] != MP_OBJ_NULL ? mp_obj_str_get_qstr(dest[0]) : MP_QSTR_func;
+	}
+
+	return o;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_profile_track_obj, 1, 2, nsp_profile_track);
+
+/* Reports */
+
+static FILE *profile_open(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if(!f)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "Could not open output file!"));
+
+	return f;
+}
+
+static bool node_has_ancestor_named(unsigned int n, qstr name)
+{
+	for(; n; n = nodes[n].parent)
+		if(nodes[n].name == name)
+			return true;
+
+	return false;
+}
+
+static mp_obj_t nsp_profile_report(uint n_args, const mp_obj_t *args)
+{
+	FILE *f = stdout;
+	if(n_args > 0 && args[0] != mp_const_none)
+		f = profile_open(mp_obj_str_get_str(args[0]));
+
+	// The tree can't change while we're running in the interpreter, only the counters
+	unsigned int count = num_nodes;
+	uint32_t total = total_samples;
+
+	// Aggregate by name: self samples and samples with the name anywhere in the chain
+	qstr names[PROFILE_MAX_NODES];
+	uint32_t self[PROFILE_MAX_NODES], cum[PROFILE_MAX_NODES];
+	unsigned int num_names = 0;
+
+	for(unsigned int i = 1; i < count; i++)
+	{
+		unsigned int j;
+		for(j = 0; j < num_names; j++)
+			if(names[j] == nodes[i].name)
+				break;
+
+		if(j == num_names)
+		{
+			names[num_names] = nodes[i].name;
+			self[num_names] = cum[num_names] = 0;
+			num_names++;
+		}
+
+		self[j] += nodes[i].samples;
+	}
+
+	for(unsigned int i = 1; i < count; i++)
+	{
+		if(!nodes[i].samples)
+			continue;
+
+		// Count every sample once per name, even for recursive chains
+		for(unsigned int n = i; n; n = nodes[n].parent)
+		{
+			if(node_has_ancestor_named(nodes[n].parent, nodes[n].name))
+				continue;
+
+			for(unsigned int j = 0; j < num_names; j++)
+				if(names[j] == nodes[n].name)
+					cum[j] += nodes[i].samples;
+		}
+	}
+
+	fprintf(f, "%lu samples at %u Hz, %lu untracked\n", (unsigned long) total, sample_hz, (unsigned long) nodes[0].samples);
+	fprintf(f, "  self%%   cum%%     self      cum  name\n");
+
+	// Sort by self samples, then cumulative
+	bool printed[PROFILE_MAX_NODES] = {};
+	for(unsigned int k = 0; k < num_names; k++)
+	{
+		int best = -1;
+		for(unsigned int j = 0; j < num_names; j++)
+		{
+			if(printed[j])
+				continue;
+
+			if(best < 0 || self[j] > self[best] || (self[j] == self[best] && cum[j] > cum[best]))
+				best = j;
+		}
+
+		printed[best] = true;
+		fprintf(f, "%6.1f %6.1f %8lu %8lu  %s\n",
+		        total ? 100.0 * self[best] / total : 0.0, total ? 100.0 * cum[best] / total : 0.0,
+		        (unsigned long) self[best], (unsigned long) cum[best], qstr_str(names[best]));
+	}
+
+	if(overflow_depth || count == PROFILE_MAX_NODES)
+		fprintf(f, "Call tree full, deeper calls were attributed to their callers.\n");
+
+	if(f != stdout)
+		fclose(f);
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_profile_report_obj, 0, 1, nsp_profile_report);
+
+static void profile_write_chain(FILE *f, unsigned int n)
+{
+	if(nodes[n].parent)
+	{
+		profile_write_chain(f, nodes[n].parent);
+		fputc(';', f);
+	}
+
+	fputs(qstr_str(nodes[n].name), f);
+}
+
+static mp_obj_t nsp_profile_collapsed(mp_obj_t path)
+{
+	FILE *f = profile_open(mp_obj_str_get_str(path));
+
+	if(nodes[0].samples)
+		fprintf(f, "<untracked> %lu\n", (unsigned long) nodes[0].samples);
+
+	for(unsigned int i = 1; i < num_nodes; i++)
+	{
+		if(!nodes[i].samples)
+			continue;
+
+		profile_write_chain(f, i);
+		fprintf(f, " %lu\n", (unsigned long) nodes[i].samples);
+	}
+
+	fclose(f);
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_profile_collapsed_obj, nsp_profile_collapsed);
+
+STATIC const mp_map_elem_t nsp_profile_globals_table[] = {
+	{ MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR_profile) },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_start), (mp_obj_t) &nsp_profile_start_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_stop), (mp_obj_t) &nsp_profile_stop_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_reset), (mp_obj_t) &nsp_profile_reset_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_track), (mp_obj_t) &nsp_profile_track_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_enter), (mp_obj_t) &nsp_profile_enter_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_leave), (mp_obj_t) &nsp_profile_leave_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_report), (mp_obj_t) &nsp_profile_report_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_collapsed), (mp_obj_t) &nsp_profile_collapsed_obj },
+};
+
+STATIC const mp_obj_dict_t nsp_profile_globals = {
+    .base = {&mp_type_dict},
+    .map = {
+        .all_keys_are_qstrs = 1,
+        .table_is_fixed_array = 1,
+        .used = MP_ARRAY_SIZE(nsp_profile_globals_table),
+        .alloc = MP_ARRAY_SIZE(nsp_profile_globals_table),
+        .table = (mp_map_elem_t*) nsp_profile_globals_table,
+    },
+};
+
+const mp_obj_module_t nsp_profile_module = {
+    .base = { &mp_type_module },
+    .name = MP_QSTR_profile,
+    .globals = (mp_obj_dict_t*) &nsp_profile_globals,
+};
@@ -0,0 +1,3 @@
+extern const mp_obj_module_t nsp_profile_module;
+
+void nsp_profile_deinit();
@@ -36,6 +36,12 @@ Q(flush)
 
 Q(_os)
 Q(stat)
+Q(listdir)
+Q(ilistdir)
+Q(scandir)
+Q(mkdir)
+Q(remove)
+Q(rename)
 
 Q(as_bytearray)
 Q(callback)
@@ -52,6 +58,131 @@ Q(sleep)
 Q(nsp)
 Q(waitKeypress)
 Q(readRTC)
+Q(ticks)
+Q(ticks_diff)
+Q(hud)
+
+//plot
+Q(plot)
+Q(tex)
+Q(ys)
+Q(x0)
+Q(x1)
+Q(y0)
+Q(y1)
+Q(color)
+Q(axes)
+Q(grid)
+Q(aa)
+
+//Raster3D
+Q(Raster3D)
+Q(clear)
+Q(setMatrix)
+Q(draw)
+Q(self)
+Q(vertices)
+Q(indices)
+Q(colors)
+Q(mode)
+Q(cull)
+Q(FLAT)
+Q(GOURAUD)
+Q(WIRE)
+
+//Font
+Q(Font)
+Q(drawText)
+Q(save)
+
+//EventLoop
+Q(EventLoop)
+Q(onKey)
+Q(every)
+Q(onFrame)
+Q(spawn)
+Q(cancel)
+Q(run)
+Q(ESC)
+Q(ENTER)
+Q(UP)
+Q(DOWN)
+Q(LEFT)
+Q(RIGHT)
+Q(TAB)
+Q(DEL)
+Q(CTRL)
+Q(SHIFT)
+Q(MENU)
+Q(SPACE)
+
+//profile
+Q(profile)
+Q(start)
+Q(stop)
+Q(reset)
+Q(track)
+Q(enter)
+Q(leave)
+Q(report)
+Q(collapsed)
+
+//ndarray
+Q(ndarray)
+Q(iterator)
+Q(array)
+Q(zeros)
+Q(ones)
+Q(eye)
+Q(linspace)
+Q(dot)
+Q(solve)
+Q(inv)
+Q(det)
+Q(int16)
+Q(float32)
+Q(float64)
+Q(obj)
+Q(dtype)
+Q(shape)
+Q(n)
+Q(num)
+Q(ndim)
+Q(size)
+Q(T)
+Q(reshape)
+Q(transpose)
+Q(copy)
+Q(astype)
+Q(tolist)
+Q(sum)
+Q(mean)
+Q(min)
+Q(max)
+
+//umath
+Q(umath)
+Q(x)
+Q(y)
+Q(out)
+
+//fixed
+Q(fixed)
+Q(Q16)
+Q(toint)
+Q(tofloat)
+Q(raw)
+Q(fromraw)
+Q(add)
+Q(sub)
+Q(mul)
+Q(convert)
+
+//kvstore
+Q(kvstore)
+Q(KVStore)
+Q(garbage)
+Q(compact)
 
 //Texture
 Q(Texture)
@@ -0,0 +1,640 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mpconfig.h"
+#include "nlr.h"
+#include "misc.h"
+#include "gc.h"
+#include "qstr.h"
+#include "obj.h"
+#include "runtime.h"
+#include "texture.h"
+#include "fixed.h"
+#include "raster3d.h"
+
+/*
+ * Software 3D rasterizer with a z-buffer.
+ *
+ * Small example:
+ *
+ * from nsp import Texture, Raster3D
+ * from array import array
+ * t = Texture(320, 240, None)
+ * r = Raster3D(t)
+ * r.setMatrix((1, 0, 0, 0,
+ *              0, 1, 0, 0,
+ *              0, 0, 1, 0,
+ *              0, 0, 0, 1))
+ * vertices = array('f', (-0.5, -0.5, 0, 0.5, -0.5, 0, 0, 0.5, 0))
+ * colors = array('H', (0xF800, 0x07E0, 0x001F))
+ * r.clear(0x0000)
+ * r.draw(vertices, None, colors=colors, mode=Raster3D.GOURAUD)
+ * t.display()
+ *
+ * The matrix maps (x, y, z, 1) to clip space like in OpenGL: the visible volume is
+ * -w <= x, y, z <= w, after the perspective divide x = -1 is the left and y = -1 the
+ * bottom border of the texture, z = -1 is near and z = 1 far.
+ * Vertices are packed x, y, z triples in a buffer of type 'i' (raw Q16 values, see
+ * the fixed module), 'h' (integers) or 'f'. Triangles are index triples in a buffer
+ * of type 'B', 'H' or 'h', or consecutive vertices if indices is None.
+ * Triangles are clipped against the visible volume, so screen coordinates never
+ * overflow. The z-buffer has 16 bits and belongs to the Raster3D object.
+ *
+ * Available functions:
+ * Raster3D(tex): Creates a rasterizer drawing onto tex, with a z-buffer of the same size.
+ * clear(color = -1): Resets the z-buffer, and fills the texture with color if it isn't -1.
+ * setMatrix(m): Sets the 4x4 transform, 16 numbers or Q16 values row by row, or a buffer
+ *   of type 'i' (raw Q16), 'f' or 'd', so a 4x4 float32 ndarray works as well.
+ * draw(vertices, indices, color = 0xFFFF, colors = None, mode = FLAT, cull = False):
+ *   Draws the triangles. colors is a buffer of type 'H' with one color per vertex,
+ *   otherwise everything has color. FLAT fills each triangle with the color of its first
+ *   vertex, GOURAUD interpolates the vertex colors and WIRE only draws the edges.
+ *   If cull is True, triangles which are clockwise on screen are skipped.
+ * delete(): Frees the z-buffer.
+ */
+
+#define RASTER3D_FLAT 0
+#define RASTER3D_GOURAUD 1
+#define RASTER3D_WIRE 2
+
+// A triangle clipped against the six planes has at most 9 corners
+#define RASTER3D_MAX_POLY 9
+
+typedef struct raster3d_vertex_t
+{
+	fix16_t x, y, z, w; // Clip space
+	int32_t r, g, b; // Q16 color channels
+	uint8_t outcode; // Bit set for each plane the vertex is outside of
+} raster3d_vertex_t;
+
+// Projected vertex: x, y in Q16 pixels, z in Q8 depth units
+typedef struct raster3d_point_t
+{
+	int32_t x, y, z;
+	int32_t r, g, b;
+} raster3d_point_t;
+
+typedef struct raster3d_obj_t
+{
+	mp_obj_base_t base;
+	nsp_texture_obj_t *tex;
+	uint16_t width, height;
+	uint16_t *zbuffer;
+	fix16_t matrix[16];
+	// Transformed vertices of the last draw() call, kept to avoid allocating every frame
+	raster3d_vertex_t *cache;
+	mp_uint_t cache_len;
+} raster3d_obj_t;
+
+static raster3d_obj_t *raster3d_get(mp_obj_t self_in)
+{
+	if(mp_obj_get_type(self_in) != &nsp_raster3d_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	raster3d_obj_t *self = self_in;
+	if(!self->zbuffer)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Raster3D has been deleted!"));
+	if(self->tex->width != self->width || self->tex->height != self->height)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "The texture has been deleted!"));
+
+	return self;
+}
+
+static mp_obj_t nsp_raster3d_make_new(mp_obj_t nobody_cares, uint n_args, uint n_kw, const mp_obj_t *args)
+{
+	mp_arg_check_num(n_args, n_kw, 1, 1, false);
+
+	if(mp_obj_get_type(args[0]) != &nsp_texture_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	raster3d_obj_t *self = m_new_obj(raster3d_obj_t);
+	self->base.type = &nsp_raster3d_type;
+	self->tex = args[0];
+	self->width = self->tex->width;
+	self->height = self->tex->height;
+	self->cache = NULL;
+	self->cache_len = 0;
+
+	for(int i = 0; i < 16; ++i)
+		self->matrix[i] = i % 5 == 0 ? FIX16_ONE : 0;
+
+	self->zbuffer = gc_alloc(self->width * self->height * 2, false);
+	if(!self->zbuffer)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Allocation of z-buffer failed!"));
+
+	uint16_t *start = self->zbuffer, *end = self->zbuffer + self->width * self->height;
+	while(start < end)
+		*start++ = 0xFFFF;
+
+	return self;
+}
+
+static void nsp_raster3d_print(void (*print)(void *env, const char *fmt, ...), void *env, mp_obj_t self_in, mp_print_kind_t kind)
+{
+	raster3d_obj_t *self = self_in;
+	print(env, "Raster3D (w=%u, h=%u, zbuffer=%p)", self->width, self->height, self->zbuffer);
+}
+
+static mp_obj_t nsp_raster3d_clear(uint n_args, const mp_obj_t *args)
+{
+	raster3d_obj_t *self = raster3d_get(args[0]);
+
+	uint16_t *start = self->zbuffer, *end = self->zbuffer + self->width * self->height;
+	while(start < end)
+		*start++ = 0xFFFF;
+
+	if(n_args == 2 && mp_obj_get_int(args[1]) != -1)
+	{
+		uint16_t color = mp_obj_get_int(args[1]);
+		start = self->tex->bitmap;
+		end = self->tex->bitmap + self->width * self->height;
+		while(start < end)
+			*start++ = color;
+	}
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_raster3d_clear_obj, 1, 2, nsp_raster3d_clear);
+
+static mp_obj_t nsp_raster3d_setMatrix(mp_obj_t self_in, mp_obj_t m)
+{
+	raster3d_obj_t *self = raster3d_get(self_in);
+	fix16_t matrix[16];
+
+	mp_buffer_info_t bufinfo;
+	if(mp_get_buffer(m, &bufinfo, MP_BUFFER_READ))
+	{
+		mp_uint_t len = 0;
+		switch(bufinfo.typecode)
+		{
+			case 'i': len = bufinfo.len / sizeof(int32_t); break;
+			case 'f': len = bufinfo.len / sizeof(float); break;
+			case 'd': len = bufinfo.len / sizeof(double); break;
+			default:
+				nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "buffer must be of type 'i', 'f' or 'd'"));
+		}
+		if(len != 16)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "The matrix needs 16 values!"));
+
+		for(int i = 0; i < 16; ++i)
+		{
+			if(bufinfo.typecode == 'i')
+				matrix[i] = ((const int32_t*)bufinfo.buf)[i];
+			else if(bufinfo.typecode == 'f')
+				matrix[i] = ((const float*)bufinfo.buf)[i] * FIX16_ONE;
+			else
+				matrix[i] = ((const double*)bufinfo.buf)[i] * FIX16_ONE;
+		}
+	}
+	else
+	{
+		mp_uint_t len;
+		mp_obj_t *items;
+		mp_obj_get_array(m, &len, &items);
+		if(len != 16)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "The matrix needs 16 values!"));
+
+		for(int i = 0; i < 16; ++i)
+			matrix[i] = fix16_from_obj(items[i]);
+	}
+
+	for(int i = 0; i < 16; ++i)
+		self->matrix[i] = matrix[i];
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(nsp_raster3d_setMatrix_obj, nsp_raster3d_setMatrix);
+
+static inline int64_t raster3d_dist(const raster3d_vertex_t *v, int plane)
+{
+	switch(plane)
+	{
+		case 0: return (int64_t)v->w + v->x;
+		case 1: return (int64_t)v->w - v->x;
+		case 2: return (int64_t)v->w + v->y;
+		case 3: return (int64_t)v->w - v->y;
+		case 4: return (int64_t)v->w + v->z;
+		default: return (int64_t)v->w - v->z;
+	}
+}
+
+static void raster3d_transform(const fix16_t *m, fix16_t x, fix16_t y, fix16_t z, raster3d_vertex_t *v)
+{
+	fix16_t out[4];
+	for(int row = 0; row < 4; ++row, m += 4)
+		out[row] = ((int64_t)m[0] * x + (int64_t)m[1] * y + (int64_t)m[2] * z + ((int64_t)m[3] << 16)) >> 16;
+
+	v->x = out[0];
+	v->y = out[1];
+	v->z = out[2];
+	v->w = out[3];
+
+	v->outcode = 0;
+	for(int plane = 0; plane < 6; ++plane)
+		if(raster3d_dist(v, plane) < 0)
+			v->outcode |= 1 << plane;
+}
+
+// Point at t (Q16) between a and b
+static void raster3d_lerp(const raster3d_vertex_t *a, const raster3d_vertex_t *b, int32_t t, raster3d_vertex_t *out)
+{
+	out->x = a->x + (((int64_t)b->x - a->x) * t >> 16);
+	out->y = a->y + (((int64_t)b->y - a->y) * t >> 16);
+	out->z = a->z + (((int64_t)b->z - a->z) * t >> 16);
+	out->w = a->w + (((int64_t)b->w - a->w) * t >> 16);
+	out->r = a->r + (((int64_t)b->r - a->r) * t >> 16);
+	out->g = a->g + (((int64_t)b->g - a->g) * t >> 16);
+	out->b = a->b + (((int64_t)b->b - a->b) * t >> 16);
+}
+
+// Perspective divide and viewport transform, false if w isn't positive
+static bool raster3d_project(const raster3d_obj_t *self, const raster3d_vertex_t *v, raster3d_point_t *p)
+{
+	if(v->w <= 0)
+		return false;
+
+	int64_t z = (((int64_t)v->z + v->w) << 23) / v->w;
+	p->x = (((int64_t)v->x + v->w) * self->width << 15) / v->w;
+	p->y = (((int64_t)v->w - v->y) * self->height << 15) / v->w;
+	p->z = z < 0 ? 0 : z > 0xFFFF00 ? 0xFFFF00 : z;
+	p->r = v->r;
+	p->g = v->g;
+	p->b = v->b;
+	return true;
+}
+
+// Gradient of an attribute over the screen per pixel, from the values at the corners
+static inline int32_t raster3d_gradient(int32_t a0, int32_t a1, int32_t a2, int32_t d1, int32_t d2, int64_t area)
+{
+	return (((int64_t)(a1 - a0) * d2 - (int64_t)(a2 - a0) * d1) >> 16) * FIX16_ONE / area;
+}
+
+// Scanline fill with pixel centers at (x + 0.5, y + 0.5), top-left inclusive
+static void raster3d_fill(raster3d_obj_t *self, const raster3d_point_t *p0, const raster3d_point_t *p1, const raster3d_point_t *p2, bool gouraud, uint16_t color)
+{
+	const int64_t area = ((int64_t)(p1->x - p0->x) * (p2->y - p0->y) - (int64_t)(p2->x - p0->x) * (p1->y - p0->y)) >> 16;
+	if(area == 0)
+		return;
+
+	// Per pixel gradients of z and the colors
+	const int32_t dx1 = p1->x - p0->x, dx2 = p2->x - p0->x, dy1 = p1->y - p0->y, dy2 = p2->y - p0->y;
+	const int32_t dzdx = raster3d_gradient(p0->z, p1->z, p2->z, dy1, dy2, area);
+	const int32_t dzdy = raster3d_gradient(p0->z, p2->z, p1->z, dx2, dx1, area);
+	int32_t drdx = 0, drdy = 0, dgdx = 0, dgdy = 0, dbdx = 0, dbdy = 0;
+	if(gouraud)
+	{
+		drdx = raster3d_gradient(p0->r, p1->r, p2->r, dy1, dy2, area);
+		drdy = raster3d_gradient(p0->r, p2->r, p1->r, dx2, dx1, area);
+		dgdx = raster3d_gradient(p0->g, p1->g, p2->g, dy1, dy2, area);
+		dgdy = raster3d_gradient(p0->g, p2->g, p1->g, dx2, dx1, area);
+		dbdx = raster3d_gradient(p0->b, p1->b, p2->b, dy1, dy2, area);
+		dbdy = raster3d_gradient(p0->b, p2->b, p1->b, dx2, dx1, area);
+	}
+
+	// Sort by y for the edge walk
+	const raster3d_point_t *top = p0, *mid = p1, *bottom = p2, *tmp;
+	if(mid->y < top->y) { tmp = top; top = mid; mid = tmp; }
+	if(bottom->y < mid->y) { tmp = mid; mid = bottom; bottom = tmp; }
+	if(mid->y < top->y) { tmp = top; top = mid; mid = tmp; }
+
+	int y_start = (top->y + 0x7FFF) >> 16, y_mid = (mid->y + 0x7FFF) >> 16, y_end = (bottom->y + 0x7FFF) >> 16;
+	if(y_start < 0)
+		y_start = 0;
+	if(y_end > self->height)
+		y_end = self->height;
+
+	// 64 bits, as an edge which is nearly horizontal has a huge slope
+	const int64_t long_dxdy = ((int64_t)(bottom->x - top->x) << 16) / (bottom->y - top->y);
+	int64_t long_x = top->x + ((((int64_t)y_start << 16) + 0x8000 - top->y) * long_dxdy >> 16);
+
+	const raster3d_point_t *edge_top = NULL;
+	int64_t short_dxdy = 0, short_x = 0;
+
+	for(int y = y_start; y < y_end; ++y, long_x += long_dxdy, short_x += short_dxdy)
+	{
+		const int32_t yc = ((int32_t)y << 16) + 0x8000;
+		const raster3d_point_t *edge = y < y_mid ? top : mid;
+		if(edge != edge_top)
+		{
+			const raster3d_point_t *edge_bottom = y < y_mid ? mid : bottom;
+			edge_top = edge;
+			short_dxdy = ((int64_t)(edge_bottom->x - edge->x) << 16) / (edge_bottom->y - edge->y);
+			short_x = edge->x + ((int64_t)(yc - edge->y) * short_dxdy >> 16);
+		}
+
+		int64_t xl = long_x, xr = short_x;
+		if(xl > xr) { xl = short_x; xr = long_x; }
+		if(xl < 0)
+			xl = 0;
+		if(xr > (int64_t)self->width << 16)
+			xr = (int64_t)self->width << 16;
+		const int x_start = (xl + 0x7FFF) >> 16, x_end = (xr + 0x7FFF) >> 16;
+		if(x_start >= x_end)
+			continue;
+
+		// Attributes at the center of the first pixel
+		const int64_t ox = ((int32_t)x_start << 16) + 0x8000 - p0->x, oy = yc - p0->y;
+		int32_t z = p0->z + ((dzdx * ox + dzdy * oy) >> 16);
+		uint16_t *px = self->tex->bitmap + x_start + y * self->width, *px_end = px + (x_end - x_start);
+		uint16_t *zp = self->zbuffer + x_start + y * self->width;
+
+		if(!gouraud)
+		{
+			for(; px < px_end; ++px, ++zp, z += dzdx)
+				if((uint32_t)z >> 8 < *zp)
+				{
+					*zp = (uint32_t)z >> 8;
+					*px = color;
+				}
+			continue;
+		}
+
+		int32_t r = p0->r + ((drdx * ox + drdy * oy) >> 16);
+		int32_t g = p0->g + ((dgdx * ox + dgdy * oy) >> 16);
+		int32_t b = p0->b + ((dbdx * ox + dbdy * oy) >> 16);
+		for(; px < px_end; ++px, ++zp, z += dzdx, r += drdx, g += dgdx, b += dbdx)
+			if((uint32_t)z >> 8 < *zp)
+			{
+				*zp = (uint32_t)z >> 8;
+				*px = ((r >> 16) & 0x1F) << 11 | ((g >> 16) & 0x3F) << 5 | ((b >> 16) & 0x1F);
+			}
+	}
+}
+
+// Depth tested line, the endpoints are inside the texture or on its border
+static void raster3d_line(raster3d_obj_t *self, const raster3d_point_t *a, const raster3d_point_t *b, uint16_t color)
+{
+	const int32_t dx = b->x - a->x, dy = b->y - a->y;
+	const int32_t adx = dx < 0 ? -dx : dx, ady = dy < 0 ? -dy : dy;
+	const int steps = ((adx > ady ? adx : ady) >> 16) + 1;
+	const int32_t sx = dx / steps, sy = dy / steps, sz = (b->z - a->z) / steps;
+	int32_t x = a->x, y = a->y, z = a->z;
+
+	for(int i = 0; i <= steps; ++i, x += sx, y += sy, z += sz)
+	{
+		const unsigned int px = x >> 16, py = y >> 16;
+		if(px >= self->width || py >= self->height)
+			continue;
+
+		const unsigned int offset = px + py * self->width;
+		if((uint32_t)z >> 8 <= self->zbuffer[offset])
+		{
+			self->zbuffer[offset] = (uint32_t)z >> 8;
+			self->tex->bitmap[offset] = color;
+		}
+	}
+}
+
+static void raster3d_edge(raster3d_obj_t *self, const raster3d_vertex_t *a, const raster3d_vertex_t *b, uint16_t color)
+{
+	raster3d_vertex_t ca = *a, cb = *b;
+
+	// Liang-Barsky in clip space
+	if(a->outcode | b->outcode)
+	{
+		if(a->outcode & b->outcode)
+			return;
+
+		int32_t t0 = 0, t1 = FIX16_ONE;
+		for(int plane = 0; plane < 6; ++plane)
+		{
+			const int64_t da = raster3d_dist(a, plane), db = raster3d_dist(b, plane);
+			if(da < 0 && db < 0)
+				return;
+			if(da >= 0 && db >= 0)
+				continue;
+
+			const int32_t t = (da << 16) / (da - db);
+			if(da < 0 && t > t0)
+				t0 = t;
+			else if(db < 0 && t < t1)
+				t1 = t;
+		}
+		if(t0 > t1)
+			return;
+
+		raster3d_lerp(a, b, t0, &ca);
+		raster3d_lerp(a, b, t1, &cb);
+	}
+
+	raster3d_point_t pa, pb;
+	if(raster3d_project(self, &ca, &pa) && raster3d_project(self, &cb, &pb))
+		raster3d_line(self, &pa, &pb, color);
+}
+
+static void raster3d_triangle(raster3d_obj_t *self, const raster3d_vertex_t *a, const raster3d_vertex_t *b, const raster3d_vertex_t *c, bool gouraud, bool cull, uint16_t color)
+{
+	if(a->outcode & b->outcode & c->outcode)
+		return;
+
+	raster3d_vertex_t buf[2][RASTER3D_MAX_POLY];
+	raster3d_vertex_t *poly = buf[0];
+	int n = 3;
+	poly[0] = *a;
+	poly[1] = *b;
+	poly[2] = *c;
+
+	// Sutherland-Hodgman, only against the planes which are crossed
+	const uint8_t outcodes = a->outcode | b->outcode | c->outcode;
+	for(int plane = 0; plane < 6; ++plane)
+	{
+		if(!(outcodes & (1 << plane)))
+			continue;
+
+		raster3d_vertex_t *out = poly == buf[0] ? buf[1] : buf[0];
+		int out_n = 0;
+		for(int i = 0; i < n; ++i)
+		{
+			const raster3d_vertex_t *cur = &poly[i], *next = &poly[i + 1 == n ? 0 : i + 1];
+			const int64_t dc = raster3d_dist(cur, plane), dn = raster3d_dist(next, plane);
+			if(dc >= 0)
+				out[out_n++] = *cur;
+			if((dc >= 0) != (dn >= 0))
+				raster3d_lerp(cur, next, (dc << 16) / (dc - dn), &out[out_n++]);
+		}
+
+		poly = out;
+		n = out_n;
+		if(n < 3)
+			return;
+	}
+
+	raster3d_point_t points[RASTER3D_MAX_POLY];
+	for(int i = 0; i < n; ++i)
+		if(!raster3d_project(self, &poly[i], &points[i]))
+			return;
+
+	// Counterclockwise in clip space is clockwise on screen, as y is flipped
+	if(cull)
+	{
+		int64_t area = 0;
+		for(int i = 0, j = n - 1; i < n; j = i++)
+			area += ((int64_t)points[j].x * points[i].y - (int64_t)points[i].x * points[j].y) >> 16;
+		if(area > 0)
+			return;
+	}
+
+	for(int i = 2; i < n; ++i)
+		raster3d_fill(self, &points[0], &points[i - 1], &points[i], gouraud, color);
+}
+
+static const mp_arg_t nsp_raster3d_draw_args[] = {
+	{ MP_QSTR_self, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_vertices, MP_ARG_REQUIRED | MP_ARG_OBJ, {} },
+	{ MP_QSTR_indices, MP_ARG_OBJ, { .u_obj = mp_const_none } },
+	{ MP_QSTR_color, MP_ARG_KW_ONLY | MP_ARG_INT, { .u_int = 0xFFFF } },
+	{ MP_QSTR_colors, MP_ARG_KW_ONLY | MP_ARG_OBJ, { .u_obj = mp_const_none } },
+	{ MP_QSTR_mode, MP_ARG_KW_ONLY | MP_ARG_INT, { .u_int = RASTER3D_FLAT } },
+	{ MP_QSTR_cull, MP_ARG_KW_ONLY | MP_ARG_BOOL, { .u_bool = false } },
+};
+
+static mp_obj_t nsp_raster3d_draw(uint n_args, const mp_obj_t *args, mp_map_t *kw_args)
+{
+	mp_arg_val_t args_val[sizeof(nsp_raster3d_draw_args)/sizeof(*nsp_raster3d_draw_args)];
+	mp_arg_parse_all(n_args, args, kw_args, sizeof(nsp_raster3d_draw_args)/sizeof(*nsp_raster3d_draw_args), nsp_raster3d_draw_args, args_val);
+
+	raster3d_obj_t *self = raster3d_get(args_val[0].u_obj);
+	const uint16_t color = args_val[3].u_int;
+	const mp_int_t mode = args_val[5].u_int;
+	const bool cull = args_val[6].u_bool;
+
+	if(mode != RASTER3D_FLAT && mode != RASTER3D_GOURAUD && mode != RASTER3D_WIRE)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid mode!"));
+
+	mp_buffer_info_t vertices;
+	mp_get_buffer_raise(args_val[1].u_obj, &vertices, MP_BUFFER_READ);
+	mp_uint_t n_vertices;
+	switch(vertices.typecode)
+	{
+		case 'i': n_vertices = vertices.len / sizeof(int32_t) / 3; break;
+		case 'h': n_vertices = vertices.len / sizeof(int16_t) / 3; break;
+		case 'f': n_vertices = vertices.len / sizeof(float) / 3; break;
+		default:
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "vertices must be of type 'i', 'h' or 'f'"));
+	}
+
+	mp_buffer_info_t indices = { .buf = NULL, .len = n_vertices, .typecode = 0 };
+	mp_uint_t n_indices = n_vertices;
+	if(args_val[2].u_obj != mp_const_none)
+	{
+		mp_get_buffer_raise(args_val[2].u_obj, &indices, MP_BUFFER_READ);
+		switch(indices.typecode)
+		{
+			case 'B': n_indices = indices.len; break;
+			case 'H': case 'h': n_indices = indices.len / sizeof(uint16_t); break;
+			default:
+				nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "indices must be of type 'B', 'H' or 'h'"));
+		}
+	}
+
+	const uint16_t *colors = NULL;
+	if(args_val[4].u_obj != mp_const_none)
+	{
+		mp_buffer_info_t bufinfo;
+		mp_get_buffer_raise(args_val[4].u_obj, &bufinfo, MP_BUFFER_READ);
+		if((bufinfo.typecode != 'H' && bufinfo.typecode != 'h') || bufinfo.len / sizeof(uint16_t) != n_vertices)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "colors needs one 16-bit color per vertex!"));
+		colors = bufinfo.buf;
+	}
+
+	// Transform every vertex once
+	if(self->cache_len < n_vertices)
+	{
+		self->cache = m_renew(raster3d_vertex_t, self->cache, self->cache_len, n_vertices);
+		self->cache_len = n_vertices;
+	}
+
+	for(mp_uint_t i = 0; i < n_vertices; ++i)
+	{
+		fix16_t p[3];
+		for(int j = 0; j < 3; ++j)
+		{
+			if(vertices.typecode == 'i')
+				p[j] = ((const int32_t*)vertices.buf)[i * 3 + j];
+			else if(vertices.typecode == 'h')
+				p[j] = FIX16_FROM_INT(((const int16_t*)vertices.buf)[i * 3 + j]);
+			else
+				p[j] = ((const float*)vertices.buf)[i * 3 + j] * FIX16_ONE;
+		}
+
+		raster3d_vertex_t *v = &self->cache[i];
+		raster3d_transform(self->matrix, p[0], p[1], p[2], v);
+
+		// Channels in the middle of their steps, so interpolation errors don't carry over
+		const uint16_t c = colors ? colors[i] : color;
+		v->r = ((c >> 11) << 16) + 0x8000;
+		v->g = (((c >> 5) & 0x3F) << 16) + 0x8000;
+		v->b = ((c & 0x1F) << 16) + 0x8000;
+	}
+
+	for(mp_uint_t i = 0; i + 2 < n_indices; i += 3)
+	{
+		mp_uint_t idx[3];
+		for(int j = 0; j < 3; ++j)
+		{
+			if(!indices.buf)
+				idx[j] = i + j;
+			else if(indices.typecode == 'B')
+				idx[j] = ((const uint8_t*)indices.buf)[i + j];
+			else
+				idx[j] = ((const uint16_t*)indices.buf)[i + j];
+
+			if(idx[j] >= n_vertices)
+				nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "Vertex index out of range!"));
+		}
+
+		const raster3d_vertex_t *a = &self->cache[idx[0]], *b = &self->cache[idx[1]], *c = &self->cache[idx[2]];
+		const uint16_t flat_color = colors ? colors[idx[0]] : color;
+		if(mode == RASTER3D_WIRE)
+		{
+			raster3d_edge(self, a, b, flat_color);
+			raster3d_edge(self, b, c, flat_color);
+			raster3d_edge(self, c, a, flat_color);
+		}
+		else
+			raster3d_triangle(self, a, b, c, mode == RASTER3D_GOURAUD, cull, flat_color);
+	}
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(nsp_raster3d_draw_obj, 2, nsp_raster3d_draw);
+
+static mp_obj_t nsp_raster3d_delete(mp_obj_t self_in)
+{
+	if(mp_obj_get_type(self_in) != &nsp_raster3d_type)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+
+	raster3d_obj_t *self = self_in;
+
+	if(!self->zbuffer)
+		return mp_const_none;
+
+	gc_free(self->zbuffer);
+	self->zbuffer = NULL;
+	m_del(raster3d_vertex_t, self->cache, self->cache_len);
+	self->cache = NULL;
+	self->cache_len = 0;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(nsp_raster3d_delete_obj, nsp_raster3d_delete);
+
+static const mp_map_elem_t nsp_raster3d_locals_dict_table[] = {
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_clear), (mp_obj_t) &nsp_raster3d_clear_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_setMatrix), (mp_obj_t) &nsp_raster3d_setMatrix_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_draw), (mp_obj_t) &nsp_raster3d_draw_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_delete), (mp_obj_t) &nsp_raster3d_delete_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_FLAT), MP_OBJ_NEW_SMALL_INT(RASTER3D_FLAT) },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_GOURAUD), MP_OBJ_NEW_SMALL_INT(RASTER3D_GOURAUD) },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_WIRE), MP_OBJ_NEW_SMALL_INT(RASTER3D_WIRE) },
+};
+
+static MP_DEFINE_CONST_DICT(nsp_raster3d_locals_dict, nsp_raster3d_locals_dict_table);
+
+const mp_obj_type_t nsp_raster3d_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Raster3D,
+	.print = nsp_raster3d_print,
+    .make_new = nsp_raster3d_make_new,
+    .locals_dict = (mp_obj_t)&nsp_raster3d_locals_dict
+};
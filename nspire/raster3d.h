@@ -0,0 +1 @@
+extern const mp_obj_type_t nsp_raster3d_type;
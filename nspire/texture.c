@@ -12,6 +12,9 @@
 #include "objstr.h"
 #include "runtime.h"
 #include "texture.h"
+#include "hud.h"
+#include "font.h"
+#include "imgsave.h"
 
 #include <libndls.h>
 #include <nucleus.h>
@@ -34,6 +37,8 @@
  * setPx(x, y, color): Sets color of the pixel at (x/y) to color. Throws exception if out of bounds.
  * setData(str): Writes the data of the base64 string str to the texture, has to be correct size.
  * drawOnto(dest, src_x = 0, src_y = 0, src_w = self.width, src_h = self.height, dest_x = 0, dest_y = 0, dest_w = src_w, dest_h = src_h): Draws part of the texture onto dest.
+ * drawText(font, str, x, y, color): Draws str with the nsp.Font font at (x/y), returns the x position after it.
+ * save(path, fmt): Writes the texture to a "bmp" or "png" file. Without fmt, it's "png" if path ends in ".png" or ".png.tns", else "bmp".
  * delete(): Frees the allocated memory. Should be done manually.
  */
 
@@ -118,6 +123,13 @@ static mp_obj_t nsp_texture_display(mp_obj_t self_in)
 		while(--ptr32 >= (uint32_t*)self->bitmap)
 			*--ptr_inv32 = ~*ptr32;
 	}
+
+	if(nsp_hud_enabled)
+		nsp_hud_frame((uint16_t*)SCREEN_BASE_ADDRESS);
+
+#ifdef NSP_HOST
+	nsp_host_display();
+#endif
 	
 	return mp_const_none;
 }
@@ -338,6 +350,59 @@ static mp_obj_t nsp_texture_drawOnto(uint n_args, const mp_obj_t *args, mp_map_t
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(nsp_texture_drawOnto_obj, 1, nsp_texture_drawOnto);
 
+static mp_obj_t nsp_texture_drawText(uint n_args, const mp_obj_t *args)
+{
+	if(mp_obj_get_type(args[0]) != &nsp_texture_type)
+	{
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+		return mp_const_none;
+	}
+
+	nsp_texture_obj_t *self = args[0];
+	mp_int_t x = mp_obj_get_int(args[3]), y = mp_obj_get_int(args[4]);
+	uint16_t color = mp_obj_get_int(args[5]);
+
+	return mp_obj_new_int(nsp_font_draw(self, args[1], args[2], x, y, color));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_texture_drawText_obj, 6, 6, nsp_texture_drawText);
+
+// Whether the name ends in ext, not counting a ".tns" suffix
+static bool nsp_texture_has_ext(const char *path, const char *ext)
+{
+	size_t len = strlen(path), ext_len = strlen(ext);
+	if(len >= 4 && strcmp(path + len - 4, ".tns") == 0)
+		len -= 4;
+
+	return len >= ext_len && memcmp(path + len - ext_len, ext, ext_len) == 0;
+}
+
+static mp_obj_t nsp_texture_save(uint n_args, const mp_obj_t *args)
+{
+	if(mp_obj_get_type(args[0]) != &nsp_texture_type)
+	{
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Wrong type of argument."));
+		return mp_const_none;
+	}
+
+	const char *path = mp_obj_str_get_str(args[1]);
+	int format = nsp_texture_has_ext(path, ".png") ? NSP_IMGSAVE_PNG : NSP_IMGSAVE_BMP;
+	if(n_args > 2)
+	{
+		const char *fmt = mp_obj_str_get_str(args[2]);
+		if(strcmp(fmt, "png") == 0)
+			format = NSP_IMGSAVE_PNG;
+		else if(strcmp(fmt, "bmp") == 0)
+			format = NSP_IMGSAVE_BMP;
+		else
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Unknown image format!"));
+	}
+
+	nsp_imgsave(args[0], path, format);
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(nsp_texture_save_obj, 2, 3, nsp_texture_save);
+
 /* Base64 decoder from wikipedia */
 
 #define WHITESPACE 64
@@ -443,6 +508,8 @@ static const mp_map_elem_t nsp_texture_locals_dict_table[] = {
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_setPx), (mp_obj_t) &nsp_texture_setPx_obj },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_getPx), (mp_obj_t) &nsp_texture_getPx_obj },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_drawOnto), (mp_obj_t) &nsp_texture_drawOnto_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_drawText), (mp_obj_t) &nsp_texture_drawText_obj },
+	{ MP_OBJ_NEW_QSTR(MP_QSTR_save), (mp_obj_t) &nsp_texture_save_obj },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_setData), (mp_obj_t) &nsp_texture_setData_obj },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_delete), (mp_obj_t) &nsp_texture_delete_obj },
 };
@@ -0,0 +1,60 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libndls.h>
+
+#include "timer.h"
+
+/*
+ * Free-running tick counter for frame timing and scheduling.
+ *
+ * Uses the first half of the second timer (SP804 on the CX), clocked at 32768 Hz,
+ * as a 32-bit down counter without interrupts. It's only touched once something
+ * asks for it and restored to its original state on exit.
+ */
+
+#define TIMER_BASE 0x900D0000
+#define TIMER_LOAD (*(volatile uint32_t*)(TIMER_BASE + 0x00))
+#define TIMER_VALUE (*(volatile uint32_t*)(TIMER_BASE + 0x04))
+#define TIMER_CONTROL (*(volatile uint32_t*)(TIMER_BASE + 0x08))
+
+static bool running;
+static uint32_t old_control, old_load;
+
+bool nsp_timer_start()
+{
+	if(running)
+		return true;
+
+	if(!has_colors)
+		return false;
+
+	old_control = TIMER_CONTROL;
+	old_load = TIMER_LOAD;
+	TIMER_CONTROL = 0;
+	TIMER_LOAD = 0xFFFFFFFF;
+	TIMER_CONTROL = 0x82; // Enabled, free-running, no interrupt, 32-bit
+	running = true;
+
+	return true;
+}
+
+void nsp_timer_deinit()
+{
+	if(!running)
+		return;
+
+	TIMER_CONTROL = 0;
+	TIMER_LOAD = old_load;
+	TIMER_CONTROL = old_control;
+	running = false;
+}
+
+// Ticks (1/NSP_TIMER_HZ s) since the timer was started, wraps around. 0 if not running.
+uint32_t nsp_timer_ticks()
+{
+	if(!running)
+		return 0;
+
+	return ~TIMER_VALUE;
+}
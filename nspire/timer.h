@@ -0,0 +1,8 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NSP_TIMER_HZ 32768
+
+bool nsp_timer_start();
+void nsp_timer_deinit();
+uint32_t nsp_timer_ticks();
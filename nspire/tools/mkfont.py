@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# Converts a BDF bitmap font into the font format of nsp.Font (see font.c).
+#
+# usage: mkfont.py font.bdf out.nfnt.tns [--first 32] [--last 126] [--kern pairs.txt]
+#
+# The kerning file has one pair per line: two characters and the adjustment in
+# pixels, e.g. "AV -1". Characters missing in the BDF font get an empty glyph.
+
+import argparse
+import struct
+
+
+def read_bdf(path):
+    ascent = descent = 0
+    glyphs = {}
+    with open(path, encoding="latin-1") as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == "FONT_ASCENT":
+            ascent = int(words[1])
+        elif words[0] == "FONT_DESCENT":
+            descent = int(words[1])
+        elif words[0] == "STARTCHAR":
+            code = advance = None
+            bbx = (0, 0, 0, 0)
+            rows = []
+            for line in lines:
+                words = line.split()
+                if words[0] == "ENCODING":
+                    code = int(words[1])
+                elif words[0] == "DWIDTH":
+                    advance = int(words[1])
+                elif words[0] == "BBX":
+                    bbx = tuple(int(w) for w in words[1:5])
+                elif words[0] == "BITMAP":
+                    for _ in range(bbx[1]):
+                        rows.append(bytes.fromhex(next(lines).strip()))
+                elif words[0] == "ENDCHAR":
+                    break
+            if code is not None and code >= 0:
+                glyphs[code] = (advance if advance is not None else bbx[0], bbx, rows)
+    return ascent, descent, glyphs
+
+
+def read_kerning(path):
+    pairs = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            if len(line) >= 4 and line[2] == " ":
+                pairs[(ord(line[0]), ord(line[1]))] = int(line[3:])
+    return pairs
+
+
+def convert(ascent, descent, glyphs, first, last, kerning):
+    height = ascent + descent
+    table = bytearray()
+    bitmaps = bytearray()
+    for code in range(first, last + 1):
+        advance, (w, h, xoff, yoff), rows = glyphs.get(code, (0, (0, 0, 0, 0), []))
+        stride = (w + 7) // 8
+        top = ascent - (yoff + h)
+        table += struct.pack("<BBb", w, advance, xoff)
+        for y in range(height):
+            row = rows[y - top] if 0 <= y - top < len(rows) else b""
+            bitmaps += row[:stride].ljust(stride, b"\0")
+
+    kern = bytearray()
+    for (left, right), adjust in sorted(kerning.items()):
+        if first <= left <= last and first <= right <= last and adjust:
+            kern += struct.pack("<BBb", left, right, adjust)
+
+    header = b"NSPF" + struct.pack("<BBBBHH", 1, height, ascent, first,
+                                   last - first + 1, len(kern) // 3)
+    return header + table + kern + bitmaps
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts a BDF font for nsp.Font")
+    parser.add_argument("bdf")
+    parser.add_argument("out")
+    parser.add_argument("--first", type=int, default=32)
+    parser.add_argument("--last", type=int, default=126)
+    parser.add_argument("--kern")
+    args = parser.parse_args()
+
+    if not 0 <= args.first <= args.last <= 255:
+        parser.error("characters have to be in the range 0 to 255")
+
+    ascent, descent, glyphs = read_bdf(args.bdf)
+    kerning = read_kerning(args.kern) if args.kern else {}
+    data = convert(ascent, descent, glyphs, args.first, args.last, kerning)
+    with open(args.out, "wb") as f:
+        f.write(data)
+    print("%s: %d glyphs, %d bytes" % (args.out, args.last - args.first + 1, len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,12 @@
+#include "mpconfig.h"
+
+/*
+ * Deflate and checksums from uzlib, for Texture.save. If the uzlib module is
+ * enabled, extmod/moduzlib.c already includes the same sources.
+ */
+
+#if !MICROPY_PY_UZLIB
+#include "extmod/uzlib/deflate.c"
+#include "extmod/uzlib/crc32.c"
+#include "extmod/uzlib/adler32.c"
+#endif
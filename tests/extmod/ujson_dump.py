@@ -0,0 +1,22 @@
+try:
+    import ujson as json
+except ImportError:
+    import json
+try:
+    import _io as io
+except ImportError:
+    import io
+
+# dump() writes in chunks, the output is the same as from dumps()
+for obj in (
+    None,
+    [1, -2, 123456789012345678901234567890, True, False],
+    {"key": [None, "a\"b\\c\n\t\x01"]},
+    ["x" * 300, list(range(100))],
+):
+    s = io.StringIO()
+    json.dump(obj, s)
+    print(s.getvalue() == json.dumps(obj), len(s.getvalue()))
+
+print(json.dumps([-1073741824, 1073741823, -0, "", [], {}]))
+print(json.dumps("\x1f~"))
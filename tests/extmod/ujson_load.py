@@ -0,0 +1,31 @@
+import ujson as json
+import _io as io
+
+# load() reads in chunks, values may straddle them
+doc = json.dumps([list(range(i)) for i in range(30)] + ["y" * 500, 12345678])
+print(json.load(io.StringIO(doc)) == json.loads(doc))
+print(json.load(io.StringIO(' {"a": [1, {"b": null}]}  ')))
+
+for s in ("", "[1, 2", "[1] x", "nul"):
+    try:
+        json.load(io.StringIO(s))
+    except ValueError:
+        print("ValueError")
+
+# iterload() yields the items of the outermost array or object
+print(list(json.iterload("[]")))
+print(list(json.iterload(' [1, "two", [3], {"four": 4}] ')))
+print(list(json.iterload('{"a": 1, "a": [2]}')))
+records = json.dumps([{"id": i, "name": "n" * i} for i in range(40)])
+n = 0
+for r in json.iterload(io.StringIO(records)):
+    if r != {"id": n, "name": "n" * n}:
+        print("bad", r)
+    n += 1
+print(n)
+
+for s in ("1", "[1, 2", "[1] x"):
+    try:
+        print(list(json.iterload(s)))
+    except ValueError:
+        print("ValueError")
@@ -0,0 +1,23 @@
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+# Integers of any size, and numbers which turn out not to be integers
+for s in ("0", "-0", "7", "-12", "1073741823", "1073741824", "-1073741825",
+          "123456789012345678901234567890", "-99999999999999999999",
+          "0.5", "-2.25", "1e3", "12E-1", "[1,-2,3]"):
+    print(s, json.loads(s))
+
+# Records with the same keys, some longer than those which are interned
+key = "k" * 40
+doc = json.dumps([{"a": i, "bb": [i], key: str(i)} for i in range(20)])
+recs = json.loads(doc)
+print(len(recs), sorted(recs[7].items()))
+print(all(sorted(r) == sorted(recs[0]) for r in recs))
+print(sorted(json.loads('{"1": 1, "2": 2, "3": 3, "4": 4, "5": 5, "6": 6, "7": 7, "8": 8, "9": 9}').items()))
+
+# More distinct keys in one parse than are interned
+keys = ["key%d" % i for i in range(100)]
+d = json.loads(json.dumps(dict((k, i) for i, k in enumerate(keys))))
+print(len(d), all(d[k] == i for i, k in enumerate(keys)), d["key99"])
@@ -0,0 +1,29 @@
+import ure as re
+
+# The Pike VM and the backtracker give the same matches and groups
+for pat, s in (
+    ("(a|ab)(c|bcd)", "abcd"),
+    ("(a+)(b*)", "xaaabbc"),
+    ("(a+?)a", "aaaa"),
+    ("(a*?)b", "aab"),
+    ("(x)?y", "y"),
+    ("(.*)c", "abcabc"),
+    ("(.*?)c", "abcabc"),
+    ("([0-9]+)|([a-z]+)", "..abc12"),
+    ("(^a|b$)", "cab"),
+    ("(a|b|c)+", "ccbax"),
+    ("([^a]+)", "aaxyza"),
+):
+    r = re.compile(pat)
+    rb = re.compile(pat, re.BACKTRACK)
+    for m, mb in ((r.match(s), rb.match(s)), (r.search(s), rb.search(s))):
+        if m is None or mb is None:
+            print(pat, s, m, mb)
+        else:
+            print(pat, s, m.group(0), m.group(1), m.group(0) == mb.group(0) and m.group(1) == mb.group(1))
+
+# Nested repetitions take time linear in the input, not exponential
+s = "a" * 40
+print(re.match("(a|aa)*c", s))
+print(re.match("(a*)*b", s))
+print(re.search("(a+)+$", s).group(0) == s)
@@ -0,0 +1,33 @@
+try:
+    import ure as re
+except ImportError:
+    import re
+
+# Unanchored searches start at the literal prefix or the possible first bytes
+for pat, s in (
+    ("abc", "xxabcxx"),
+    ("ab+", "aaabbb"),
+    ("[0-9]+", "abc123def"),
+    ("(cat|dog)s", "hotdogs"),
+    ("x*y", "aaaxxy"),
+    ("a?b", "cccb"),
+    ("a|", "bbb"),
+    ("c$", "abc"),
+):
+    m = re.search(pat, s)
+    print(pat, s, m and m.group(0))
+
+# Loops with a body that can be empty
+for pat, s in (
+    ("(a*)+b", "xxaab"),
+    ("(a|)+c", "xxac"),
+    ("(a*)*b", "xxb"),
+    ("(|a)+", "aaa"),
+    ("(a?)+?c", "c"),
+    ("(b*)+", "xyz"),
+):
+    r = re.compile(pat)
+    m = r.search(s)
+    print(pat, s, m and m.group(0))
+    m = r.match(s)
+    print(pat, s, m and m.group(0))
@@ -0,0 +1,20 @@
+try:
+    import ure as re
+except ImportError:
+    import re
+
+m = re.search("b(c)", "abcd")
+print(m.start(), m.end(), m.span(), m.span(1))
+m = re.search("(x)|b", "abc")
+print(m.span(1), m.span(0))
+
+# str offsets count characters, bytes offsets count bytes
+m = re.search("b", "ééab")
+print(m.start(), m.end(), m.span())
+m = re.search(b"b", "ééab".encode())
+print(m.start(), m.end(), m.span())
+
+# Empty matches step over whole characters
+print(re.sub("x*", "-", "aéb"))
+print([m.span() for m in re.finditer("x*", "é€")])
+print(re.findall("x*", "é€"))
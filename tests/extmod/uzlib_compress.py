@@ -0,0 +1,132 @@
+try:
+    import uzlib as zlib
+    import _io as io
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+# Compressible text which still has matches at all kinds of distances
+def gen(n):
+    words = (b"alpha ", b"beta ", b"gamma, ", b"delta ", b"epsilon. ", b"zeta ",
+             b"eta\n", b"theta ", b"iota ", b"kappa ", b"lambda ", b"mu ")
+    parts = []
+    x = 1
+    size = 0
+    while size < n:
+        x = (x * 75 + 74) % 65537
+        w = words[x % len(words)]
+        if x % 7 == 0:
+            w = w + bytes([48 + x % 10])
+        parts.append(w)
+        size += len(w)
+    return b"".join(parts)[:n]
+
+def crc32(data):
+    crc = 0xffffffff
+    for b in data:
+        crc ^= b
+        for i in range(8):
+            if crc & 1:
+                crc = (crc >> 1) ^ 0xedb88320
+            else:
+                crc >>= 1
+    return crc ^ 0xffffffff
+
+def le32(b):
+    return b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24)
+
+crcs = {}
+
+# Checks z against data: through decompress() and through DecompIO with no
+# more window than the compressor was given
+def check(data, z, wbits):
+    if wbits < 0:
+        return (zlib.decompress(z, -1) == data
+                and zlib.DecompIO(io.BytesIO(z), wbits).read() == data)
+    if wbits > 16:
+        if len(data) not in crcs:
+            crcs[len(data)] = crc32(data)
+        return (z[:4] == b"\x1f\x8b\x08\x00"
+                and zlib.DecompIO(io.BytesIO(z[10:-8]), 16 - wbits).read() == data
+                and le32(z[-8:-4]) == crcs[len(data)]
+                and le32(z[-4:]) == len(data))
+    return (z[0] >> 4 == wbits - 8
+            and zlib.decompress(z) == data
+            and zlib.DecompIO(io.BytesIO(z), wbits).read() == data)
+
+# All levels and formats, the data being longer than 2 << wbits for the
+# smaller windows so that the window slides
+data = gen(5000)
+for level in range(10):
+    print(level, [check(data, zlib.compress(data, level, wbits), wbits)
+                  for wbits in (9, 15, -9, -15, 25, 31)])
+
+# Memory levels
+for memlevel in (1, 2, 5, 9):
+    print(memlevel, [check(data, zlib.compress(data, level, wbits, memlevel), wbits)
+                     for level in (1, 6, 9) for wbits in (10, -12, 31)])
+
+# Default arguments give zlib data with a 32k window
+z = zlib.compress(data)
+print(z[0] == 0x78, check(data, z, 15), len(z) < len(data) // 2)
+
+# Level 0 only stores
+print(len(zlib.compress(data, 0, -9)) > len(data))
+
+# Empty input
+print([check(b"", zlib.compress(b"", level, wbits), wbits)
+       for level in (0, 1, 9) for wbits in (9, -15, 31)])
+
+# One byte, and data which doesn't compress
+print(check(b"x", zlib.compress(b"x"), 15))
+noise = bytes([(i * 97 + (i >> 3) * 31) & 0xff for i in range(3000)])
+print([check(noise, zlib.compress(noise, level, -9), -9) for level in (0, 1, 6, 9)])
+
+# More than twice the biggest window
+big = gen(70000)
+print(check(big, zlib.compress(big, 1), 15), check(big, zlib.compress(big, 9, -15, 9), -15))
+
+# CompIO with small writes, the output stays readable after close()
+for level, wbits in ((0, 15), (1, -9), (6, 31), (9, 11)):
+    buf = io.BytesIO()
+    c = zlib.CompIO(buf, level, wbits)
+    i = 0
+    n = 1
+    while i < len(data):
+        c.write(data[i:i + n])
+        i += n
+        n = n % 13 + 1
+    c.close()
+    c.close()
+    print(level, wbits, check(data, buf.getvalue(), wbits))
+
+# Writing after close()
+try:
+    c.write(b"more")
+except OSError:
+    print("OSError")
+
+# with closes the CompIO
+buf = io.BytesIO()
+with zlib.CompIO(buf, 9, 31) as c:
+    for line in data.split(b"\n"):
+        c.write(line + b"\n")
+print(check(data + b"\n", buf.getvalue(), 31))
+
+# Nothing written at all
+buf = io.BytesIO()
+with zlib.CompIO(buf) as c:
+    pass
+print(check(b"", buf.getvalue(), 15))
+
+# Bad arguments
+for args in ((10,), (-1,), (6, 8), (6, -8), (6, 16), (6, 24), (6, 32), (6, 15, 0), (6, 15, 10)):
+    try:
+        zlib.compress(b"", *args)
+    except ValueError:
+        print("ValueError", args)
+try:
+    zlib.CompIO(b"")
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,53 @@
+try:
+    import uzlib as zlib
+    import _io as io
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+
+text = b"The quick brown fox jumps over the lazy dog. " * 40
+z = b'x\x9c\x0b\xc9HU(,\xcdL\xceVH*\xca/\xcfSH\xcb\xafP\xc8*\xcd-(V\xc8/K-R(\x01J\xe7$VU*\xa4\xe4\xa7\xeb)\x84\x8c*\x1eU<\xaaxT\xf1\xa8\xe2Q\xc5\xc3K1\x00\x88\n\x867'
+raw = z[2:-4]
+
+def decompio(data, *args):
+    return zlib.DecompIO(io.BytesIO(data), *args)
+
+# zlib data with the window from the header or given, raw deflate data
+print(decompio(z).read() == text)
+print(decompio(z, 15).read() == text)
+print(decompio(b"\x18\xd3" + z[2:]).read() == text)
+print(decompio(raw, -15).read() == text)
+print(decompio(raw, -9).read() == text)
+
+# Small reads
+d = decompio(z)
+parts = []
+while True:
+    b = d.read(7)
+    if not b:
+        break
+    parts.append(b)
+print(len(parts), b"".join(parts) == text)
+
+# Bad header and checksum
+for data in (b"\x78\x9d" + z[2:], z[:-1] + bytes([z[-1] ^ 1]), z[:-3]):
+    try:
+        decompio(data).read()
+    except ValueError:
+        print("ValueError")
+
+# A stored block of 300 bytes, then a match of 10 bytes at distance 300
+data = bytes(range(256)) + bytes(range(44))
+stream = b"\x00\x2c\x01\xd3\xfe" + data + b"C\x84\x15\x00"
+print(decompio(stream, -9).read() == data + data[:10])
+try:
+    decompio(stream, -8).read()
+except ValueError:
+    print("ValueError")
+
+# A match before the start of the data
+try:
+    decompio(b"K\x04B\x00", -15).read()
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,37 @@
+try:
+    import fixed
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+import array
+from fixed import Q16, fromraw
+
+# Floor division and modulo, including INT32_MIN / -1
+print((fromraw(-2**31) // fromraw(-1)).raw(), (fromraw(-2**31) % fromraw(-1)).raw())
+print((fromraw(-2**31) // Q16(2)).raw(), (fromraw(-2**31) % Q16(2)).raw())
+print(Q16(-7) // 2, Q16(-7) % 2, Q16(7) // -2, Q16(7) % -2)
+
+# Ints and results out of range wrap around
+for i in (0, 1, -1, 32767, -32768, 32768, 65537, -65537):
+    print(i, Q16(i).raw())
+print((Q16(32767) + 1).raw(), (Q16(-32768) - 1).raw(), (-fromraw(-2**31)).raw())
+
+# Floats are rounded, out of range they raise
+for f in (1.5, -0.25, 0.1, -32768.0, 32767.5):
+    print(Q16(f).raw())
+for f in (32768.0, -32769.0, 1e30, float("inf"), float("nan")):
+    try:
+        Q16(f)
+    except OverflowError:
+        print("OverflowError")
+
+# Bulk conversion between buffers
+d = array.array("i", [0, 0, 0])
+print(list(fixed.convert(d, array.array("f", [1.5, -2.25, 0.5]))))
+print(list(fixed.convert(d, array.array("h", [3, -300, 32767]))))
+print(list(fixed.convert(array.array("d", [0, 0, 0]), array.array("i", [98304, -147456, 32768]))))
+try:
+    fixed.convert(d, array.array("f", [0, 1e6, 0]))
+except OverflowError:
+    print("OverflowError")
@@ -0,0 +1,106 @@
+try:
+    import kvstore
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+import _os
+
+path = "kvstore_recovery.kv"
+
+# The nspire _os has remove(), the unix one unlink()
+_remove = getattr(_os, "remove", None) or _os.unlink
+
+def remove(p):
+    try:
+        _remove(p)
+    except OSError:
+        pass
+
+def read(p):
+    f = open(p, "rb")
+    data = f.read()
+    f.close()
+    return data
+
+def write(p, data):
+    f = open(p, "wb")
+    f.write(data)
+    f.close()
+
+remove(path)
+remove(path + "~")
+
+db = kvstore.open(path)
+db["a"] = b"1"
+db["b"] = b"22"
+db.close()
+data = read(path)
+print(len(data))
+
+# Replay keeps the complete records of a truncated log, the next write
+# replaces the damaged tail
+for n in (4, 10, 15, 16, 20, 28, 29):
+    write(path, data[:n])
+    db = kvstore.open(path)
+    print(n, sorted(db.keys()))
+    db["c"] = b"3"
+    db.close()
+    db = kvstore.open(path)
+    print(n, sorted(db.keys()), db["c"])
+    db.close()
+
+# A damaged record ends the replay like a missing one
+write(path, data[:-1] + bytes([data[-1] ^ 1]))
+db = kvstore.open(path)
+print(sorted(db.keys()))
+db["c"] = b"3"
+db.close()
+db = kvstore.open(path)
+print(sorted(db.keys()), db["a"], db["c"])
+db.close()
+
+# Compaction interrupted while writing the new file: the old one is used
+remove(path)
+db = kvstore.open(path)
+db["a"] = b"1"
+db["a"] = b"11"
+db["b"] = b"2"
+print(db.garbage())
+db.close()
+data = read(path)
+write(path + "~", data[:7])
+db = kvstore.open(path)
+print(sorted(db.keys()), db["a"], db["b"])
+print(db.compact(), db.garbage())
+db.close()
+db = kvstore.open(path)
+print(sorted(db.keys()), db["a"], db["b"])
+db.close()
+compacted = read(path)
+print(len(data), len(compacted))
+
+# Compaction interrupted between removing the old file and renaming the new
+# one: open() finishes the rename
+remove(path)
+write(path + "~", compacted)
+db = kvstore.open(path)
+print(sorted(db.keys()), db["a"], db["b"])
+db.close()
+print(read(path) == compacted)
+try:
+    read(path + "~")
+except OSError:
+    print("OSError")
+
+# A closed store raises
+try:
+    len(db)
+except ValueError:
+    print("ValueError")
+try:
+    "a" in db
+except ValueError:
+    print("ValueError")
+
+remove(path)
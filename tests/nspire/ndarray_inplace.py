@@ -0,0 +1,35 @@
+try:
+    import ndarray
+except ImportError:
+    print("SKIP")
+    import sys
+    sys.exit()
+from ndarray import array, int16
+
+# The right operand shares the elements of the left one
+m = array([[1, 2, 3], [4, 5, 6], [7, 8, 9]], int16)
+m -= m[0]
+print(m.tolist())
+
+a = array([[1, 2], [3, 4]], int16)
+a += a.T
+print(a.tolist())
+
+b = array([[1, 2], [3, 4]], int16)
+b += b[:, 0]
+print(b.tolist())
+
+v = array([1, 2, 3, 4, 5], int16)
+v[1:] += v[:-1]
+print(v.tolist())
+
+c = array([[1, 2], [3, 4]], int16)
+c[1] *= c[:, 1]
+print(c.tolist())
+
+# The same array on both sides, and no sharing at all
+d = array([1, 2, 3], int16)
+d *= d
+print(d.tolist())
+d -= array([1, 1, 1], int16)
+print(d.tolist())
@@ -72,6 +72,7 @@
 #define MICROPY_PY_UZLIB            (1)
 #define MICROPY_PY_UJSON            (1)
 #define MICROPY_PY_URE              (1)
+#define MICROPY_PY_URE_CACHE        (1)
 #define MICROPY_PY_UHEAPQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
 #define MICROPY_PY_UBINASCII        (1)
@@ -99,6 +100,10 @@ extern const struct _mp_obj_module_t mp_module_time;
 extern const struct _mp_obj_module_t mp_module_termios;
 extern const struct _mp_obj_module_t mp_module_socket;
 extern const struct _mp_obj_module_t mp_module_ffi;
+extern const struct _mp_obj_module_t mp_module_nsp;
+extern const struct _mp_obj_module_t mp_module_fixed;
+extern const struct _mp_obj_module_t mp_module_kvstore;
+extern const struct _mp_obj_module_t mp_module_ndarray;
 
 #if MICROPY_PY_FFI
 #define MICROPY_PY_FFI_DEF { MP_OBJ_NEW_QSTR(MP_QSTR_ffi), (mp_obj_t)&mp_module_ffi },
@@ -120,6 +125,14 @@ extern const struct _mp_obj_module_t mp_module_ffi;
 #else
 #define MICROPY_PY_SOCKET_DEF
 #endif
+#if MICROPY_PY_NSP
+#define MICROPY_PY_NSP_DEF { MP_OBJ_NEW_QSTR(MP_QSTR_nsp), (mp_obj_t)&mp_module_nsp }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_fixed), (mp_obj_t)&mp_module_fixed }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_kvstore), (mp_obj_t)&mp_module_kvstore }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_ndarray), (mp_obj_t)&mp_module_ndarray },
+#else
+#define MICROPY_PY_NSP_DEF
+#endif
 
 #define MICROPY_PORT_BUILTIN_MODULES \
     MICROPY_PY_FFI_DEF \
@@ -127,6 +140,7 @@ extern const struct _mp_obj_module_t mp_module_ffi;
     MICROPY_PY_SOCKET_DEF \
     { MP_OBJ_NEW_QSTR(MP_QSTR__os), (mp_obj_t)&mp_module_os }, \
     MICROPY_PY_TERMIOS_DEF \
+    MICROPY_PY_NSP_DEF \
 
 // type definitions for the specific machine
 
@@ -167,6 +181,7 @@ extern const struct _mp_obj_fun_builtin_t mp_builtin_open_obj;
 #define MICROPY_PORT_ROOT_POINTERS \
     mp_obj_t keyboard_interrupt_obj; \
     void *mmap_region_head; \
+    void *ure_cache; \
 
 // We need to provide a declaration/definition of alloca()
 #ifdef __FreeBSD__
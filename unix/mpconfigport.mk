@@ -17,3 +17,6 @@ MICROPY_PY_SOCKET = 1
 
 # ffi module requires libffi (libffi-dev Debian package)
 MICROPY_PY_FFI = 1
+
+# nsp module of the nspire port on a memory framebuffer (see nsp/libndls.c)
+MICROPY_PY_NSP = 0
@@ -0,0 +1,44 @@
+# Benchmarks for nsp.Texture on the host build (make nsp-bench).
+# Prints the time per call in microseconds for each operation and size.
+
+import utime
+from nsp import Texture
+
+SIZES = ((16, 16), (64, 64), (320, 240))
+
+def bench(name, n, f):
+    f()
+    t = utime.clock()
+    for i in range(n):
+        f()
+    t = utime.clock() - t
+    print("%-32s %10.2f us" % (name, t * 1000000 / n))
+
+def iterations(w, h):
+    return max(10, 200000 // (w * h))
+
+screen = Texture(320, 240, None)
+
+for w, h in SIZES:
+    n = iterations(w, h)
+    opaque = Texture(w, h, None)
+    opaque.fill(0x1234)
+    transparent = Texture(w, h, 0x0000)
+    for y in range(0, h, 2):
+        for x in range(w):
+            transparent.setPx(x, y, 0xffff)
+
+    size = "%dx%d" % (w, h)
+    bench("fill " + size, n, lambda: opaque.fill(0xf800))
+    bench("drawOnto opaque " + size, n, lambda: opaque.drawOnto(screen))
+    bench("drawOnto transparent " + size, n, lambda: transparent.drawOnto(screen))
+    bench("drawOnto scaled x2 " + size, n,
+        lambda: opaque.drawOnto(screen, dest_w=min(2 * w, 320), dest_h=min(2 * h, 240)))
+    bench("drawOnto scaled /2 " + size, n,
+        lambda: opaque.drawOnto(screen, dest_w=w // 2, dest_h=h // 2))
+
+    opaque.delete()
+    transparent.delete()
+
+bench("display 320x240", 100, screen.display)
+screen.delete()
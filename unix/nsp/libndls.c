@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libndls.h"
+#include "../../nspire/timer.h"
+
+// Host side of the nsp module: a memory framebuffer instead of the LCD, frames
+// dumped as PPM files and key presses replayed from a script.
+//
+// Environment variables:
+// NSP_HOST_PPM: printf pattern for the frame number, e.g. "frame%04d.ppm". If set,
+//   every Texture.display() writes the screen to such a file.
+// NSP_HOST_KEYS: file with one line per frame in which keys are held down,
+//   "<frame> <key> [<key>...]", e.g. "12 UP LEFT". Frames are counted by display().
+//   wait_key_pressed() skips ahead to the next frame with keys held.
+
+static uint16_t screen[320 * 240];
+void *nsp_host_screen = screen;
+
+typedef struct _key_frame_t {
+    unsigned int frame;
+    uint32_t keys;
+} key_frame_t;
+
+static const char *const key_names[NSP_HOST_KEY_COUNT] = {
+    [NSP_HOST_KEY_ESC] = "ESC",
+    [NSP_HOST_KEY_ENTER] = "ENTER",
+    [NSP_HOST_KEY_UP] = "UP",
+    [NSP_HOST_KEY_DOWN] = "DOWN",
+    [NSP_HOST_KEY_LEFT] = "LEFT",
+    [NSP_HOST_KEY_RIGHT] = "RIGHT",
+    [NSP_HOST_KEY_TAB] = "TAB",
+    [NSP_HOST_KEY_DEL] = "DEL",
+    [NSP_HOST_KEY_CTRL] = "CTRL",
+    [NSP_HOST_KEY_SHIFT] = "SHIFT",
+    [NSP_HOST_KEY_MENU] = "MENU",
+    [NSP_HOST_KEY_SPACE] = "SPACE",
+};
+
+static bool keys_loaded;
+static key_frame_t *key_frames;
+static unsigned int key_frames_len;
+static unsigned int key_frames_pos;
+static unsigned int frame;
+
+static void load_keys(void) {
+    if (keys_loaded) {
+        return;
+    }
+    keys_loaded = true;
+
+    const char *path = getenv("NSP_HOST_KEYS");
+    if (path == NULL) {
+        return;
+    }
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return;
+    }
+
+    char line[256];
+    unsigned int alloc = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *tok = strtok(line, " \t\r\n");
+        if (tok == NULL || tok[0] == '#') {
+            continue;
+        }
+        key_frame_t kf = { .frame = strtoul(tok, NULL, 10), .keys = 0 };
+        while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+            for (int i = 1; i < NSP_HOST_KEY_COUNT; i++) {
+                if (strcmp(tok, key_names[i]) == 0) {
+                    kf.keys |= 1 << i;
+                }
+            }
+        }
+        if (key_frames_len == alloc) {
+            alloc = alloc ? alloc * 2 : 16;
+            key_frames = realloc(key_frames, alloc * sizeof(key_frame_t));
+        }
+        key_frames[key_frames_len++] = kf;
+    }
+    fclose(f);
+}
+
+// Keys held down in the current frame
+static uint32_t current_keys(void) {
+    load_keys();
+    while (key_frames_pos < key_frames_len && key_frames[key_frames_pos].frame < frame) {
+        key_frames_pos++;
+    }
+    if (key_frames_pos < key_frames_len && key_frames[key_frames_pos].frame == frame) {
+        return key_frames[key_frames_pos].keys;
+    }
+    return 0;
+}
+
+bool isKeyPressed(t_key key) {
+    return (current_keys() >> key.id) & 1;
+}
+
+bool any_key_pressed(void) {
+    return current_keys() != 0;
+}
+
+void wait_key_pressed(void) {
+    if (current_keys() == 0 && key_frames_pos < key_frames_len) {
+        frame = key_frames[key_frames_pos].frame;
+    }
+}
+
+void wait_no_key_pressed(void) {
+    while (current_keys() != 0) {
+        frame++;
+    }
+}
+
+// The calculator sleeps until the next interrupt, the OS timer fires every few ms
+void idle(void) {
+    struct timespec ts = { 0, 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+void nsp_host_display(void) {
+    const char *pattern = getenv("NSP_HOST_PPM");
+    if (pattern != NULL) {
+        char path[256];
+        snprintf(path, sizeof(path), pattern, frame);
+        FILE *f = fopen(path, "wb");
+        if (f != NULL) {
+            fprintf(f, "P6\n320 240\n255\n");
+            for (int i = 0; i < 320 * 240; i++) {
+                uint16_t c = screen[i];
+                uint8_t rgb[3] = {
+                    ((c >> 11) & 0x1f) * 255 / 31,
+                    ((c >> 5) & 0x3f) * 255 / 63,
+                    (c & 0x1f) * 255 / 31,
+                };
+                fwrite(rgb, 1, 3, f);
+            }
+            fclose(f);
+        } else {
+            perror(path);
+        }
+    }
+    frame++;
+}
+
+unsigned int nsp_host_rtc(void) {
+    return time(NULL);
+}
+
+// nspire/importcache.h: the unix port stat()s imports directly, nothing to drop
+void nsp_import_cache_invalidate() {
+}
+
+// nspire/timer.h, backed by the monotonic clock
+
+bool nsp_timer_start() {
+    return true;
+}
+
+void nsp_timer_deinit() {
+}
+
+uint32_t nsp_timer_ticks() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSP_TIMER_HZ + (uint64_t)ts.tv_nsec * NSP_TIMER_HZ / 1000000000;
+}
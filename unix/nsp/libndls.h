@@ -0,0 +1,63 @@
+/*
+ * Stand-in for Ndless' libndls, used to build the nsp module of the nspire port
+ * into the unix port (MICROPY_PY_NSP). Only what the nsp module uses is provided.
+ */
+
+#ifndef NSP_HOST_LIBNDLS_H
+#define NSP_HOST_LIBNDLS_H
+
+#include <stdbool.h>
+
+// Always a CX: 320x240 RGB565, no 4-bit mode switching
+#define has_colors (true)
+
+extern void *nsp_host_screen;
+#define SCREEN_BASE_ADDRESS nsp_host_screen
+
+enum {
+    NSP_HOST_KEY_NONE,
+    NSP_HOST_KEY_ESC,
+    NSP_HOST_KEY_ENTER,
+    NSP_HOST_KEY_UP,
+    NSP_HOST_KEY_DOWN,
+    NSP_HOST_KEY_LEFT,
+    NSP_HOST_KEY_RIGHT,
+    NSP_HOST_KEY_TAB,
+    NSP_HOST_KEY_DEL,
+    NSP_HOST_KEY_CTRL,
+    NSP_HOST_KEY_SHIFT,
+    NSP_HOST_KEY_MENU,
+    NSP_HOST_KEY_SPACE,
+    NSP_HOST_KEY_COUNT,
+};
+
+typedef struct {
+    int id;
+} t_key;
+
+#define KEY_NSPIRE_ESC ((t_key){ NSP_HOST_KEY_ESC })
+#define KEY_NSPIRE_ENTER ((t_key){ NSP_HOST_KEY_ENTER })
+#define KEY_NSPIRE_UP ((t_key){ NSP_HOST_KEY_UP })
+#define KEY_NSPIRE_DOWN ((t_key){ NSP_HOST_KEY_DOWN })
+#define KEY_NSPIRE_LEFT ((t_key){ NSP_HOST_KEY_LEFT })
+#define KEY_NSPIRE_RIGHT ((t_key){ NSP_HOST_KEY_RIGHT })
+#define KEY_NSPIRE_TAB ((t_key){ NSP_HOST_KEY_TAB })
+#define KEY_NSPIRE_DEL ((t_key){ NSP_HOST_KEY_DEL })
+#define KEY_NSPIRE_CTRL ((t_key){ NSP_HOST_KEY_CTRL })
+#define KEY_NSPIRE_SHIFT ((t_key){ NSP_HOST_KEY_SHIFT })
+#define KEY_NSPIRE_MENU ((t_key){ NSP_HOST_KEY_MENU })
+#define KEY_NSPIRE_SPACE ((t_key){ NSP_HOST_KEY_SPACE })
+
+bool isKeyPressed(t_key key);
+bool any_key_pressed(void);
+void wait_key_pressed(void);
+void wait_no_key_pressed(void);
+void idle(void);
+
+// Called by Texture.display() after the frame was copied to the screen
+void nsp_host_display(void);
+
+// What the RTC at 0x90090000 reads on the calculator: seconds since the epoch
+unsigned int nsp_host_rtc(void);
+
+#endif // NSP_HOST_LIBNDLS_H
@@ -0,0 +1 @@
+// Stand-in for Ndless' nucleus.h, nothing of it is needed on the host
@@ -99,3 +99,25 @@ Q(B9600)
 Q(B57600)
 Q(B115200)
 #endif
+
+#if MICROPY_PY_UJSON
+Q(load)
+Q(dump)
+Q(iterload)
+#endif
+
+#if MICROPY_PY_URE
+Q(BACKTRACK)
+Q(purge)
+Q(sub)
+Q(findall)
+Q(finditer)
+Q(start)
+Q(span)
+#endif
+
+#if MICROPY_PY_UZLIB
+Q(DecompIO)
+Q(compress)
+Q(CompIO)
+#endif